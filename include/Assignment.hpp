@@ -0,0 +1,115 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef GEFAST_ASSIGNMENT_HPP
+#define GEFAST_ASSIGNMENT_HPP
+
+#include <atomic>
+#include <unordered_map>
+
+#include "Base.hpp"
+#include "Relation.hpp"
+#include "Utility.hpp"
+#include "Verification.hpp"
+#include "VerificationGotoh.hpp"
+
+namespace GeFaST {
+namespace Assignment {
+
+/*
+ * Configuration parameters of the (closed-reference) assignment.
+ */
+struct AssignConfig {
+
+    // input & output
+    std::string oFile;
+    std::string sepAbundance; // separator of identifier and abundance in the headers of the query files
+
+    // filtering & verification
+    lenSeqs_t threshold;
+    lenSeqs_t extraSegs;
+
+    bool useScore = false;
+    Verification::Scoring scoring;
+
+    unsigned long numWorkers = 1;
+    numSeqs_t batchSize = 1 << 16; // number of queries read, assigned and written together
+
+};
+
+typedef SimpleBinaryRelation<StringIteratorPair, numSeqs_t, hashStringIteratorPair, equalStringIteratorPair> ReferenceInvertedIndex;
+typedef RollingIndices<ReferenceInvertedIndex> ReferenceIndices;
+
+// substrings to be checked, by length of the query and length of the indexed references
+typedef std::unordered_map<lenSeqs_t, std::unordered_map<lenSeqs_t, std::vector<Substrings>>> SubstringsArchive;
+
+/*
+ * Copy all amplicons of the reference pools into one collection sorted by increasing sequence length
+ * and index the segments of all of them (rows of all lengths are kept, the indices are not modified afterwards).
+ * The lengths are indexed by ac.numWorkers threads, one length (= one row of the indices) at a time.
+ */
+AmpliconCollection* indexReferences(const AmpliconPools& pools, ReferenceIndices& indices, const AssignConfig& ac);
+
+/*
+ * Determine the best hit among the indexed references for the query: the reference with the smallest distance
+ * (at most the threshold) and, for ties, the smallest rank (i.e. the highest abundance).
+ * Candidates of a length not exceeding the query length are searched like in the forward segment filter,
+ * those of a greater length like in the backward segment filter.
+ * Returns false if there is no reference within the threshold.
+ * The indices are only read, so that several threads can search concurrently (each with its own auxiliary storage).
+ */
+bool bestHit(const Amplicon& query, const AmpliconCollection& refs, ReferenceIndices& indices, SubstringsArchive& substrsArchive,
+             std::vector<numSeqs_t>& candCnts, lenSeqs_t* M, val_t* D, val_t* P, lenSeqs_t* cntDiffs, lenSeqs_t* cntDiffsP,
+             numSeqs_t& ref, lenSeqs_t& dist, const AssignConfig& ac);
+
+/*
+ * Repeatedly take the next chunk of the queries (through the shared counter nextQuery) and determine their best hits.
+ * hits[i] receives the position of the best reference of query i (or refs.size() if there is none) and the distance.
+ */
+void assignQueries(const std::vector<Amplicon>& queries, const AmpliconCollection& refs, ReferenceIndices& indices,
+                   std::vector<std::pair<numSeqs_t, lenSeqs_t>>& hits, std::atomic<numSeqs_t>& nextQuery, const lenSeqs_t width,
+                   const AssignConfig& ac);
+
+/*
+ * Assign the amplicons of the query files to the indexed references (see indexReferences(...)) and write the results to oFile.
+ * The query files are read in batches of ac.batchSize amplicons (subject to the same filters as the input of the clustering),
+ * which are assigned by ac.numWorkers threads (see assignQueries(...)).
+ * For each query, one line with the identifiers (without abundance) of the query and its best hit and their distance is written (in input order).
+ * Queries without a hit are written with '*' instead of the hit and the distance.
+ * Several assignments can use the same references and indices at the same time.
+ * Returns false if a query file cannot be read or the output file cannot be written.
+ */
+bool assignFiles(const Config<std::string>& conf, const AmpliconCollection& refs, ReferenceIndices& indices,
+                 const std::vector<std::string>& queryFiles, const std::string oFile, const AssignConfig& ac);
+
+/*
+ * Assign the amplicons of the query files to the amplicons of the reference pools (e.g. the seeds or all members of an earlier run).
+ * The references are indexed once (see indexReferences(...)) and the queries are assigned by assignFiles(...) (output file ac.oFile).
+ */
+bool assign(const Config<std::string>& conf, const AmpliconPools& refPools, const std::vector<std::string>& queryFiles,
+            const AssignConfig& ac);
+
+}
+}
+
+#endif //GEFAST_ASSIGNMENT_HPP
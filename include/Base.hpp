@@ -25,6 +25,7 @@
 #define GEFAST_BASE_HPP
 
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
 #include <map>
 #include <string>
@@ -42,6 +43,10 @@
 #define SUCCINCT_FASTIDIOUS 0
 #endif
 
+#ifndef COMPACT_INDICES
+#define COMPACT_INDICES 0
+#endif
+
 #ifndef QGRAM_FILTER
 #define QGRAM_FILTER 1
 #endif
@@ -55,6 +60,20 @@
 
 namespace GeFaST {
 
+#if COMPACT_INDICES
+// Compact mode: 32-bit amplicon indices / counts (incl. abundances) and 16-bit lengths / distances
+// halve the size of the inverted indices, candidates, children and OTU entries.
+// Requires less than 2^32 amplicons (and a total abundance below 2^32) as well as sequences shorter than 2^16.
+
+// type for everything related to counts of amplicons / sequences
+typedef uint32_t numSeqs_t;
+
+// type for everything related to the length of the sequence of an amplicon
+typedef uint16_t lenSeqs_t;
+
+// type for values in the DP-matrix of (Gotoh) verification methods (scores can exceed the sequence lengths)
+typedef uint32_t val_t;
+#else
 // type for everything related to counts of amplicons / sequences
 typedef unsigned long numSeqs_t;
 
@@ -63,6 +82,7 @@ typedef unsigned long lenSeqs_t;
 
 // type for values in the DP-matrix of (Gotoh) verification methods
 typedef lenSeqs_t val_t;
+#endif
 //const val_t NEG_INF = INT16_MIN;
 const val_t POS_INF = INT16_MAX;
 
@@ -92,6 +112,7 @@ struct Amplicon {
     char* seq; // amplicon sequence
     lenSeqs_t len; // length of amplicon sequence
     numSeqs_t abundance; // abundance of amplicon
+    numSeqs_t rank; // position of the amplicon among all amplicons sorted by abundance (descending) and identifier (ascending)
 #if QGRAM_FILTER
     // one bit per possible q-gram:
     // 0 (absence or even number of occurrences) and 1 (odd number of occurrences)
@@ -104,6 +125,7 @@ struct Amplicon {
         seq = 0;
         len = 0;
         abundance = 0;
+        rank = 0;
 #if QGRAM_FILTER
         memset(qGramVector, 0, QGRAMVECTORBYTES);
 #endif
@@ -116,6 +138,7 @@ struct Amplicon {
         seq = s;
         len = l;
         abundance = a;
+        rank = 0;
 #if QGRAM_FILTER
         memset(qGramVector, 0, QGRAMVECTORBYTES);
 
@@ -151,6 +174,7 @@ struct Amplicon {
         seq = other.seq;
         len = other.len;
         abundance = other.abundance;
+        rank = other.rank;
 #if QGRAM_FILTER
         for (numSeqs_t i = 0; i < QGRAMVECTORBYTES; i++) {
             qGramVector[i] = other.qGramVector[i];
@@ -259,8 +283,15 @@ public:
 
     std::vector<lenSeqs_t> allLengths() const;
 
+    // sequence-identity group of the i-th amplicon, i.e. the index of the first amplicon with the same sequence
+    // (initially, every amplicon forms a group of its own)
+    void setSeqGroup(const numSeqs_t i, const numSeqs_t g);
+
+    numSeqs_t seqGroup(const numSeqs_t i) const;
+
 private:
     Amplicon* amplicons_; // amplicon array
+    numSeqs_t* seqGroups_; // sequence-identity group of each amplicon
     numSeqs_t size_; // number of amplicons
     numSeqs_t capacity_; // capacity of the amplicon array
 
@@ -275,32 +306,98 @@ private:
  * Manages a single array storing all identifier and sequence strings
  * of the comprised amplicon collections.
  */
+/*
+ * Location and shape of a pool stored in the spill file of the out-of-core mode (see Preprocessor::runOutOfCore(...)).
+ */
+struct SpilledPool {
+
+    std::vector<std::pair<lenSeqs_t, numSeqs_t>> counts; // number of amplicons per occurring sequence length
+    numSeqs_t size; // number of amplicons
+    unsigned long long stringsLength; // total length of all identifiers and sequences (including the terminating \0's)
+    unsigned long long offset; // position of the (sorted) amplicon records in the spill file
+    unsigned long long length; // size of the amplicon records (in bytes)
+    std::vector<std::pair<unsigned long long, unsigned long long>> rankChunks; // positions and sizes of the chunks holding the ranks
+
+    SpilledPool() {
+
+        size = 0;
+        stringsLength = 0;
+        offset = 0;
+        length = 0;
+
+    }
+
+};
+
 class AmpliconPools {
 
 public:
-    AmpliconPools(std::map<lenSeqs_t, numSeqs_t>& counts, const unsigned long long capacity, const lenSeqs_t threshold);
+    // The sequences and the identifiers of the amplicons are stored in two separate arrays of the given capacities.
+    // The identifiers are only needed when sorting the amplicons and when writing the results, so they are stored
+    // in a memory-mapped file (which is removed when the pools are destroyed) if idFile is not empty.
+    AmpliconPools(std::map<lenSeqs_t, numSeqs_t>& counts, const unsigned long long seqCapacity, const unsigned long long idCapacity,
+                  const lenSeqs_t threshold, const std::string idFile = "");
+
+    // out-of-core pools: all pools are described by the given records and reside in the spill file,
+    // they have to be loaded (see Preprocessor::loadPool(...)) before use and should be released afterwards
+    // (the spill file is removed when the pools are destroyed)
+    AmpliconPools(const std::string& spillFile, const std::vector<SpilledPool>& spilled);
 
     ~AmpliconPools();
 
+    // determine the pools for the given length counts (an amplicon length is mapped to the index of its pool afterwards),
+    // returns the length counts of every pool
+    static std::vector<std::vector<std::pair<lenSeqs_t, numSeqs_t>>> determinePools(std::map<lenSeqs_t, numSeqs_t>& counts,
+                                                                                    const lenSeqs_t threshold);
+
     // adds a new amplicon to pool / amplicon collection i by storing header and sequence information
-    // in the overall strings array and letting the amplicon members point there
+    // in the overall identifier resp. sequence array and letting the amplicon members point there
     void add(const lenSeqs_t i, const std::string& header, const std::string& sequence, const numSeqs_t abundance);
 
+    // rearrange the sequences such that they are stored densely in the order of the (sorted) pools
+    // and allow memory-mapped identifiers to be paged out
+    void compact();
+
     // return pointer to pool with the specified index (or null pointer if i is too large)
     AmpliconCollection* get(const lenSeqs_t i) const;
 
+    // free pool / amplicon collection i (get(i) returns a null pointer afterwards),
+    // the strings of its amplicons remain available unless the pool has been loaded from the spill file
+    void release(const lenSeqs_t i);
+
+    // make the given collection pool i, which also takes ownership of the strings of its amplicons (out-of-core mode)
+    void install(const lenSeqs_t i, AmpliconCollection* ac, char* strings);
+
     // return number of pools / amplicon collections
     lenSeqs_t numPools() const;
 
     // return total number of amplicons in all pools
     numSeqs_t numAmplicons() const;
 
+    // return the length of the longest amplicon in pool i (also available for pools not in memory)
+    lenSeqs_t maxLen(const lenSeqs_t i) const;
+
+    // return whether the pools reside in a spill file (out-of-core mode)
+    bool outOfCore() const;
+
+    // return the name of the spill file and the description of pool i in it
+    const std::string& spillFile() const;
+    const SpilledPool& spilled(const lenSeqs_t i) const;
+
 private:
-    char* strings_; // overall strings (headers, sequences) array, each string ends with a \0
-    char* nextPos_; // position at which the next string would be inserted
-    unsigned long long capacity_; // capacity of strings_
+    char* seqs_; // overall sequences array, each sequence ends with a \0
+    char* nextSeq_; // position at which the next sequence would be inserted
+    unsigned long long seqCapacity_; // capacity of seqs_
+    char* ids_; // overall identifiers (headers) array, each identifier ends with a \0
+    char* nextId_; // position at which the next identifier would be inserted
+    unsigned long long idCapacity_; // capacity of ids_
+    std::string idFile_; // file to which ids_ is mapped (empty if ids_ resides in ordinary memory)
     std::vector<AmpliconCollection*> pools_; // pointers to the comprised amplicon collections
 
+    std::string spillFile_; // spill file of the out-of-core mode (empty otherwise)
+    std::vector<SpilledPool> spilled_; // description of the pools in the spill file
+    std::vector<char*> poolStrings_; // strings of the pools loaded from the spill file
+
 };
 
 
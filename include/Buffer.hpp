@@ -24,9 +24,16 @@
 #ifndef GEFAST_BUFFER_HPP
 #define GEFAST_BUFFER_HPP
 
+#include <algorithm>
 #include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <mutex>
 #include <queue>
+#include <string>
+#include <vector>
 
 
 namespace GeFaST {
@@ -200,6 +207,169 @@ private:
 
 };
 
+/*
+ * Growing byte buffer for preparing (parts of) output files without the overhead of streams.
+ *
+ * Integers are formatted by hand, the buffer is handed over as a whole to the writing thread.
+ */
+class OutputBuffer {
+
+public:
+    OutputBuffer(const size_t capacity = 1 << 16) {
+        data_.reserve(capacity);
+    }
+
+    inline OutputBuffer& operator<<(const char c) {
+
+        data_.push_back(c);
+        return *this;
+
+    }
+
+    inline OutputBuffer& operator<<(const char* str) {
+
+        data_.append(str);
+        return *this;
+
+    }
+
+    inline OutputBuffer& operator<<(const std::string& str) {
+
+        data_.append(str);
+        return *this;
+
+    }
+
+    inline OutputBuffer& operator<<(const unsigned long long val) {
+
+        char digits[20];
+        char* start = digits + 20;
+        unsigned long long v = val;
+
+        do {
+
+            *(--start) = '0' + (v % 10);
+            v /= 10;
+
+        } while (v != 0);
+
+        data_.append(start, digits + 20 - start);
+        return *this;
+
+    }
+
+    inline OutputBuffer& operator<<(const unsigned long val) {
+        return *this << static_cast<unsigned long long>(val);
+    }
+
+    inline OutputBuffer& operator<<(const unsigned int val) {
+        return *this << static_cast<unsigned long long>(val);
+    }
+
+    inline OutputBuffer& operator<<(const unsigned short val) {
+        return *this << static_cast<unsigned long long>(val);
+    }
+
+    // fixed-point notation with one decimal place (identical to std::fixed with std::setprecision(1))
+    inline OutputBuffer& appendFixed1(const double val) {
+
+        char str[32];
+        int len = snprintf(str, sizeof(str), "%.1f", val);
+        data_.append(str, len);
+        return *this;
+
+    }
+
+    inline const char* data() const {
+        return data_.data();
+    }
+
+    inline size_t size() const {
+        return data_.size();
+    }
+
+    inline bool empty() const {
+        return data_.empty();
+    }
+
+    inline void clear() {
+        data_.clear();
+    }
+
+    inline void swap(OutputBuffer& other) {
+        data_.swap(other.data_);
+    }
+
+private:
+    std::string data_;
+
+};
+
+/*
+ * Sequential reader of one segment of a file consisting of variable-sized records.
+ * Every reader buffers its part of the segment, so that several readers can share the stream.
+ */
+struct SegmentReader {
+
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    uint64_t next; // file offset of the first byte of the segment not yet in the buffer
+    uint64_t end; // file offset behind the segment
+    std::vector<char> buf;
+    size_t pos; // position of the first unread byte in the buffer
+    size_t len; // number of bytes in the buffer
+
+    SegmentReader(const uint64_t offset = 0, const uint64_t length = 0) {
+
+        next = offset;
+        end = offset + length;
+        pos = len = 0;
+
+    }
+
+    // make sure that (at least) the next num bytes of the segment are in the buffer
+    bool fill(std::ifstream& iStream, const size_t num) {
+
+        if (len - pos >= num) return true;
+
+        std::copy(buf.begin() + pos, buf.begin() + len, buf.begin());
+        len -= pos;
+        pos = 0;
+
+        size_t toRead = std::min(uint64_t(std::max(num - len, BUFFER_SIZE)), end - next);
+        if (len + toRead > buf.size()) buf.resize(len + toRead);
+
+        iStream.seekg(next);
+        iStream.read(buf.data() + len, toRead);
+        next += toRead;
+        len += toRead;
+
+        return !iStream.fail() && (len - pos >= num);
+
+    }
+
+    bool empty() const {
+        return (pos == len) && (next == end);
+    }
+
+    // copy of the record (header) at the current position (has to be in the buffer)
+    template<typename T>
+    T peek() const {
+
+        T rec;
+        memcpy(&rec, buf.data() + pos, sizeof(T));
+
+        return rec;
+
+    }
+
+    // current position in the buffer
+    const char* current() const {
+        return buf.data() + pos;
+    }
+
+};
+
 }
 
 #endif //GEFAST_BUFFER_HPP
\ No newline at end of file
@@ -0,0 +1,216 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+
+#ifndef GEFAST_MICROVARIANTS_HPP
+#define GEFAST_MICROVARIANTS_HPP
+
+#include "Base.hpp"
+
+#include <vector>
+
+namespace GeFaST {
+namespace Microvariants {
+
+typedef unsigned long long hash_t;
+
+/*
+ * Polynomial hash (modulo 2^64) of a sequence.
+ * The hashes of all microvariants of a sequence can be derived from its prefix hashes in constant time.
+ */
+const hash_t HASH_BASE = 0x100000001b3ULL;
+
+hash_t hashSequence(const char* seq, const lenSeqs_t len);
+
+// bit mixer (finaliser of splitmix64) spreading the polynomial hashes before they are used for addressing
+inline hash_t mix(hash_t h) {
+
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+
+}
+
+/*
+ * Collect all characters occurring in the sequences of the collection / pools.
+ */
+void markCharacters(const AmpliconCollection& ac, bool* occurs);
+std::vector<char> collectCharacters(const bool* occurs);
+std::vector<char> determineAlphabet(const AmpliconCollection& ac);
+std::vector<char> determineAlphabet(const AmpliconPools& pools);
+
+
+/*
+ * Microvariant (sequence with edit distance 1) of a sequence.
+ * The edit is described by its type, its position in the original sequence
+ * and (except for deletions) the new character.
+ */
+struct Microvariant {
+
+    enum Type {SUBSTITUTION, DELETION, INSERTION};
+
+    Type type;
+    lenSeqs_t pos; // substituted / deleted position or position in front of which the character is inserted
+    char c;
+    hash_t hash; // (unmixed) hash of the resulting sequence
+
+};
+
+/*
+ * Enumerates the microvariants of one sequence at a time together with their hashes.
+ * Microvariants obviously leading to the same sequence (deleting / inserting in the same run of characters) are enumerated only once.
+ * The generator does not copy the sequence, which has to outlive its use in the generator.
+ */
+class MicrovariantGenerator {
+
+public:
+    MicrovariantGenerator(const std::vector<char>& alphabet, const lenSeqs_t maxLen);
+
+    // set the sequence whose microvariants are to be enumerated (length at most maxLen)
+    void setSequence(const char* seq, const lenSeqs_t len);
+
+    // hash of the current sequence itself
+    hash_t hash() const;
+
+    // write the microvariant of the current sequence to buf (capacity at least len + 1), returns its length
+    lenSeqs_t materialise(const Microvariant& mv, char* buf) const;
+
+    // call f(mv) for every microvariant mv of the current sequence
+    template<typename F>
+    void forEach(F f) const {
+
+        Microvariant mv;
+        hash_t full = pre_[len_];
+
+        mv.type = Microvariant::SUBSTITUTION;
+        for (lenSeqs_t i = 0; i < len_; i++) {
+
+            mv.pos = i;
+            hash_t w = pow_[len_ - 1 - i];
+            for (auto c : alphabet_) {
+
+                if (c != seq_[i]) {
+
+                    mv.c = c;
+                    mv.hash = full + (hash_t((unsigned char)c) - hash_t((unsigned char)seq_[i])) * w;
+                    f(mv);
+
+                }
+
+            }
+
+        }
+
+        mv.type = Microvariant::DELETION;
+        for (lenSeqs_t i = 0; i < len_; i++) {
+
+            if (i > 0 && seq_[i] == seq_[i - 1]) continue;
+
+            mv.pos = i;
+            mv.hash = full + (pre_[i] - pre_[i + 1]) * pow_[len_ - 1 - i];
+            f(mv);
+
+        }
+
+        mv.type = Microvariant::INSERTION;
+        for (lenSeqs_t i = 0; i <= len_; i++) {
+
+            mv.pos = i;
+            hash_t w = pow_[len_ - i];
+            for (auto c : alphabet_) {
+
+                if (i > 0 && seq_[i - 1] == c) continue;
+
+                mv.c = c;
+                mv.hash = full + pre_[i] * (pow_[len_ - i + 1] - w) + hash_t((unsigned char)c) * w;
+                f(mv);
+
+            }
+
+        }
+
+    }
+
+private:
+    std::vector<char> alphabet_;
+    std::vector<hash_t> pow_; // powers of HASH_BASE
+    std::vector<hash_t> pre_; // hashes of the prefixes of the current sequence
+
+    const char* seq_;
+    lenSeqs_t len_;
+
+};
+
+
+/*
+ * Blocked Bloom filter over 64-bit hashes (all bits of an element are set in the same machine word).
+ * Insertions are atomic, so that several threads can fill the filter concurrently.
+ * Membership queries are not synchronised and should only be performed once all insertions are completed.
+ */
+class BloomFilter {
+
+public:
+    BloomFilter(const unsigned long long numElements, const unsigned long bitsPerElement = 8);
+
+    void insert(const hash_t h);
+
+    bool contains(const hash_t h) const;
+
+private:
+    std::vector<unsigned long long> words_;
+    unsigned long long mask_; // number of words - 1 (power of two)
+
+    // bits of the element within its word (4 bits chosen by 6-bit chunks of the mixed hash)
+    inline unsigned long long pattern(const hash_t m) const {
+        return (1ULL << (m & 63)) | (1ULL << ((m >> 6) & 63)) | (1ULL << ((m >> 12) & 63)) | (1ULL << ((m >> 18) & 63));
+    }
+
+};
+
+
+/*
+ * Exact-sequence lookup table for a collection of amplicons.
+ * Maps the hashes of the sequences onto the positions of the amplicons in the collection.
+ */
+class SequenceTable {
+
+public:
+    SequenceTable(const AmpliconCollection& ac);
+
+    // append to labels the positions of all amplicons whose sequence equals seq[0 .. len)
+    void find(const hash_t h, const char* seq, const lenSeqs_t len, std::vector<numSeqs_t>& labels) const;
+
+    // check whether some amplicon might have a sequence with the given hash
+    bool mayContain(const hash_t h) const;
+
+private:
+    const AmpliconCollection& ac_;
+    std::vector<std::pair<hash_t, numSeqs_t>> entries_; // sorted by hash
+    BloomFilter filter_;
+
+};
+
+}
+}
+
+#endif //GEFAST_MICROVARIANTS_HPP
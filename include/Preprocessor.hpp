@@ -24,6 +24,7 @@
 #ifndef GEFAST_PREPROCESSOR_HPP
 #define GEFAST_PREPROCESSOR_HPP
 
+#include <fstream>
 #include <regex>
 
 #include "Base.hpp"
@@ -37,7 +38,7 @@ namespace Preprocessor {
 
         std::string id;
         std::string information;
-        numSeqs_t abundance;
+        unsigned long long abundance; // as parsed (before narrowing to numSeqs_t, see checkAbundance(...))
 
         Defline() {
 
@@ -47,7 +48,7 @@ namespace Preprocessor {
 
         }
 
-        Defline(std::string i, std::string info, numSeqs_t a) {
+        Defline(std::string i, std::string info, unsigned long long a) {
 
             id = i;
             information = info;
@@ -64,6 +65,12 @@ namespace Preprocessor {
     // sets sequence in upper case
     void upperCase(std::string& s);
 
+    // checks whether the length limits of the configuration (if used) can be represented by lenSeqs_t (only restrictive in compact builds)
+    bool checkLengthLimits(const Config<std::string>& conf);
+
+    // checks whether the total abundance of the input (and hence any OTU mass) can be represented by numSeqs_t (only restrictive in compact builds)
+    bool checkAbundance(const unsigned long long totalAbundance);
+
     // checks whether the given sequence satisfies the given filter criteria
     bool checkSequence(const std::string& seq, const std::string& alphabet, lenSeqs_t minLen, lenSeqs_t maxLen,
                        bool flagAlph, int flagLen);
@@ -72,10 +79,12 @@ namespace Preprocessor {
      * Scans the given input file for sequences that satisfy the preprocessor's filters.
      * The sequences passing the filters are counted and, according to their length, recorded in the counts mapping.
      * For passing sequences, also the combined length of identifier and sequence (+2 for terminating \0's) is summed up
-     * and finally returned.
+     * and finally returned. The length of the identifiers alone (+1 each) is added to idLength (if given)
+     * and the abundances of the passing sequences are added to abundance (if given).
      */
     unsigned long long analyseInput(const Config<std::string>& conf, std::map<lenSeqs_t, numSeqs_t>& counts,
-                                    const std::string fileName, const std::string sep);
+                                    const std::string fileName, const std::string sep, unsigned long long* idLength = 0,
+                                    unsigned long long* abundance = 0);
 
     /*
      * Rereads the analysed input and inserts the suitable amplicons into the pools.
@@ -84,6 +93,65 @@ namespace Preprocessor {
     void appendInput(const Config<std::string>& conf, AmpliconPools& pools, std::map<lenSeqs_t, numSeqs_t>& poolMap,
                      const std::string fileName, const std::string sep);
 
+    /*
+     * Record of an amplicon in the spill file of the out-of-core mode,
+     * directly followed by the identifier and the sequence (both without terminating \0).
+     */
+    struct SpillRecord {
+
+        numSeqs_t abundance;
+        uint32_t idLen;
+        uint32_t seqLen;
+
+    };
+
+    /*
+     * Appends the data of several pools to one file.
+     * Every pool collects its data in a buffer of its own, which is written as a chunk to the end of the file when full.
+     * The positions and sizes of the chunks are recorded per pool.
+     */
+    class PoolSpiller {
+
+    public:
+        PoolSpiller(std::ofstream& oStream, const lenSeqs_t numPools, const size_t bufferSize);
+
+        void append(const lenSeqs_t p, const char* data, const size_t len);
+
+        // write the remaining data of all pools
+        void flush();
+
+        const std::vector<std::pair<unsigned long long, unsigned long long>>& chunks(const lenSeqs_t p) const;
+
+    private:
+        void flush(const lenSeqs_t p);
+
+        std::ofstream& oStream_;
+        size_t bufferSize_;
+        std::vector<std::string> buffers_;
+        std::vector<std::vector<std::pair<unsigned long long, unsigned long long>>> chunks_;
+
+    };
+
+    /*
+     * Rereads the analysed input and writes the suitable amplicons as spill records to the chunks of their pools.
+     * poolMap assigns each sequence length the index of the pool to which it belongs.
+     */
+    void spillInput(const Config<std::string>& conf, PoolSpiller& spiller, std::map<lenSeqs_t, numSeqs_t>& poolMap,
+                    const std::string fileName, const std::string sep);
+
+    /*
+     * Assigns the amplicons of the given (sorted) collection to sequence-identity groups.
+     * Amplicons with the same sequence share the group id, which is the index of the first of them.
+     */
+    void assignSeqGroups(AmpliconCollection& ac);
+
+    /*
+     * Assigns the global ranks to the amplicons of all (sorted) pools by merging the pools.
+     * Afterwards, comparing the ranks of two amplicons is equivalent to comparing
+     * their abundances (descending) and, for ties, their identifiers (ascending).
+     */
+    void assignRanks(AmpliconPools& pools);
+
     /*
      * Manages the overall preprocessing step.
      *
@@ -91,12 +159,33 @@ namespace Preprocessor {
      *  (a) how many sequences of which lengths will be retained after the preprocessing, and
      *  (b) how much characters are necessary to store the sequences and their identifiers as C-strings in one long char array.
      * Second, the amplicon pools are initialised based on the results of above analysis (see the constructor of
-     * AmpliconPools for important details).
+     * AmpliconPools for important details). The identifiers are stored in the file given by ID_STORAGE_FILE (if any).
      * Third, all input files are read a second time to get the actual amplicons and fill the amplicon pools.
-     * Finally, sort the amplicons within each pool by abundance (using the lexicographical order of the headers as the tie-breaker).
+     * Finally, sort the amplicons within each pool by abundance (using the lexicographical order of the headers as the tie-breaker)
+     * and assign them to sequence-identity groups. Then, the global ranks of the amplicons are determined,
+     * after which the identifiers are not accessed before writing the results, and the sequences are packed in pool order.
+     * Returns a null pointer if the length limits or the total abundance exceed the types of the build (see checkLengthLimits(...) etc.).
      */
     AmpliconPools* run(const Config<std::string>& conf, const std::vector<std::string>& fileNames);
 
+    /*
+     * Manages the preprocessing step of the out-of-core mode, which results in the same pools as run(...)
+     * without ever keeping more than one pool in memory.
+     *
+     * The input files are analysed as before and the pools are determined from the length counts.
+     * When reading the input files a second time, the amplicons are written to the chunks of their pools in a
+     * temporary file (spillFile + ".raw"). Then, the pools are sorted one by one and written contiguously to the spill file.
+     * Finally, the global ranks are determined by merging the sorted pools and are appended to the spill file (again in chunks).
+     * Returns a null pointer if the spill file cannot be written or the input exceeds the types of the build (as in run(...)).
+     */
+    AmpliconPools* runOutOfCore(const Config<std::string>& conf, const std::vector<std::string>& fileNames, const std::string spillFile);
+
+    /*
+     * Loads pool i of out-of-core pools from the spill file (if not already in memory).
+     * The amplicons are in the same order and have the same ranks and sequence-identity groups as after run(...).
+     */
+    void loadPool(AmpliconPools& pools, const lenSeqs_t i);
+
 }
 }
 
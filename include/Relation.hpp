@@ -25,7 +25,10 @@
 #define GEFAST_RELATION_HPP
 
 #include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include <unordered_set>
@@ -918,6 +921,181 @@ private:
 // minimum interface: contains, add, remove
 typedef SimpleMatches<lenSeqs_t, numSeqs_t> Matches;
 
+
+/*
+ * Immutable, compressed representation of the matches of one pool in compressed sparse row (CSR) layout.
+ *
+ * The matches of each amplicon are sorted by the index of the partner amplicon (i.e. by its rank within the pool).
+ * Each match is encoded by the difference to the preceding partner index and the distance,
+ * both as variable-length integers (7 bits per byte), so that most matches occupy only two or three bytes.
+ * As the graph is not modified after its construction, arbitrarily many threads can read it without locking.
+ */
+class MatchGraph {
+
+public:
+    MatchGraph();
+
+    // build the graph over the amplicons 0, ..., numNodes - 1 from the (symmetrically stored) matches using numThreads threads
+    MatchGraph(const numSeqs_t numNodes, Matches& matches, const unsigned long numThreads);
+
+    // write the matches (partner, distance) of the specified amplicon (ordered by partner) into res
+    void getMatchesOfAugmented(const numSeqs_t id, std::vector<std::pair<numSeqs_t, lenSeqs_t>>& res) const;
+
+    // return the matches (partner, distance) of the specified amplicon (ordered by partner)
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> getMatchesOfAugmented(const numSeqs_t id) const;
+
+    // return the number of amplicons (nodes)
+    numSeqs_t numNodes() const;
+
+    // return the total number of matches (each pair counted once)
+    unsigned long numMatches() const;
+
+    // return the number of bytes occupied by the encoded matches and the offsets
+    unsigned long numBytes() const;
+
+private:
+    // encode the matches of the amplicons first, ..., last - 1 into bytes (offsets relative to the beginning of bytes)
+    static void encodeRange(const numSeqs_t first, const numSeqs_t last, Matches& matches,
+                            std::vector<unsigned char>& bytes, std::vector<unsigned long>& offsets, unsigned long& cnt);
+
+    std::vector<unsigned long> offsets_; // matches of amplicon i are encoded in data_[offsets_[i], offsets_[i + 1])
+    std::vector<unsigned char> data_; // concatenated encodings of the matches
+    unsigned long numMatches_; // number of stored (directed) matches
+
+};
+
+
+/*
+ * Output file receiving the matches of a similarity join, shared by all threads of the join.
+ *
+ * Text format: one match per line as tab-separated identifiers and distance (more abundant amplicon first).
+ * Binary format: header (magic bytes "GFMJ", byte sizes of numSeqs_t and lenSeqs_t) followed by records
+ * (rank of more abundant amplicon, rank of less abundant amplicon, distance) in native byte order.
+ *
+ * The threads do not write single matches but hand over blocks prepared by their own MatchBuffer.
+ */
+class MatchWriter {
+
+public:
+    MatchWriter(const std::string& oFile, const bool binary);
+
+    ~MatchWriter();
+
+    // append a block of num encoded matches (thread-safe)
+    void write(const std::string& block, const unsigned long num);
+
+    bool binary() const;
+
+    bool good() const;
+
+    // return the number of matches written so far
+    unsigned long long numMatches() const;
+
+private:
+    std::ofstream oStream_;
+    std::mutex mtx_;
+    bool binary_;
+    std::atomic<unsigned long long> numMatches_;
+
+};
+
+/*
+ * Thread-local sink for the matches found in (a subpool of) one amplicon collection.
+ * The matches are encoded immediately (using identifiers resp. ranks from the collection)
+ * and passed to the MatchWriter whenever the buffer is full as well as on destruction.
+ *
+ * Satisfies the same add(...) interface as Matches, so that the 'Directly' segment filters can write into it.
+ */
+class MatchBuffer {
+
+public:
+    MatchBuffer(MatchWriter& writer, const AmpliconCollection& ac, const unsigned long capacity = 4096);
+
+    ~MatchBuffer();
+
+    void add(const numSeqs_t i, const numSeqs_t j, const lenSeqs_t dist);
+
+    // pass the buffered matches to the writer
+    void flush();
+
+private:
+    MatchWriter& writer_;
+    const AmpliconCollection& ac_;
+    std::string block_; // encoded matches not yet written
+    unsigned long size_; // number of matches in block_
+    unsigned long capacity_; // number of matches triggering a flush
+
+};
+
+
+/*
+ * Union-find structure over the elements 0, ..., n - 1 that supports concurrent unite and find operations.
+ * Roots are always linked below the smaller of the two roots, so that the representative
+ * of each set is its smallest element.
+ * Uses path halving, the compression steps are only attempted once (lost CAS races are harmless).
+ */
+class ConcurrentUnionFind {
+
+public:
+    ConcurrentUnionFind(const numSeqs_t n) : parents_(n) {
+
+        for (numSeqs_t i = 0; i < n; i++) {
+            parents_[i].store(i, std::memory_order_relaxed);
+        }
+
+    }
+
+    // return the representative (smallest element) of the set containing x
+    numSeqs_t find(numSeqs_t x) {
+
+        numSeqs_t p = parents_[x].load();
+        while (p != x) {
+
+            numSeqs_t gp = parents_[p].load();
+            if (gp != p) {
+                parents_[x].compare_exchange_weak(p, gp);
+            }
+            x = p;
+            p = parents_[x].load();
+
+        }
+
+        return x;
+
+    }
+
+    // merge the sets containing x and y
+    void unite(numSeqs_t x, numSeqs_t y) {
+
+        while (true) {
+
+            x = find(x);
+            y = find(y);
+
+            if (x == y) return;
+            if (x > y) std::swap(x, y);
+
+            // y is (or was) a root and is now linked below the smaller root x
+            numSeqs_t expected = y;
+            if (parents_[y].compare_exchange_strong(expected, x)) return;
+
+        }
+
+    }
+
+    bool sameSet(const numSeqs_t x, const numSeqs_t y) {
+        return find(x) == find(y);
+    }
+
+    numSeqs_t size() const {
+        return parents_.size();
+    }
+
+private:
+    std::vector<std::atomic<numSeqs_t>> parents_;
+
+};
+
 }
 
 #endif //GEFAST_RELATION_HPP
\ No newline at end of file
@@ -43,6 +43,8 @@ namespace SegmentFilter {
      *
      * The methods with the suffix 'Directly' verify the candidates themselves directly when they occur and
      * do not hand them over to verifier threads through a buffer.
+     * They report the verified matches to a sink S offering add(index, index, distance).
+     * They are instantiated for Matches (collecting the matches) and MatchBuffer (streaming them into a file).
      *
      * All filter methods assume that the amplicons are sorted by increasing sequence length.
      *
@@ -55,30 +57,35 @@ namespace SegmentFilter {
     // (forward) segment filter for the general pigeonhole principle (t + k segments, k segments must be matched)
     void filterForward(const AmpliconCollection& ac, const Subpool& sp, RotatingBuffers<Candidate>& cands,
                        const lenSeqs_t t, const lenSeqs_t k);
-    void filterForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+    template<typename S>
+    void filterForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
 
     // (backward) segment filter for the general pigeonhole principle (t + k segments, k segments must be matched)
     void filterBackward(const AmpliconCollection& ac, const Subpool& sp, RotatingBuffers<Candidate>& cands,
                         const lenSeqs_t t, const lenSeqs_t k);
-    void filterBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+    template<typename S>
+    void filterBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                 const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
 
     // (forward) segment filter for the general pigeonhole principle (t + k segments, k segments must be matched) + pipelined backward filtering
     void filterForwardBackward(const AmpliconCollection& ac, const Subpool& sp, RotatingBuffers<Candidate>& cands,
                                const lenSeqs_t t, const lenSeqs_t k);
-    void filterForwardBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+    template<typename S>
+    void filterForwardBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                        const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
 
     // (backward) segment filter for the general pigeonhole principle (t + k segments, k segments must be matched) + pipelined forward filtering
     void filterBackwardForward(const AmpliconCollection& ac, const Subpool& sp, RotatingBuffers<Candidate>& cands,
                                const lenSeqs_t t, const lenSeqs_t k);
-    void filterBackwardForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+    template<typename S>
+    void filterBackwardForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                        const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
 
     void filter(const AmpliconCollection& ac, const Subpool& sp, RotatingBuffers<Candidate>& cands,
                 const lenSeqs_t t, const lenSeqs_t k, const int mode);
-    void filterDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+    template<typename S>
+    void filterDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                         const lenSeqs_t t, const lenSeqs_t k, const int mode, const bool useScore, const Verification::Scoring& scoring);
 
 }
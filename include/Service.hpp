@@ -0,0 +1,86 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef GEFAST_SERVICE_HPP
+#define GEFAST_SERVICE_HPP
+
+#include "Assignment.hpp"
+#include "Base.hpp"
+#include "Utility.hpp"
+
+namespace GeFaST {
+namespace Service {
+
+/*
+ * Runs a complete job of GeFaST for the given command-line arguments (like the main function) and returns its exit code.
+ */
+typedef int (*JobRunner)(int argc, const char* argv[]);
+
+/*
+ * Configuration parameters of the service mode.
+ */
+struct ServiceConfig {
+
+    std::string socketPath;
+    unsigned long numJobs = 1; // number of requests processed concurrently
+    unsigned long requestTimeout = 10; // seconds a client may stay silent while sending its request line
+
+};
+
+/*
+ * Data kept in memory between the requests: the reference amplicons and their indices (if references were given).
+ * The indices are only read by the requests, so that several assignments can use them at the same time.
+ */
+struct ResidentData {
+
+    Assignment::AssignConfig ac;
+    AmpliconCollection* refs = 0;
+    Assignment::ReferenceIndices* indices = 0;
+
+};
+
+/*
+ * Process one request (a line of whitespace-separated tokens) and return the reply line:
+ *  - "assign <output file> <query file>..." assigns the queries to the resident references,
+ *  - "cluster <arguments>..." runs a complete job (as if GeFaST was called with these arguments),
+ *  - "shutdown" stops the service after the running requests.
+ * The reply is "OK" on success and "ERROR <reason>" otherwise.
+ */
+std::string handleRequest(const std::string& request, const Config<std::string>& conf, ResidentData& data, JobRunner runner,
+                          bool& shutdown);
+
+/*
+ * Keep the reference pools (if any) indexed in memory and accept requests on the Unix socket svc.socketPath
+ * until a shutdown request arrives. Each connection carries one request line and receives one reply line.
+ * The requests are processed by svc.numJobs threads, i.e. up to svc.numJobs requests run concurrently.
+ * Connections not delivering their request line within svc.requestTimeout seconds are closed without a reply.
+ * An existing socket file is only replaced if no service is listening on it anymore, other files are never replaced.
+ * Returns false if the socket cannot be set up or accepting connections fails.
+ */
+bool serve(const Config<std::string>& conf, const AmpliconPools* refPools, const Assignment::AssignConfig& ac,
+           const ServiceConfig& svc, JobRunner runner);
+
+}
+}
+
+#endif //GEFAST_SERVICE_HPP
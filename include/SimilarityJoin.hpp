@@ -0,0 +1,94 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+
+#ifndef GEFAST_SIMILARITYJOIN_HPP
+#define GEFAST_SIMILARITYJOIN_HPP
+
+#include "Base.hpp"
+#include "Relation.hpp"
+#include "SegmentFilter.hpp"
+#include "VerificationGotoh.hpp"
+
+namespace GeFaST {
+namespace SimilarityJoin {
+
+/*
+ * Configuration parameters of the similarity join.
+ */
+struct JoinConfig {
+
+    // output
+    std::string oFile; // -o
+    bool binary = false;
+
+    // filtering & verification
+    lenSeqs_t threshold;
+    lenSeqs_t extraSegs;
+    int filterMode = 0; // forward, backward, forward-backward, backward-forward
+
+    bool useScore = false;
+    Verification::Scoring scoring;
+
+    unsigned long numWorkers = 1;
+
+};
+
+/*
+ * Unit of work of the join: one subpool of a (length-sorted) pool.
+ */
+struct JoinTask {
+
+    const AmpliconCollection* ac;
+    Subpool sp;
+
+    JoinTask(const AmpliconCollection* a, const Subpool& s) {
+
+        ac = a;
+        sp = s;
+
+    }
+
+};
+
+// copy of the pool with the amplicons sorted by increasing sequence length (as required by the segment filters)
+AmpliconCollection* sortByLength(const AmpliconCollection& ac);
+
+// repeatedly take the next unprocessed task, filter its subpool and stream the verified matches to the writer
+void joinTasks(const std::vector<JoinTask>& tasks, std::atomic<unsigned long>& nextTask, MatchWriter& writer, const JoinConfig& jc);
+
+/*
+ * Determines all pairs of amplicons (within the same pool) whose distance is at most the threshold
+ * and writes them to the output file while they are found.
+ *
+ * Each pool is split into subpools (proportionally to its share of all amplicons, at most one per worker),
+ * which are processed by the worker threads in the order of decreasing size.
+ * Small pools thus form a single task, while large pools are filtered in parallel.
+ * The order of the matches in the output depends on the scheduling of the workers.
+ */
+void join(const AmpliconPools& pools, const JoinConfig& jc);
+
+}
+}
+
+#endif //GEFAST_SIMILARITYJOIN_HPP
@@ -25,11 +25,14 @@
 #define GEFAST_SWARMCLUSTERING_HPP
 
 #include "Base.hpp"
+#include "Buffer.hpp"
 #include "Relation.hpp"
 #include "SegmentFilter.hpp"
 #include "Verification.hpp"
 #include "VerificationGotoh.hpp"
 
+#include <thread>
+
 #if SUCCINCT_FASTIDIOUS
 #include "RelationSuccinct.hpp"
 #endif
@@ -87,13 +90,66 @@ struct SwarmConfig {
 
     bool filterTwoWay = false;
 
+    // 0: pools explored independently (one thread per pool)
+    // 1: pools explored one after another, components of a pool explored in parallel
+    // 2: pools explored independently, children of the members of one generation determined in parallel
+    // 3: pools explored independently, children determined by enumerating microvariants (threshold 1, no scoring function)
+    unsigned long explorationMode = 0;
+
     unsigned long numExplorers = 1;
     unsigned long numThreadsPerExplorer = 1;
     unsigned long numGrafters = 1;
 
+    // 0: heavy OTUs of the neighbouring pools checked one after another against the index of a pool
+    // 1: heavy OTUs of the pool itself checked in parallel to those of the neighbouring pools
+    // 2: heavy OTUs of the pool itself and of all neighbouring pools checked in parallel
+    // 3: one global index over all light OTUs, heavy OTUs of all pools checked once against it (not with SUCCINCT_FASTIDIOUS)
+    // 4: microvariants of heavy amplicons looked up among the light amplicons (fastidious threshold 1 or 2, no scoring function)
     unsigned long fastidiousCheckingMode = 0;
     unsigned long numThreadsPerCheck = 1;
 
+    unsigned long numWriters = 1; // threads preparing the outputs
+
+    // multi-threshold mode: matches are determined once for the threshold and the clustering is derived for every d = 1, ..., threshold
+    // (output files get the suffix .<d>, the fastidious threshold is 2 * d unless it is set explicitly)
+    bool multiThreshold = false;
+    bool explicitFastidiousThreshold = false;
+
+    // persisted results of the first clustering phase
+    bool outPhase1 = false;
+    std::string oFilePhase1;
+    bool inPhase1 = false; // read OTUs from iFilePhase1 instead of exploring the pools
+    std::string iFilePhase1;
+
+    // state for incremental clustering (see outputState(...) and readState(...))
+    bool outState = false;
+    std::string oPrefixState;
+    bool inState = false; // add the amplicons of the state to the input and reuse the OTUs of the pools not changed since then
+    std::string iPrefixState;
+
+    // streaming mode (only without fastidious clustering): the OTUs of each pool are written to a sorted run as soon as the pool is explored
+    // (the pool is released afterwards) and the final outputs are produced by merging the runs
+    bool streaming = false;
+
+    // out-of-core mode: the pools reside in a spill file (see Preprocessor::runOutOfCore(...)) and are loaded only while needed,
+    // the OTUs are written to sorted runs like in the streaming mode (see clusterStreaming(...) and clusterOutOfCore(...))
+    bool outOfCore = false;
+
+    // shard mode: the pools are explored by several processes (possibly on different nodes) sharing the directory shardDir
+    // (see shardCoordinate(...), shardWork(...) and shardMerge(...)), shardRole is empty outside of the shard mode
+    std::string shardRole;
+    std::string shardDir;
+
+    // binary result file (see outputBinary(...))
+    bool outBinary = false;
+    std::string oFileBinary;
+    bool inBinary = false; // convert iFileBinary into the requested text outputs instead of clustering
+    std::string iFileBinary;
+
+    // parameter sweep: fastidious clustering for each (boundary, fastidious threshold) combination
+    // based on the same first-phase OTUs (output files get the suffix .b<boundary>.f<fastidious threshold>)
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> sweep;
+
 };
 
 
@@ -101,44 +157,18 @@ struct SwarmConfig {
  * Representation of a member (amplicon) of an OTU, also describing its "position" within the OTU.
  * Serves also as a "point" in the amplicon space during the exploration.
  *
+ * Amplicons are referred to by their position in the pool (see Otu::amplicon(...)).
+ *
  * Stored information:
  *  - member: the represented amplicon
  *  - parent: parent amplicon of member OR member itself (only if gen = 0)
  *  - parentDist: (edit) distance between the amplicon and its parent
  *  - gen: generation number of the amplicon
- *  - rad: cumulated differences between the OTU seed and the amplicon (only in precursor)
  */
-struct OtuEntryPrecursor {
-
-    const Amplicon* member;
-    const Amplicon* parent;
-    lenSeqs_t parentDist;
-    lenSeqs_t gen;
-    lenSeqs_t rad;
-
-    OtuEntryPrecursor() {
-
-        member = parent = 0;
-        parentDist = gen = rad = 0;
-
-    }
-
-    OtuEntryPrecursor(const Amplicon* m, const Amplicon* p, lenSeqs_t pd, lenSeqs_t g, lenSeqs_t r) {
-
-        member = m;
-        parent = p;
-        parentDist = pd;
-        gen = g;
-        rad = r;
-
-    }
-
-};
-
 struct OtuEntry {
 
-    const Amplicon* member;
-    const Amplicon* parent;
+    numSeqs_t member;
+    numSeqs_t parent;
     lenSeqs_t parentDist;
     lenSeqs_t gen;
 
@@ -149,7 +179,7 @@ struct OtuEntry {
 
     }
 
-    OtuEntry(const Amplicon* m, const Amplicon* p, lenSeqs_t pd, lenSeqs_t g) {
+    OtuEntry(numSeqs_t m, numSeqs_t p, lenSeqs_t pd, lenSeqs_t g) {
 
         member = m;
         parent = p;
@@ -167,15 +197,6 @@ struct OtuEntry {
 
     }
 
-    OtuEntry(const OtuEntryPrecursor& other) {
-
-        member = other.member;
-        parent = other.parent;
-        parentDist = other.parentDist;
-        gen = other.gen;
-
-    }
-
 };
 
 /*
@@ -184,12 +205,14 @@ struct OtuEntry {
  * Stored information:
  *  - numUniqueSequences: number of distinct amplicon sequences in the cluster
  *  - mass: total abundance of all amplicons in the cluster
- *  - members: "structure" of the OTU
+ *  - ampls: amplicons of the pool the members of the OTU refer to
+ *  - members: "structure" of the OTU (stored in the OtuArena that also holds the OTU)
  *  - numMembers: number of members in the OTU (not including grafted OTUs)
  *  - maxRad: maximum radius of the OTU (i.e. accumulated differences between the seed the furthermost sequence in the OTU)
  *
  *  - nextGraftedOtu: pointer to the next OTU grafted onto this one
  *  - lastGraftedOtu: pointer to the last OTU grafted onto this one
+ *  - graftParentOtu: OTU onto which this OTU is grafted (if any)
  *  - graftParent: member of the OTU onto which this OTU is grafted (if any)
  *  - graftChild: member of this OTU, which is part of the grafting link of this OTU (if any)
  */
@@ -197,6 +220,7 @@ struct Otu {
 
     numSeqs_t numUniqueSequences;
     numSeqs_t mass;
+    const Amplicon* ampls;
     OtuEntry* members; // always entry for seed at index 0 (with itself as its parent)
     numSeqs_t numMembers;
     lenSeqs_t maxRad;
@@ -204,6 +228,7 @@ struct Otu {
     Otu* nextGraftedOtu;
     Otu* lastGraftedOtu;
 
+    Otu* graftParentOtu;
     OtuEntry* graftParent;
     const Amplicon* graftChild;
 
@@ -211,6 +236,7 @@ struct Otu {
 
         numUniqueSequences = 0;
         mass = 0;
+        ampls = 0;
         members = 0;
         numMembers = 0;
         maxRad = 0;
@@ -218,40 +244,30 @@ struct Otu {
         nextGraftedOtu = 0;
         lastGraftedOtu = 0;
 
+        graftParentOtu = 0;
         graftParent = 0;
         graftChild = 0;
 
     }
 
-    ~Otu() {
-        delete[] members;
-    }
-
-    // create the actual members of the OTU from their precursors
-    void setMembers(const std::vector<OtuEntryPrecursor>& mems) {
-
-        delete[] members;
-        numMembers = mems.size();
-        members = new SwarmClustering::OtuEntry[numMembers];
-
-        maxRad = 0;
-        for (numSeqs_t i = 0; i < numMembers; i++) {
-
-            members[i] = SwarmClustering::OtuEntry(mems[i]);
-            maxRad = std::max(maxRad, mems[i].rad);
-
-        }
-
+    // returns the amplicon at the given position of the pool (e.g. OtuEntry::member)
+    const Amplicon* amplicon(const numSeqs_t pos) const {
+        return ampls + pos;
     }
 
     // returns the seed amplicon of the OTU
     const Amplicon* seed() const {
-        return members[0].member;
+        return ampls + members[0].member;
     }
 
     // returns the abundance of the seed amplicon
     numSeqs_t seedAbundance() const {
-        return members[0].member->abundance;
+        return ampls[members[0].member].abundance;
+    }
+
+    // returns the amplicon of the member of the OTU onto which this OTU is grafted (if any)
+    const Amplicon* graftParentAmplicon() const {
+        return graftParentOtu->amplicon(graftParent->member);
     }
 
     // attach another OTU to this one via the specified members
@@ -264,6 +280,7 @@ struct Otu {
         }
         lastGraftedOtu = childOtu;
 
+        childOtu->graftParentOtu = this;
         childOtu->graftParent = parentMember;
         childOtu->graftChild = childMember;
 
@@ -296,7 +313,7 @@ struct Otu {
 
         numSeqs_t cnt = 0;
         for (numSeqs_t i = 0; i < numMembers; i++) {
-            cnt += (members[i].member->abundance == 1);
+            cnt += (ampls[members[i].member].abundance == 1);
         }
 
         return cnt;
@@ -341,6 +358,60 @@ struct Otu {
 
 };
 
+/*
+ * Storage for the OTUs (and their members) of one pool.
+ *
+ * OTUs and members are placed in blocks of increasing size (up to a maximum size),
+ * which are all released at once when the arena is destroyed.
+ * The members of the OTU under construction ("open" members) are appended directly to the current member block.
+ * When this block is full, the open members are moved into a new, sufficiently large block.
+ * Hence, pointers to open members are only valid until the next call of addMember(...),
+ * while the members of closed OTUs never move.
+ */
+class OtuArena {
+
+public:
+    OtuArena();
+
+    ~OtuArena();
+
+    OtuArena(const OtuArena& other) = delete;
+
+    OtuArena& operator=(const OtuArena& other) = delete;
+
+    // return a new, empty OTU whose members refer to the given amplicons (of one pool)
+    Otu* newOtu(const Amplicon* ampls);
+
+    // append a member to the open members
+    void addMember(const OtuEntry& entry);
+
+    // return pointer to the first open member
+    OtuEntry* openMembers() const;
+
+    // return number of open members
+    numSeqs_t numOpenMembers() const;
+
+    // make the open members the members of the given OTU
+    void closeMembers(Otu& otu);
+
+    // take over all blocks of the other arena (which has to have no open members)
+    void absorb(OtuArena& other);
+
+private:
+    static const numSeqs_t MIN_BLOCK_SIZE = 64;
+    static const numSeqs_t MAX_BLOCK_SIZE = 1 << 16;
+
+    std::vector<Otu*> otuBlocks_;
+    numSeqs_t otuBlockSize_; // size of the last OTU block
+    numSeqs_t otusUsed_; // number of used OTUs in the last OTU block
+
+    std::vector<OtuEntry*> memberBlocks_;
+    numSeqs_t memberBlockSize_; // size of the last member block
+    numSeqs_t membersUsed_; // number of used (closed or open) members in the last member block
+    numSeqs_t openBegin_; // position of the first open member in the last member block
+
+};
+
 /*
  * Inverted indices for applying the segment filter in the fastidious clustering phase
  * Maps sequence substrings onto OTU members.
@@ -389,6 +460,11 @@ struct GraftCandidate {
 
     }
 
+    // returns the amplicon of the parent member
+    const Amplicon* parentAmplicon() const {
+        return parentOtu->amplicon(parentMember->member);
+    }
+
 };
 
 /*
@@ -420,6 +496,11 @@ struct CandidateFastidious {
 
     }
 
+    // returns the amplicon of the parent member
+    const Amplicon* parentAmplicon() const {
+        return parentOtu->amplicon(parentMember->member);
+    }
+
 };
 
 /*
@@ -437,60 +518,180 @@ struct CompareIndicesAbund {
     }
 
     bool operator()(numSeqs_t a, numSeqs_t b) {
-        return (ac[a].abundance > ac[b].abundance) || ((ac[a].abundance == ac[b].abundance) && (strcmp(ac[a].id, ac[b].id) < 0));
+        return ac[a].rank < ac[b].rank;
     }
 
 };
 
-// Sort OTU members according to the respective abundance (descending) of the amplicons
-// Use the "rank" of the amplicons as the tie-breaker
-struct CompareOtuEntryPrecursorsAbund {
-    bool operator()(const OtuEntryPrecursor& a, const OtuEntryPrecursor& b) {
-        return (a.member->abundance > b.member->abundance) ||
-                ((a.member->abundance == b.member->abundance) && (strcmp(a.member->id, b.member->id) < 0));
-    }
-};
-
 // Sort OTUs by their mass (descending)
 // Use the rank of the seeds as the tie-breaker
 struct CompareOtusMass {
     bool operator()(const Otu* a, const Otu* b) {
-        return (a->mass > b->mass) ||
-                ((a->mass == b->mass) && ((a->seed()->abundance > b->seed()->abundance) ||
-                        ((a->seed()->abundance == b->seed()->abundance) && (strcmp(a->seed()->id, b->seed()->id) < 0))));
+        return (a->mass > b->mass) || ((a->mass == b->mass) && (a->seed()->rank < b->seed()->rank));
     }
 };
 
 // Sort OTUs by the abundance of their seeds (descending)
 struct CompareOtusSeedAbund {
     bool operator()(const Otu* a, const Otu* b) {
-        return (a->seedAbundance() > b->seedAbundance()) ||
-                ((a->seedAbundance() == b->seedAbundance()) && (strcmp(a->seed()->id, b->seed()->id) < 0));
+        return a->seed()->rank < b->seed()->rank;
     }
 };
 
 // Sort grafting candidates by the abundances of the parents and, if necessary, break ties through the abundances of the children (both descending)
-// Use the lexicographical order of the ids of the amplicons as the tie-breaker for the abundance comparison
+// The ranks of the amplicons incorporate the lexicographical order of their ids as the tie-breaker for the abundance comparison
 struct CompareGraftCandidatesAbund {
-
-    inline bool compareMember(const Amplicon& amplA, const Amplicon& amplB) {
-        return (amplA.abundance > amplB.abundance) || ((amplA.abundance == amplB.abundance) && (strcmp(amplA.id, amplB.id) < 0));
+    bool operator()(const GraftCandidate& a, const GraftCandidate& b) {
+        return (a.parentAmplicon()->rank < b.parentAmplicon()->rank) ||
+                ((a.parentAmplicon() == b.parentAmplicon()) && (a.childMember->rank < b.childMember->rank));
     }
+};
 
-    bool operator()(const GraftCandidate& a, const GraftCandidate& b) {
-        return compareMember(*a.parentMember->member, *b.parentMember->member) ||
-                ((a.parentMember->member->id == b.parentMember->member->id) && compareMember(*a.childMember, *b.childMember));
+// Integer priority key of a grafting candidate (ranks of parent and child amplicon) together with the position of the candidate.
+// Sorting the keys orders the candidates like CompareGraftCandidatesAbund without following any pointers.
+struct GraftKey {
+
+    numSeqs_t parentRank;
+    numSeqs_t childRank;
+    numSeqs_t pos;
+
+    bool operator<(const GraftKey& other) const {
+        return (parentRank < other.parentRank) || ((parentRank == other.parentRank) && (childRank < other.childRank));
     }
 
 };
 
 
+/*
+ * Sort the OTU entries in [first, last) by the integer keys assigned to their members by key,
+ * e.g. the position of the member in its (sorted) pool or its rank.
+ * Large ranges are sorted by a least-significant-digit radix sort (8-bit digits) using buffer as auxiliary storage,
+ * small ranges by std::sort.
+ */
+template<typename K>
+void sortGeneration(OtuEntry* first, OtuEntry* last, std::vector<OtuEntry>& buffer, K key) {
+
+    const numSeqs_t n = last - first;
+
+    if (n < 256) {
+
+        std::sort(first, last, [&key](const OtuEntry& a, const OtuEntry& b) {
+            return key(a) < key(b);
+        });
+        return;
+
+    }
+
+    numSeqs_t maxKey = 0;
+    for (auto iter = first; iter != last; iter++) {
+        maxKey = std::max(maxKey, key(*iter));
+    }
+
+    buffer.resize(n);
+    OtuEntry* src = first;
+    OtuEntry* dst = buffer.data();
+    numSeqs_t cnts[256];
+
+    for (unsigned shift = 0; shift < 8 * sizeof(numSeqs_t) && (maxKey >> shift) != 0; shift += 8) {
+
+        memset(cnts, 0, sizeof(cnts));
+        for (numSeqs_t i = 0; i < n; i++) {
+            cnts[(key(src[i]) >> shift) & 0xFF]++;
+        }
+        for (numSeqs_t d = 0, sum = 0; d < 256; d++) {
+            numSeqs_t c = cnts[d];
+            cnts[d] = sum;
+            sum += c;
+        }
+        for (numSeqs_t i = 0; i < n; i++) {
+            dst[cnts[(key(src[i]) >> shift) & 0xFF]++] = src[i];
+        }
+
+        std::swap(src, dst);
+
+    }
+
+    if (src != first) { // odd number of passes
+        std::copy(src, src + n, first);
+    }
+
+}
+
 
 /*
- * Determine all OTUs for the given amplicons by exploring the possible links (matches).
- * The found OTUs are returned via the referenced OTU vector.
+ * Sort the given elements (by operator<) using numThreads threads.
+ * Equally-sized chunks are sorted concurrently and then merged pairwise (the merges of one round also concurrently).
+ * The result equals the one of std::sort as long as no two elements are equivalent.
  */
-void explorePool(const AmpliconCollection& ac, Matches& matches, std::vector<Otu*>& otus, const SwarmConfig& sc);
+template<typename T>
+void parallelSort(std::vector<T>& elems, const unsigned long numThreads) {
+
+    const numSeqs_t n = elems.size();
+    const numSeqs_t numChunks = std::max(1UL, std::min(numThreads, (unsigned long)(n / 1024)));
+
+    if (numChunks == 1) {
+
+        std::sort(elems.begin(), elems.end());
+        return;
+
+    }
+
+    std::vector<numSeqs_t> bounds(numChunks + 1);
+    for (numSeqs_t c = 0; c <= numChunks; c++) {
+        bounds[c] = n * c / numChunks;
+    }
+
+    std::vector<std::thread> workers;
+    for (numSeqs_t c = 0; c < numChunks; c++) {
+        workers.emplace_back([&elems, &bounds, c]() {
+            std::sort(elems.begin() + bounds[c], elems.begin() + bounds[c + 1]);
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    for (numSeqs_t width = 1; width < numChunks; width *= 2) {
+
+        workers.clear();
+        for (numSeqs_t c = 0; c + width < numChunks; c += 2 * width) {
+
+            auto first = elems.begin() + bounds[c];
+            auto middle = elems.begin() + bounds[c + width];
+            auto last = elems.begin() + bounds[std::min(c + 2 * width, numChunks)];
+            workers.emplace_back([first, middle, last]() {
+                std::inplace_merge(first, middle, last);
+            });
+
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+
+    }
+
+}
+
+/*
+ * Sort the grafting candidates by decreasing priority (see CompareGraftCandidatesAbund)
+ * by sorting their integer priority keys in parallel (numThreads threads).
+ */
+void sortGraftCandidates(std::vector<GraftCandidate>& graftCands, const unsigned long numThreads);
+
+/*
+ * Determine all OTUs for the given amplicons by exploring the possible links (matches) in the given match graph.
+ * Only matches with a distance of at most sc.threshold are considered, so that the graph can stem from a larger threshold.
+ * The graph is only read, so that several explorers can share it.
+ * The found OTUs are returned via the referenced OTU vector (and stored in the given arena).
+ */
+void explorePool(const AmpliconCollection& ac, const MatchGraph& graph, std::vector<Otu*>& otus, OtuArena& arena,
+                 const SwarmConfig& sc);
+
+/*
+ * Determine all matches (with distance of at most sc.threshold) between the amplicons of the given pool.
+ * A copy of the pool sorted by length is filtered, the resulting match graph refers to the positions in the original pool.
+ */
+void computeMatchGraph(const AmpliconCollection& ac, MatchGraph& graph, const SwarmConfig& sc);
 
 
 /*
@@ -551,6 +752,43 @@ void checkAndVerify(const AmpliconPools& pools, const std::vector<Otu*>& otus, c
 void determineGrafts(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, std::vector<GraftCandidate>& allGraftCands,
                      const numSeqs_t p, std::mutex& allGraftCandsMtx, const SwarmConfig& sc);
 
+/*
+ * Copy the amplicons of all light OTUs (over all pools) into one collection sorted by length
+ * and prepare the child information of the corresponding (otherwise empty) grafting candidates.
+ * The returned collection has to be deleted by the caller.
+ */
+AmpliconCollection* collectLightAmplicons(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                          std::vector<GraftCandidate>& graftCands, const SwarmConfig& sc);
+
+#if !SUCCINCT_FASTIDIOUS
+/*
+ * Determine the grafting candidates of the amplicons from all pools using one index over the amplicons of all light OTUs.
+ * The index is built once (rows of different lengths in parallel) and every amplicon of a heavy OTU is filtered only once,
+ * instead of once per pool within the fastidious range as in determineGrafts().
+ * Uses sc.numGrafters threads for both indexing and searching.
+ */
+void determineGraftsGlobally(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, std::vector<GraftCandidate>& allGraftCands,
+                             const SwarmConfig& sc);
+#endif
+
+/*
+ * Determine the grafting candidates of the amplicons from all pools by enumerating microvariants instead of using the segment filter
+ * (only for fastidious thresholds 1 and 2 without scoring function).
+ * For threshold 1, the microvariants of the heavy amplicons are looked up among the hashed light amplicons.
+ * For threshold 2, the microvariants of the light amplicons are additionally put into a Bloom filter
+ * and only the microvariants of heavy amplicons passing the filter are expanded to their own microvariants.
+ * Uses sc.numGrafters threads for both filling the Bloom filter and searching.
+ */
+void determineGraftsMicrovariants(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, std::vector<GraftCandidate>& allGraftCands,
+                                  const SwarmConfig& sc);
+
+/*
+ * Determine the grafting candidates of the amplicons from all pools (using several grafter threads)
+ * and sort them by decreasing priority.
+ */
+void determineAllGrafts(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, std::vector<GraftCandidate>& allGraftCands,
+                        const SwarmConfig& sc);
+
 /*
  *  Graft light OTUs onto heavy OTUs by "simulating virtual amplicons".
  *  To this end, index the amplicons from the light OTUs for the segment filter with a doubled threshold.
@@ -559,22 +797,100 @@ void determineGrafts(const AmpliconPools& pools, const std::vector<std::vector<O
  *   - The (final) grafting partner of an amplicon from a light OTU, is a matching amplicon with the highest abundance.
  *   - Each light OTU can be grafted upon at most one heavy OTU (even though there can be grafting candidates for several amplicons of the light OTU).
  *   - Grafting candidates with a higher parent amplicon abundance (and, for ties, higher child amplicon abundance) have a higher priority.
+ *  If graftCands is given, these (sorted) grafting candidates are used instead of determining them.
  */
-void graftOtus(numSeqs_t& maxSize, numSeqs_t& numOtus, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc);
+void graftOtus(numSeqs_t& maxSize, numSeqs_t& numOtus, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+               const SwarmConfig& sc, const std::vector<GraftCandidate>* graftCands = 0);
 
 
 /*
  * Determine overall statistics, start fastidious clustering phase (if requested) and output the results.
+ * The optional grafting candidates are passed on to graftOtus(...).
+ */
+void processOtus(const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc,
+                 const std::vector<GraftCandidate>* graftCands = 0);
+
+/*
+ * Write the OTUs resulting from the first clustering phase to a binary file.
+ * For each OTU, its mass, number of unique sequences, radius and members (position, parent, distance, generation) are stored.
+ * The file also describes the pools and the clustering parameters, so that it is only read for the same data and parameters.
+ */
+void outputPhase1(const std::string oFile, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc);
+
+/*
+ * Read the OTUs of the first clustering phase written by outputPhase1(...) into otus (stored in the arenas of the pools).
+ * Returns false if the file cannot be read or does not match the pools or parameters.
+ */
+bool readPhase1(const std::string iFile, const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, std::vector<OtuArena>& arenas,
+                const SwarmConfig& sc);
+
+/*
+ * Write the state of the clustering for later incremental runs: the amplicons (to <prefix>.fasta, as FASTA)
+ * and the OTUs of the first clustering phase together with a fingerprint of each pool (to <prefix>.otus).
+ */
+void outputState(const std::string prefix, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc);
+
+/*
+ * Read the first-phase OTUs of the state written by outputState(...) for all pools whose amplicons did not change
+ * since then (marked in reused). As the exploration of a pool depends only on its amplicons, these OTUs are the same
+ * as when exploring the pool again. Returns false if the state cannot be read or does not match the parameters.
+ */
+bool readState(const std::string prefix, const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, std::vector<OtuArena>& arenas,
+               std::vector<bool>& reused, const SwarmConfig& sc);
+
+/*
+ * Shard mode, coordinator: write the manifest of the pools (a first-phase file without OTUs) and the work queue
+ * (a counter of the next pool) to the shard directory.
+ * Results of earlier runs in the shard directory are removed. Returns false if the files cannot be written.
+ */
+bool shardCoordinate(const AmpliconPools& pools, const SwarmConfig& sc);
+
+/*
+ * Shard mode, worker: repeatedly take the next pool from the work queue (guarded by a file lock), explore it
+ * and write its OTUs to the file pool_<index> (first-phase format, see outputPhase1(...)) in the shard directory.
+ * Several workers can run at the same time on any node seeing the shard directory (and the same input files).
+ * Returns false if the manifest does not match the pools or the results cannot be written.
+ */
+bool shardWork(const AmpliconPools& pools, const SwarmConfig& sc);
+
+/*
+ * Shard mode, merge: read the OTUs of all pools written by the workers and continue like cluster(...)
+ * (fastidious clustering and outputs). Returns false if the results of some pools are missing or do not match.
  */
-void processOtus(const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc);
+bool shardMerge(const AmpliconPools& pools, const SwarmConfig& sc);
 
 /*
  * Cluster amplicons according to Swarm's iterative strategy and generates the requested outputs.
  * Supports also Swarm's fastidious clustering options.
  *
  * Uses a "full index" version of the segment filter and directly determines the OTUs (like Swarm).
+ * Returns false if the OTUs of the first phase could not be read (see explorePools(...)).
+ */
+bool cluster(const AmpliconPools& pools, const SwarmConfig& sc);
+
+/*
+ * First clustering phase: explore all pools (or read the OTUs written by an earlier run) according to the configured exploration mode.
+ * With an input state, only the pools changed since the run writing the state are explored.
+ * Returns false if the OTUs could not be read.
+ */
+bool explorePools(const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, std::vector<OtuArena>& arenas, const SwarmConfig& sc);
+
+/*
+ * Perform the first clustering phase once and then the fastidious clustering phase (and outputs) for each configuration in sc.sweep.
+ * The grafting is undone between the configurations by restoring the first-phase state of the OTUs.
+ * Configurations with the same fastidious threshold and the same set of light OTUs share their grafting candidates.
+ * Returns false if the OTUs of the first phase could not be read (see explorePools(...)).
+ */
+bool clusterSweep(const AmpliconPools& pools, const SwarmConfig& sc);
+
+/*
+ * Cluster amplicons for all thresholds d = 1, ..., sc.threshold and generate the requested outputs for each of them.
+ * The matches are filtered and verified only once (for the largest threshold) and kept as match graphs,
+ * from which the OTUs for each threshold are explored.
+ * The pools (built for the largest threshold) are valid for all smaller thresholds as well.
+ * Always returns true (nothing can fail here, the return value matches the other clustering variants).
  */
-void cluster(const AmpliconPools& pools, const SwarmConfig& sc);
+bool clusterMultiThreshold(const AmpliconPools& pools, const SwarmConfig& sc);
 
 /*
  * Dereplicates the amplicons and generates the requested outputs.
@@ -582,7 +898,196 @@ void cluster(const AmpliconPools& pools, const SwarmConfig& sc);
 void dereplicate(const AmpliconPools& pools, const SwarmConfig& sc);
 
 /*
- * Write the links of the given OTUs to file (corresponds to output of Swarm's option -i).
+ * Scratch space of a thread preparing outputs (DP rows for computing distances and alignments).
+ */
+struct OutputScratch {
+
+    std::vector<lenSeqs_t> M;
+    std::vector<val_t> D;
+    std::vector<val_t> P;
+    std::vector<lenSeqs_t> cntDiffs;
+    std::vector<lenSeqs_t> cntDiffsP;
+    std::vector<char> BT;
+
+};
+
+/*
+ * Fixed-width records of the binary result file written by outputBinary(...).
+ *
+ * Layout of the file: header, OTU records, member records, graft records, string table.
+ * The OTU records serve as the index of the file, i.e. the record of the i-th OTU (and via firstMember its members)
+ * can be accessed directly at offset otusOffset + i * sizeof(ResultOtu).
+ * References between records are indices (of member / graft records), strings are referenced by their offset in the string table
+ * (each string is followed by a '\0', which is not included in the stored length).
+ * All values are stored in the byte order of the writing machine.
+ */
+const char RESULT_MAGIC[4] = {'G', 'F', 'R', '1'};
+
+const uint32_t RESULT_FLAG_FASTIDIOUS = 1;
+const uint32_t RESULT_FLAG_USE_SCORE = 2;
+const uint32_t RESULT_FLAG_DEREPLICATE = 4;
+
+struct ResultHeader {
+
+    char magic[4];
+    uint32_t flags; // combination of RESULT_FLAG_...
+    uint32_t threshold;
+    uint32_t fastidiousThreshold;
+    uint64_t penMismatch; // scoring function (as in Verification::Scoring)
+    uint64_t penOpen;
+    uint64_t penExtend;
+
+    uint64_t numOtus; // number of (unattached) OTUs
+    uint64_t numMembers; // number of amplicons in all OTUs (including grafted ones)
+    uint64_t numGrafts; // number of grafted OTUs
+    uint64_t stringTableSize; // in bytes
+
+    uint64_t otusOffset; // offsets (in bytes) of the sections from the beginning of the file
+    uint64_t membersOffset;
+    uint64_t graftsOffset;
+    uint64_t stringsOffset;
+
+};
+
+struct ResultOtu {
+
+    uint64_t firstMember; // index of the member record of the seed
+    uint64_t numMembers; // number of members of the OTU itself
+    uint64_t numTotalMembers; // number of members including the grafted OTUs (stored directly after the members of the OTU itself)
+    uint64_t firstGraft; // index of the first graft record of the OTU
+    uint64_t numGrafts; // number of OTUs grafted onto the OTU
+
+    // statistics (as in the output of Swarm's option -s)
+    uint64_t mass;
+    uint64_t numUniqueSequences;
+    uint64_t seedAbundance;
+    uint64_t numSingletons; // including grafted OTUs
+    uint32_t maxGen;
+    uint32_t maxRad;
+
+};
+
+struct ResultMember {
+
+    uint64_t id; // offset of the amplicon identifier in the string table
+    uint64_t seq; // offset of the amplicon sequence in the string table
+    uint64_t abundance;
+    uint64_t parent; // index of the member record of the parent (the seed of an OTU is its own parent)
+    uint32_t idLen;
+    uint32_t seqLen;
+    uint32_t parentDist;
+    uint32_t gen;
+
+};
+
+struct ResultGraft {
+
+    uint64_t parent; // index of the member record of the grafting parent (member of the OTU itself)
+    uint64_t child; // index of the member record of the grafting child (member of the grafted OTU)
+    uint64_t firstMember; // index of the member record of the seed of the grafted OTU
+    uint64_t numMembers; // number of members of the grafted OTU
+    uint32_t dist; // distance between grafting parent and child
+    uint32_t gen; // generation number of the grafting parent + 1
+
+};
+
+/*
+ * Header of one OTU in a run of the streaming and out-of-core modes.
+ * It is followed by the member records (including grafted OTUs), the graft records and the strings of the OTU.
+ * Member and graft indices are relative to the first member record of the OTU, string offsets to the beginning of its strings.
+ */
+struct RunOtu {
+
+    uint64_t size; // size (in bytes) of the whole record, including this header
+    uint64_t seedRank; // rank of the seed amplicon (sort key of the runs)
+    ResultOtu otu; // members, grafts and statistics of the OTU
+
+};
+
+/*
+ * OTU grafted upon an OTU of another pool in the out-of-core mode.
+ * As the pool of the grafted OTU may be released before the parent OTU is written, the grafted OTU is kept in serialised form
+ * (member records and strings, indices relative to the grafted OTU) until then.
+ */
+struct SerialisedGraft {
+
+    numSeqs_t parentRank; // rank of the grafting parent (with childRank the position of the graft in the chain of the parent OTU)
+    numSeqs_t childRank; // rank of the grafting child
+    numSeqs_t parentMember; // position of the grafting parent among the members of the parent OTU
+    numSeqs_t childMember; // position of the grafting child among the members of the grafted OTU
+    uint32_t dist; // distance between grafting parent and child
+    uint32_t gen; // generation number of the grafting parent + 1
+
+    numSeqs_t mass;
+    numSeqs_t numUniqueSequences;
+    numSeqs_t numSingletons;
+
+    std::vector<ResultMember> members;
+    std::string strings;
+
+};
+
+/*
+ * Append the given unattached OTUs of one pool, sorted by the ranks of their seeds, as RunOtu records to the run.
+ * OTUs with an entry in grafts (if given) get the serialised OTUs grafted upon them (ordered like the grafting candidates).
+ */
+void writeRun(std::string& run, std::vector<Otu*>& otus, const std::unordered_map<const Otu*, std::vector<SerialisedGraft>>* grafts = 0);
+
+/*
+ * Merge the sorted runs (offset and length in runFile) by the ranks of the seeds and write the requested text outputs
+ * (-i, -o, -s, -w, -u) of the merged OTUs in batches, which are formatted concurrently for the different outputs.
+ */
+void mergeRuns(const std::string runFile, const std::vector<std::pair<uint64_t, uint64_t>>& runs, const numSeqs_t numOtus,
+               const lenSeqs_t maxLen, const SwarmConfig& sc);
+
+/*
+ * Cluster amplicons like cluster(...) but without fastidious clustering and without keeping all OTUs at the same time.
+ * sc.numExplorers threads explore the pools, write the OTUs of each pool to a sorted run in a temporary run file
+ * (named after the first requested output file) and release the pool. The runs are merged by mergeRuns(...) afterwards.
+ * Returns false if the run file cannot be written.
+ */
+bool clusterStreaming(AmpliconPools& pools, const SwarmConfig& sc);
+
+/*
+ * Cluster out-of-core pools (see Preprocessor::runOutOfCore(...)) with fastidious clustering while keeping only a window of pools in memory.
+ * With halfRange = fastidiousThreshold / (threshold + 1), the pools are processed in increasing order:
+ * after exploring pool p, the grafts of the light OTUs of pool p - halfRange are determined and resolved
+ * (all pools in their fastidious range are available) and pool p - 2 * halfRange, which is not needed by any further grafts,
+ * is written as a run (including the OTUs grafted upon its OTUs) and released. The runs are merged by mergeRuns(...) afterwards.
+ * The results are identical to cluster(...) with the checking modes 0 - 2 (modes 3 and 4 fall back to mode 0).
+ * Returns false if the run file cannot be written.
+ */
+bool clusterOutOfCore(AmpliconPools& pools, const SwarmConfig& sc);
+
+/*
+ * Write the given (sorted) OTUs to a binary result file (see ResultHeader etc. for the layout).
+ * Only unattached OTUs get an OTU record, grafted OTUs are described by the graft records of the OTU they are grafted upon.
+ */
+void outputBinary(const std::string oFile, const std::vector<Otu*>& otus, const lenSeqs_t maxLen, const SwarmConfig& sc);
+
+/*
+ * Rebuild amplicons and (unattached) OTUs from the given records (as written to a binary result file).
+ * The amplicons are stored in ampls (one per member record) and refer to the given strings, the OTUs are stored in the arena.
+ * Returns the length of the longest sequence.
+ */
+lenSeqs_t rebuildOtus(const std::vector<ResultOtu>& otuRecords, const std::vector<ResultMember>& memberRecords,
+                      const std::vector<ResultGraft>& graftRecords, std::vector<char>& strings, std::vector<Amplicon>& ampls, OtuArena& arena,
+                      std::vector<Otu*>& otus);
+
+/*
+ * Read a binary result file written by outputBinary(...) and write the requested text outputs (-i, -o, -s, -w, -u).
+ * The OTUs are rebuilt from the file such that the outputs are identical to those of the original run.
+ * The clustering and scoring parameters are taken from the file, the separators from sc.
+ */
+bool convertBinary(const std::string iFile, const SwarmConfig& sc);
+
+/*
+ * The following format...(...) functions append the lines of the unattached OTUs otus[unattached[begin]], ..., otus[unattached[end - 1]]
+ * to the given buffer. The OTU ids are derived from the positions in unattached (shifted by idOffset, if present).
+ */
+
+/*
+ * Format the links of the given OTUs (corresponds to output of Swarm's option -i).
  * Each line contains one link represented through the
  * (1) amplicon id of the parent,
  * (2) amplicon id of the child,
@@ -591,25 +1096,29 @@ void dereplicate(const AmpliconPools& pools, const SwarmConfig& sc);
  * (5) generation number of the child amplicon,
  * separated by the given separator.
  */
-void outputInternalStructures(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const SwarmConfig& sc);
+void formatInternalStructures(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                              const numSeqs_t begin, const numSeqs_t end, OutputScratch& scratch, const SwarmConfig& sc,
+                              const numSeqs_t idOffset = 0);
 
 /*
- * Writes the members of the given OTUs to file (corresponds to output of Swarm's option -o).
+ * Format the members of the given OTUs (corresponds to output of Swarm's option -o).
  * Each line contains the members of one OTU represented through amplicon id and abundance.
  * The members are separated via sep, while id and abundance are separated via sepAbundance.
  */
-void outputOtus(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const char sep, const std::string sepAbundance);
+void formatOtus(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                const numSeqs_t begin, const numSeqs_t end, const char sep, const std::string& sepAbundance);
 
 /*
- * Writes the members of the given OTUs to file (corresponds to output of Swarm's option -o with -r).
+ * Format the members of the given OTUs (corresponds to output of Swarm's option -o with -r).
  * On a single line, the members of all OTUs are represented through amplicon id and abundance.
  * The members of one OTU and the OTUs themselves are separated via sep resp. sepOtu, while id and abundance are separated via sepAbundance.
+ * The header of the line and the final line break are not part of the formatted OTUs.
  */
-void outputOtusMothur(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const lenSeqs_t threshold,
-                      const numSeqs_t numOtusAdjusted, const char sep, const std::string sepOtu, const std::string sepAbundance);
+void formatOtusMothur(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                      const numSeqs_t begin, const numSeqs_t end, const char sep, const std::string& sepOtu, const std::string& sepAbundance);
 
 /*
- * Write the statistics of the given OTUs to file (corresponds to output of Swarm's option -s).
+ * Format the statistics of the given OTUs (corresponds to output of Swarm's option -s).
  * Each line contains the statistics of one OTU represented through the
  * (1) number of unique sequences,
  * (2) mass of the OTU,
@@ -620,20 +1129,45 @@ void outputOtusMothur(const std::string oFile, const AmpliconPools& pools, const
  * (7) number of cumulated differences between the seed and the furthermost amplicon,
  * separated by the given separator.
  */
-void outputStatistics(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const char sep);
+void formatStatistics(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                      const numSeqs_t begin, const numSeqs_t end, const char sep);
 
 /*
- * Write the seeds of the given OTUs to file (corresponds to output of Swarm's option -w).
+ * Format the seeds of the given OTUs (corresponds to output of Swarm's option -w).
  * Each seed comprises two lines.
  * The first line contains the amplicon id of the seed preceded by '>' and followed by a separator and the mass of the OTU.
  * The second line describes the sequence of the seed amplicon.
  */
-void outputSeeds(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const std::string sepAbundance);
+void formatSeeds(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                 const numSeqs_t begin, const numSeqs_t end, const std::string& sepAbundance);
+
+/*
+ * Determine the radius of every member of the given OTU (not including grafted OTUs),
+ * i.e. the accumulated distances on the path from the seed to the member (an upper bound of their edit distance).
+ * The radii are stored by the position of the member in its pool.
+ */
+void computeRadii(const Otu& otu, std::unordered_map<numSeqs_t, lenSeqs_t>& rads);
+
+/*
+ * Format the uclust-like lines (C, S and one H line per member, including grafted OTUs) of one (unattached) OTU.
+ * The alignments between the members and the seed are computed with a band derived from the radii of the members.
+ */
+void formatUclustOtu(OutputBuffer& buf, const Otu& otu, const numSeqs_t otuId, OutputScratch& scratch, const SwarmConfig& sc);
+
+/*
+ * Format the clustering results of the given OTUs in a uclust-like format (corresponds to output of Swarm's option -u).
+ */
+void formatUclust(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                  const numSeqs_t begin, const numSeqs_t end, OutputScratch& scratch, const SwarmConfig& sc, const numSeqs_t idOffset = 0);
 
 /*
- * Writes the clustering results in a uclust-like format to file (corresponds to output of Swarm's option -u).
+ * Write all requested outputs (-i, -o, -s, -w, -u) of the given (sorted) OTUs to file (SwarmConfig stores information on which are requested).
+ * The unattached OTUs are split into chunks. Each pair of chunk and output is formatted into a buffer by one of sc.numWriters threads,
+ * while one thread per output file writes the buffers of the file in their original order as soon as they are complete.
+ * At most 4 * sc.numWriters chunks are formatted ahead of the slowest file.
+ * The binary result file (if requested) is written concurrently by another thread.
  */
-void outputUclust(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const SwarmConfig& sc);
+void outputResults(const std::vector<Otu*>& otus, const numSeqs_t numOtusAdjusted, const lenSeqs_t maxLen, const SwarmConfig& sc);
 
 /*
  * Write the requested dereplication outputs to file (SwarmConfig stores information on which are requested).
@@ -646,7 +1180,7 @@ void outputUclust(const std::string oFile, const AmpliconPools& pools, const std
  * -w: <no differences>
  * -u: <no differences>
  */
-void outputDereplicate(const AmpliconPools& pools, const std::vector<Otu*>& otus, const SwarmConfig& sc);
+void outputDereplicate(const std::vector<Otu*>& otus, const SwarmConfig& sc);
 }
 }
 
@@ -24,10 +24,12 @@
 #ifndef GEFAST_SWARMINGSEGMENTFILTER_HPP
 #define GEFAST_SWARMINGSEGMENTFILTER_HPP
 
+#include <atomic>
 #include <thread>
 
 #include "Base.hpp"
 #include "Buffer.hpp"
+#include "Microvariants.hpp"
 #include "Relation.hpp"
 #include "VerificationGotoh.hpp"
 #include "SwarmClustering.hpp"
@@ -198,7 +200,8 @@ void prepareIndices(const AmpliconCollection& ac, SwarmingIndices& indices,
  * Implementation of the clustering strategy proposed in:
  * Mahé et al. (2015), Swarm v2: highly-scalable and high-resolution amplicon clustering
  */
-void swarmFilter(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, const SwarmClustering::SwarmConfig& sc);
+void swarmFilter(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                  const SwarmClustering::SwarmConfig& sc);
 
 /*
  * Determine OTUs (swarms) like Swarm by using a segment filter.
@@ -210,7 +213,94 @@ void swarmFilter(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*
  * Implementation of the clustering strategy proposed in:
  * Mahé et al. (2015), Swarm v2: highly-scalable and high-resolution amplicon clustering
  */
-void swarmFilterDirectly(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, const SwarmClustering::SwarmConfig& sc);
+void swarmFilterDirectly(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                          const SwarmClustering::SwarmConfig& sc);
+
+
+/*
+ * Determine the children of the members at the positions [genBegin, genEnd) of the given member list
+ * (positions handed out through the shared counter nextPos) and store them in children[position - genBegin].
+ * Several threads (each with its own children finder) can work concurrently as long as the indices are not modified.
+ */
+void getChildrenSpeculatively(ChildrenFinder& cf, const SwarmClustering::OtuEntry* members,
+                              const numSeqs_t genBegin, const numSeqs_t genEnd, std::atomic<numSeqs_t>& nextPos,
+                              std::vector<std::vector<std::pair<numSeqs_t, lenSeqs_t>>>& children, const bool twoWay);
+
+/*
+ * Determine OTUs (swarms) like Swarm by using a segment filter.
+ *
+ * Variant of swarmFilterDirectly(...) for large swarms.
+ * As soon as a generation is complete, the children of all its members are computed concurrently
+ * (sc.numThreadsPerExplorer threads) against the indices as they are at the start of the generation.
+ * The children are then committed sequentially in the usual order, skipping amplicons that have been visited in the meantime.
+ * The resulting OTUs are identical to those of swarmFilterDirectly(...).
+ */
+void swarmFilterSpeculative(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                             const SwarmClustering::SwarmConfig& sc);
+
+/*
+ * Determine the not yet visited children of the amplicon at position id for threshold 1 (without scoring function)
+ * by looking up its microvariants (and, for inputs that are not dereplicated, its own sequence) in the sequence table of the pool.
+ * The found amplicons are exact matches, so no verification is necessary.
+ * labels and buf (capacity at least maxLen + 2) are reused as auxiliary storage.
+ */
+void getChildrenMicrovariants(const numSeqs_t id, std::vector<std::pair<numSeqs_t, lenSeqs_t>>& children, const AmpliconCollection& ac,
+                              const Microvariants::SequenceTable& table, Microvariants::MicrovariantGenerator& gen,
+                              std::vector<numSeqs_t>& labels, std::vector<char>& buf, const std::vector<bool>& visited,
+                              const SwarmClustering::SwarmConfig& sc);
+
+/*
+ * Determine OTUs (swarms) like Swarm for threshold 1 by enumerating microvariants instead of using a segment filter.
+ *
+ * The sequences of the pool are hashed (64-bit) once and the children of an amplicon are found
+ * by looking up the hashes of its microvariants (see getChildrenMicrovariants(...)).
+ * The resulting OTUs are identical to those of swarmFilterDirectly(...).
+ *
+ * Implementation of the d = 1 strategy proposed in:
+ * Mahé et al. (2015), Swarm v2: highly-scalable and high-resolution amplicon clustering
+ */
+void swarmMicrovariants(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                        const SwarmClustering::SwarmConfig& sc);
+
+/*
+ * Query the indexed amplicons taken from the shared counter nextId (in small chunks) and
+ * merge every verified link into the union-find structure.
+ * Links are only searched towards less abundant amplicons (larger index) and only if both amplicons
+ * are not yet known to be in the same component.
+ * The indices are only read, so that several threads can work on them concurrently.
+ */
+void linkComponents(const AmpliconCollection& ac, SwarmingIndices& indices,
+                    std::unordered_map<lenSeqs_t, std::unordered_map<lenSeqs_t, std::vector<Substrings>>>& substrsArchive,
+                    ConcurrentUnionFind& uf, std::atomic<numSeqs_t>& nextId, const SwarmClustering::SwarmConfig& sc);
+
+/*
+ * Determine the connected components of the match graph (edit distance / number of differences at most the threshold)
+ * by a similarity join on the full index of the collection performed by the given number of threads.
+ * Each component is described by the sorted indices of its amplicons.
+ * The components are ordered by their smallest index.
+ */
+std::vector<std::vector<numSeqs_t>> determineComponents(const AmpliconCollection& ac, const SwarmClustering::SwarmConfig& sc,
+                                                        const unsigned long numThreads);
+
+/*
+ * Explore the components in the order given by schedule (positions handed out through the shared counter nextComp).
+ * Each component is copied into a collection of its own and explored by swarmFilterDirectly(...).
+ * The members of the resulting OTUs refer to the amplicons in the original collection and are stored in the given arena.
+ */
+void exploreComponents(const AmpliconCollection& ac, const std::vector<std::vector<numSeqs_t>>& components,
+                       const std::vector<numSeqs_t>& schedule, std::atomic<numSeqs_t>& nextComp,
+                       std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena, const SwarmClustering::SwarmConfig& sc);
+
+/*
+ * Determine OTUs (swarms) like Swarm by using a segment filter.
+ *
+ * Swarms never cross the borders of the connected components of the match graph.
+ * Therefore, the components are determined first (see determineComponents) and then explored independently
+ * from each other by multiple threads (sc.numExplorers threads for both steps).
+ * The resulting OTUs (and their order) are identical to those of swarmFilterDirectly(...).
+ */
+void swarmFilterComponents(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                            const SwarmClustering::SwarmConfig& sc);
 
 }
 }
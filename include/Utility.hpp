@@ -42,41 +42,61 @@ const std::string DEFAULT_JOB_NAME = "GeFaST";
 // list of configuration parameters (changes should be mirrored in method initParamNames() of Config)
 enum ConfigParameters {
     ALPHABET,                           // allowed alphabet for the amplicon sequences
+    ASSIGN_OUTPUT_FILE,                 // name of the output file containing the best hit of every query (assignment mode)
+    ASSIGN_REFERENCE_FILE,              // name of the file with the reference amplicons to which the input amplicons are assigned (instead of clustering)
     CONFIG_FILE,                        // config file used to load (parts of) the configuration
     FILE_LIST,                          // file containing list of input file names
     FILTER_ALPHABET,                    // flag for the alphabet filter
     FILTER_LENGTH,                      // flag for the length filter
     FILTER_REGEX,                       // flag for the regex filter
+    ID_STORAGE_FILE,                    // name of the (memory-mapped) file storing the amplicon identifiers
     INFO_FOLDER,                        // name of the folder for storing files showing the configuration information of the current job
+    MATCHES_OUTPUT_BINARY,              // flag indicating whether the matches are written in binary form (instead of as text)
     MATCHES_OUTPUT_FILE,                // name of the output file containing all matches found
     MAX_LENGTH,                         // maximal sequence length
     MIN_LENGTH,                         // minimal sequence length
     NAME,                               // name of the job to be executed
     NUM_EXTRA_SEGMENTS,                 // parameter of the pigeonhole principle (segment filter)
 //    NUM_THREADS_PER_WORKER,             // number of parallel threads employed by each work
-//    NUM_WORKERS,                        // number of parallel workers
+    NUM_WORKERS,                        // number of parallel workers (similarity join)
     PREPROCESSING_ONLY,                 // flag indicating whether only the preprocessing step should be executed
     SEGMENT_FILTER,                     // mode of the segment filter (forward, backward, forward-backward, backward-forward)
     SEPARATOR_ABUNDANCE,                // seperator symbol (string) between ID and abundance in a FASTA header line
+    SERVICE_NUM_JOBS,                   // number of jobs processed concurrently in the service mode
+    SERVICE_SOCKET,                     // path of the Unix socket on which the service mode accepts requests
+    SPILL_FILE,                         // name of the spill file storing the pools in the out-of-core mode
     SWARM_BOUNDARY,                     // minimum mass of a heavy OTU, used only during fastidious swarming
     SWARM_DEREPLICATE,                  // boolean flag indicating demand for dereplication, corresponds to Swarm with -d 0
+    SWARM_EXPLORATION_MODE,             // mode of exploring the pools in the first clustering phase (pool-wise, component-parallel, speculative)
     SWARM_FASTIDIOUS,                   // boolean flag indicating demand for second, fastidious swarming phase, corresponds to Swarm's -f
     SWARM_FASTIDIOUS_CHECKING_MODE,     // mode of checking for grafting candidates of one pool (affects degree of parallelism)
     SWARM_FASTIDIOUS_THRESHOLD,         // (edit distance) threshold for the fastidious clustering phase
     SWARM_GAP_EXTENSION_PENALTY,        // penalty for extending a gap
     SWARM_GAP_OPENING_PENALTY,          // penalty for opening a gap
+    SWARM_INPUT_BINARY,                 // name of the binary result file to be converted into the requested text outputs (instead of clustering)
+    SWARM_INPUT_PHASE1,                 // name of the file from which the OTUs of the first clustering phase are read (instead of exploring the pools)
+    SWARM_INPUT_STATE,                  // prefix of the state of an earlier run whose amplicons are added to the input and whose unchanged pools are not explored again
     SWARM_MATCH_REWARD,                 // reward for a nucleotide match
     SWARM_MISMATCH_PENALTY,             // penalty for a nucleotide mismatch
     SWARM_MOTHUR,                       // boolean flag indicating demand for output format compatible with mothur, corresponds to Swarm's option -r
+    SWARM_MULTI_THRESHOLD,              // boolean flag indicating demand for results for all thresholds 1, ..., THRESHOLD from a single filtering pass
     SWARM_NO_OTU_BREAKING,              // boolean flag indicating usage of OTU breaking, corresponds to Swarm's option -n
     SWARM_NUM_EXPLORERS,                // number of parallel explorers (first Swarm clustering phase)
     SWARM_NUM_GRAFTERS,                 // number of parallel grafters (second Swarm clustering phase)
     SWARM_NUM_THREADS_PER_CHECK,        // number of parallel threads employed by (one call of) checkAndVerify()
+    SWARM_NUM_WRITERS,                  // number of parallel threads preparing the outputs
+    SWARM_OUTPUT_BINARY,                // name of the binary result file (OTUs, members, links, grafts and statistics with random access by OTU)
     SWARM_OUTPUT_INTERNAL,              // name of the output file corresponding to Swarm's output option -i (internal structures)
     SWARM_OUTPUT_OTUS,                  // name of the output file corresponding to Swarm's output option -o (OTUs)
+    SWARM_OUTPUT_PHASE1,                // name of the file to which the OTUs of the first clustering phase are written (binary)
     SWARM_OUTPUT_STATISTICS,            // name of the output file corresponding to Swarm's output option -s (statistics file)
     SWARM_OUTPUT_SEEDS,                 // name of the output file corresponding to Swarm's output option -w (seeds)
+    SWARM_OUTPUT_STATE,                 // prefix of the state (amplicons and first-phase OTUs) written for later incremental runs
     SWARM_OUTPUT_UCLUST,                // name of the output file corresponding to Swarm's output option -u (uclust)
+    SWARM_SHARD_DIR,                    // directory (on a shared file system) holding manifest, work queue and per-pool results of the shard mode
+    SWARM_SHARD_ROLE,                   // role of the process in the shard mode (coordinator, worker or merge)
+    SWARM_STREAMING,                    // boolean flag indicating demand for writing sorted per-pool runs and merging them (only without fastidious clustering)
+    SWARM_SWEEP,                        // list of (boundary, fastidious threshold) combinations (parameter sweep), written as b1:f1,b2:f2,...
     THRESHOLD,                          // (edit distance) threshold for the clustering
     USE_SCORE,                          // flag indicating whether to use an actual scoring function (not the edit distance)
     VERSION                             // version number of the program
@@ -185,41 +205,61 @@ private:
         paramNames_ = std::map<std::string, ConfigParameters>(
                 {
                         {"ALPHABET",                          ALPHABET},
+                        {"ASSIGN_OUTPUT_FILE",                ASSIGN_OUTPUT_FILE},
+                        {"ASSIGN_REFERENCE_FILE",             ASSIGN_REFERENCE_FILE},
                         {"CONFIG_FILE",                       CONFIG_FILE},
                         {"FILE_LIST",                         FILE_LIST},
                         {"FILTER_ALPHABET",                   FILTER_ALPHABET},
                         {"FILTER_LENGTH",                     FILTER_LENGTH},
                         {"FILTER_REGEX",                      FILTER_REGEX},
+                        {"ID_STORAGE_FILE",                   ID_STORAGE_FILE},
                         {"INFO_FOLDER",                       INFO_FOLDER},
+                        {"MATCHES_OUTPUT_BINARY",             MATCHES_OUTPUT_BINARY},
                         {"MATCHES_OUTPUT_FILE",               MATCHES_OUTPUT_FILE},
                         {"MAX_LENGTH",                        MAX_LENGTH},
                         {"MIN_LENGTH",                        MIN_LENGTH},
                         {"NAME",                              NAME},
                         {"NUM_EXTRA_SEGMENTS",                NUM_EXTRA_SEGMENTS},
 //                        {"NUM_THREADS_PER_WORKER",            NUM_THREADS_PER_WORKER},
-//                        {"NUM_WORKERS",                       NUM_WORKERS},
+                        {"NUM_WORKERS",                       NUM_WORKERS},
                         {"PREPROCESSING_ONLY",                PREPROCESSING_ONLY},
                         {"SEGMENT_FILTER",                    SEGMENT_FILTER},
                         {"SEPARATOR_ABUNDANCE",               SEPARATOR_ABUNDANCE},
+                        {"SERVICE_NUM_JOBS",                  SERVICE_NUM_JOBS},
+                        {"SERVICE_SOCKET",                    SERVICE_SOCKET},
+                        {"SPILL_FILE",                        SPILL_FILE},
                         {"SWARM_BOUNDARY",                    SWARM_BOUNDARY},
                         {"SWARM_DEREPLICATE",                 SWARM_DEREPLICATE},
+                        {"SWARM_EXPLORATION_MODE",            SWARM_EXPLORATION_MODE},
                         {"SWARM_FASTIDIOUS",                  SWARM_FASTIDIOUS},
                         {"SWARM_FASTIDIOUS_CHECKING_MODE",    SWARM_FASTIDIOUS_CHECKING_MODE},
                         {"SWARM_FASTIDIOUS_THRESHOLD",        SWARM_FASTIDIOUS_THRESHOLD},
                         {"SWARM_GAP_EXTENSION_PENALTY",       SWARM_GAP_EXTENSION_PENALTY},
                         {"SWARM_GAP_OPENING_PENALTY",         SWARM_GAP_OPENING_PENALTY},
+                        {"SWARM_INPUT_BINARY",                SWARM_INPUT_BINARY},
+                        {"SWARM_INPUT_PHASE1",                SWARM_INPUT_PHASE1},
+                        {"SWARM_INPUT_STATE",                 SWARM_INPUT_STATE},
                         {"SWARM_MATCH_REWARD",                SWARM_MATCH_REWARD},
                         {"SWARM_MISMATCH_PENALTY",            SWARM_MISMATCH_PENALTY},
                         {"SWARM_MOTHUR",                      SWARM_MOTHUR},
+                        {"SWARM_MULTI_THRESHOLD",             SWARM_MULTI_THRESHOLD},
                         {"SWARM_NO_OTU_BREAKING",             SWARM_NO_OTU_BREAKING},
                         {"SWARM_NUM_EXPLORERS",               SWARM_NUM_EXPLORERS},
                         {"SWARM_NUM_GRAFTERS",                SWARM_NUM_GRAFTERS},
                         {"SWARM_NUM_THREADS_PER_CHECK",       SWARM_NUM_THREADS_PER_CHECK},
+                        {"SWARM_NUM_WRITERS",                 SWARM_NUM_WRITERS},
+                        {"SWARM_OUTPUT_BINARY",               SWARM_OUTPUT_BINARY},
                         {"SWARM_OUTPUT_INTERNAL",             SWARM_OUTPUT_INTERNAL},
                         {"SWARM_OUTPUT_OTUS",                 SWARM_OUTPUT_OTUS},
                         {"SWARM_OUTPUT_STATISTICS",           SWARM_OUTPUT_STATISTICS},
+                        {"SWARM_OUTPUT_PHASE1",               SWARM_OUTPUT_PHASE1},
                         {"SWARM_OUTPUT_SEEDS",                SWARM_OUTPUT_SEEDS},
+                        {"SWARM_OUTPUT_STATE",                SWARM_OUTPUT_STATE},
                         {"SWARM_OUTPUT_UCLUST",               SWARM_OUTPUT_UCLUST},
+                        {"SWARM_SHARD_DIR",                   SWARM_SHARD_DIR},
+                        {"SWARM_SHARD_ROLE",                  SWARM_SHARD_ROLE},
+                        {"SWARM_STREAMING",                   SWARM_STREAMING},
+                        {"SWARM_SWEEP",                       SWARM_SWEEP},
                         {"THRESHOLD",                         THRESHOLD},
                         {"USE_SCORE",                         USE_SCORE},
                         {"VERSION",                           VERSION}
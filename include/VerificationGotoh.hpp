@@ -195,6 +195,29 @@ AlignmentInformation computeGotohCigarRow(const char* s, const lenSeqs_t lenS, c
 AlignmentInformation computeGotohCigarRow1(const char* s, const lenSeqs_t lenS, const char* t, const lenSeqs_t lenT, const Scoring& scoring,
                                            val_t* D, val_t* P, char* BT);
 
+/*
+ * Fills the band of half-width w (around the main diagonal) of the matrices used by computeGotohCigarBanded(...)
+ * and returns the optimal score of the alignments within the band.
+ * Cells outside of the band are treated as unreachable.
+ * BT has to provide (lenS + 1) * (2 * w + 1) cells, D and P lenT + 1 cells.
+ */
+val_t fillGotohBanded(const char* s, const lenSeqs_t lenS, const char* t, const lenSeqs_t lenT, const Scoring& scoring,
+                      const lenSeqs_t w, val_t* D, val_t* P, char* BT);
+
+/*
+ * Computes the same optimal global alignment as computeGotohCigarRow1(...) (including the resolution of ties),
+ * but fills the backtracking matrix only in a band of half-width w around the main diagonal.
+ *
+ * An alignment with k gaps (insertions / deletions) stays within a band of half-width k and has a score of at least k * penExtend.
+ * The initial width is derived from the given bound on the number of differences between s and t.
+ * If the score obtained inside the band could still be matched by an alignment leaving the band,
+ * the band is widened accordingly and the computation is repeated (at most once).
+ *
+ * The auxiliary vectors are resized as needed and can be reused between calls (e.g. one set per thread).
+ */
+AlignmentInformation computeGotohCigarBanded(const char* s, const lenSeqs_t lenS, const char* t, const lenSeqs_t lenT, const Scoring& scoring,
+                                             const lenSeqs_t bound, std::vector<val_t>& D, std::vector<val_t>& P, std::vector<char>& BT);
+
 }
 }
 
@@ -23,13 +23,18 @@
 
 #include <ctime>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <thread>
 #include <vector>
 
+#include "include/Assignment.hpp"
 #include "include/Base.hpp"
 #include "include/Preprocessor.hpp"
 #include "include/Relation.hpp"
+#include "include/Service.hpp"
 #include "include/SIMD.hpp"
+#include "include/SimilarityJoin.hpp"
 #include "include/SwarmClustering.hpp"
 #include "include/Utility.hpp"
 
@@ -61,7 +66,8 @@ int run(int argc, const char* argv[]) {
 
     Config<std::string> c = getConfiguration(argc, argv);
 #if QGRAM_FILTER
-    cpu_features_detect();
+    static std::once_flag detected; // jobs of the service mode run concurrently
+    std::call_once(detected, cpu_features_detect);
 #endif
 
 
@@ -83,15 +89,20 @@ int run(int argc, const char* argv[]) {
     }
 
 
-    if (files.size() == 0) {
+    // the amplicons of an input state are read like an additional input file
+    if (c.peek(SWARM_INPUT_STATE)) files.push_back(c.get(SWARM_INPUT_STATE) + ".fasta");
+
+    bool service = c.peek(SERVICE_SOCKET);
+    if (files.size() == 0 && !c.peek(SWARM_INPUT_BINARY) && !service) {
 
         std::cerr << "ERROR: No input files specified." << std::endl;
         return 1;
 
     }
-    if (!((c.get(PREPROCESSING_ONLY) == "1") || c.peek(MATCHES_OUTPUT_FILE) || c.peek(SWARM_OUTPUT_INTERNAL) ||
+    bool shardWithoutOutputs = c.peek(SWARM_SHARD_ROLE) && (c.get(SWARM_SHARD_ROLE) == "coordinator" || c.get(SWARM_SHARD_ROLE) == "worker");
+    if (!((c.get(PREPROCESSING_ONLY) == "1") || shardWithoutOutputs || service || c.peek(MATCHES_OUTPUT_FILE) || c.peek(SWARM_OUTPUT_INTERNAL) ||
             c.peek(SWARM_OUTPUT_OTUS) || c.peek(SWARM_OUTPUT_STATISTICS) || c.peek(SWARM_OUTPUT_SEEDS) ||
-            c.peek(SWARM_OUTPUT_UCLUST))) {
+            c.peek(SWARM_OUTPUT_UCLUST) || c.peek(SWARM_OUTPUT_PHASE1) || c.peek(SWARM_OUTPUT_BINARY) || c.peek(SWARM_OUTPUT_STATE) || c.peek(ASSIGN_OUTPUT_FILE))) {
 
         std::cerr << "ERROR: No output file specified." << std::endl;
         return 1;
@@ -115,11 +126,13 @@ int run(int argc, const char* argv[]) {
     sc.sepAbundance = c.get(SEPARATOR_ABUNDANCE);
     sc.extraSegs = std::stoul(c.get(NUM_EXTRA_SEGMENTS));
     sc.filterTwoWay = (std::stoul(c.get(SEGMENT_FILTER)) == 2) || (std::stoul(c.get(SEGMENT_FILTER)) == 3);
+    sc.explorationMode = std::stoul(c.get(SWARM_EXPLORATION_MODE));
     sc.numExplorers = std::stoul(c.get(SWARM_NUM_EXPLORERS));
     sc.numThreadsPerExplorer = std::stoul(c.get(SWARM_NUM_THREADS_PER_CHECK));
     sc.numGrafters = std::stoul(c.get(SWARM_NUM_GRAFTERS));
     sc.fastidiousCheckingMode = std::stoul(c.get(SWARM_FASTIDIOUS_CHECKING_MODE));
     sc.numThreadsPerCheck = std::stoul(c.get(SWARM_NUM_THREADS_PER_CHECK));
+    sc.numWriters = std::max(1UL, std::stoul(c.get(SWARM_NUM_WRITERS)));
     sc.threshold = std::stoul(c.get(THRESHOLD));
 
     if (sc.threshold <= 0 && !sc.dereplicate) { // check for feasible threshold unless dereplication is chosen
@@ -135,7 +148,10 @@ int run(int argc, const char* argv[]) {
         sc.fastidiousThreshold = 2 * sc.threshold;
 
     } else {
+
         sc.fastidiousThreshold = std::stoul(c.get(SWARM_FASTIDIOUS_THRESHOLD));
+        sc.explicitFastidiousThreshold = true;
+
     }
 
     if (sc.dereplicate) { // fastidious option pointless when dereplicating or matching with distance 0
@@ -149,12 +165,133 @@ int run(int argc, const char* argv[]) {
     }
 
     sc.fastidious = (c.get(SWARM_FASTIDIOUS) == "1");
+    sc.multiThreshold = (c.get(SWARM_MULTI_THRESHOLD) == "1");
+    sc.outPhase1 = c.peek(SWARM_OUTPUT_PHASE1);
+    if (sc.outPhase1) sc.oFilePhase1 = c.get(SWARM_OUTPUT_PHASE1);
+    sc.inPhase1 = c.peek(SWARM_INPUT_PHASE1);
+    if (sc.inPhase1) sc.iFilePhase1 = c.get(SWARM_INPUT_PHASE1);
+    sc.outBinary = c.peek(SWARM_OUTPUT_BINARY);
+    if (sc.outBinary) sc.oFileBinary = c.get(SWARM_OUTPUT_BINARY);
+    sc.inBinary = c.peek(SWARM_INPUT_BINARY);
+    if (sc.inBinary) sc.iFileBinary = c.get(SWARM_INPUT_BINARY);
+    sc.outState = c.peek(SWARM_OUTPUT_STATE);
+    if (sc.outState) sc.oPrefixState = c.get(SWARM_OUTPUT_STATE);
+    sc.inState = c.peek(SWARM_INPUT_STATE);
+    if (sc.inState) sc.iPrefixState = c.get(SWARM_INPUT_STATE);
+    sc.streaming = (c.get(SWARM_STREAMING) == "1");
+    sc.outOfCore = c.peek(SPILL_FILE);
+    if (c.peek(SWARM_SHARD_ROLE)) sc.shardRole = c.get(SWARM_SHARD_ROLE);
+    if (c.peek(SWARM_SHARD_DIR)) sc.shardDir = c.get(SWARM_SHARD_DIR);
+
+    if (c.peek(SWARM_SWEEP)) { // list of b1:f1,b2:f2,...
+
+        std::stringstream sStream(c.get(SWARM_SWEEP));
+        std::string entry;
+        while (std::getline(sStream, entry, ',')) {
+
+            auto delimPos = entry.find(':');
+            if (delimPos == std::string::npos || std::stoul(entry.substr(delimPos + 1)) == 0) {
+
+                std::cerr << "ERROR: Invalid entry '" << entry << "' in parameter sweep (expected <boundary>:<fastidious threshold>)." << std::endl;
+                return 1;
+
+            }
+
+            sc.sweep.push_back(std::make_pair(std::stoul(entry.substr(0, delimPos)), std::stoul(entry.substr(delimPos + 1))));
+
+        }
+
+        if (sc.multiThreshold) {
+
+            std::cerr << "ERROR: Parameter sweep and multi-threshold clustering cannot be combined." << std::endl;
+            return 1;
+
+        }
+
+    }
     sc.boundary = std::stoul(c.get(SWARM_BOUNDARY));
 
+    if (!sc.shardRole.empty()) {
+
+        if (sc.shardRole != "coordinator" && sc.shardRole != "worker" && sc.shardRole != "merge") {
+
+            std::cerr << "ERROR: Unknown shard role '" << sc.shardRole << "' (expected coordinator, worker or merge)." << std::endl;
+            return 1;
+
+        }
+
+        if (sc.shardDir.empty()) {
+
+            std::cerr << "ERROR: The shard mode requires a shard directory." << std::endl;
+            return 1;
+
+        }
+
+        if (sc.multiThreshold || !sc.sweep.empty() || sc.dereplicate || sc.inPhase1 || sc.streaming || sc.outOfCore
+            || c.peek(MATCHES_OUTPUT_FILE) || sc.inState || sc.outState) {
+
+            std::cerr << "ERROR: The shard mode cannot be combined with multi-threshold clustering, parameter sweeps, dereplication, "
+                      << "first-phase input, streaming, the out-of-core mode, matches output or states." << std::endl;
+            return 1;
+
+        }
+
+    }
+
+    if (sc.inState && sc.inPhase1) {
+
+        std::cerr << "ERROR: An input state and first-phase input cannot be combined." << std::endl;
+        return 1;
+
+    }
+
+    if ((sc.inState || sc.outState) && (sc.multiThreshold || sc.dereplicate)) {
+
+        std::cerr << "WARNING: Incremental clustering is not available with multi-threshold clustering or dereplication. "
+                  << "Exploring all pools (including the amplicons of the input state) and writing no state instead." << std::endl;
+        sc.inState = sc.outState = false;
+
+    }
+
+    if (sc.outOfCore && (sc.multiThreshold || !sc.sweep.empty() || sc.dereplicate || sc.outPhase1 || sc.inPhase1 || sc.outBinary
+                         || c.peek(MATCHES_OUTPUT_FILE) || sc.inState || sc.outState)) {
+
+        std::cerr << "WARNING: The out-of-core mode is not available with multi-threshold clustering, parameter sweeps, dereplication, "
+                  << "first-phase files, binary results, matches output or states. Keeping all pools in memory instead." << std::endl;
+        sc.outOfCore = false;
+
+    }
+
+    if (sc.streaming && (sc.fastidious || sc.multiThreshold || sc.dereplicate || sc.outPhase1 || sc.inPhase1 || sc.outBinary
+                         || sc.inState || sc.outState)) {
+
+        std::cerr << "WARNING: Streaming is not available with fastidious clustering, multi-threshold clustering, dereplication, "
+                  << "first-phase files, binary results or states. Clustering all pools at once instead." << std::endl;
+        sc.streaming = false;
+
+    }
+
     sc.useScore = (c.get(USE_SCORE) == "1");
     sc.scoring = Verification::Scoring(std::stoull(c.get(SWARM_MATCH_REWARD)), std::stoll(c.get(SWARM_MISMATCH_PENALTY)),
                                        std::stoll(c.get(SWARM_GAP_OPENING_PENALTY)), std::stoll(c.get(SWARM_GAP_EXTENSION_PENALTY)));
 
+    SimilarityJoin::JoinConfig jc;
+    if (c.peek(MATCHES_OUTPUT_FILE)) jc.oFile = c.get(MATCHES_OUTPUT_FILE);
+    jc.binary = (c.get(MATCHES_OUTPUT_BINARY) == "1");
+    jc.threshold = sc.threshold;
+    jc.extraSegs = sc.extraSegs;
+    jc.filterMode = std::stoi(c.get(SEGMENT_FILTER));
+    jc.useScore = sc.useScore;
+    jc.scoring = sc.scoring;
+    jc.numWorkers = std::stoul(c.get(NUM_WORKERS));
+
+    if (jc.numWorkers == 0) {
+
+        std::cerr << "ERROR: At least one worker is required." << std::endl;
+        return 1;
+
+    }
+
     std::cout << "===== Configuration =====" << std::endl;
     c.print(std::cout);
     std::cout << "=========================" << std::endl << std::endl;
@@ -163,9 +300,83 @@ int run(int argc, const char* argv[]) {
     if (c.peek(INFO_FOLDER)) writeJobParameters(c.get(INFO_FOLDER) + jobName + ".txt", c, files);
 
 
+    /* ===== Conversion of binary results (no clustering) ===== */
+
+    if (sc.inBinary) {
+
+        bool success = SwarmClustering::convertBinary(sc.iFileBinary, sc);
+        std::cout << "Computation finished." << std::endl;
+
+        return success ? 0 : 1;
+
+    }
+
+
+    /* ===== Service mode (requests arrive on a socket) ===== */
+
+    Assignment::AssignConfig ac;
+    if (c.peek(ASSIGN_OUTPUT_FILE)) ac.oFile = c.get(ASSIGN_OUTPUT_FILE);
+    ac.sepAbundance = sc.sepAbundance;
+    ac.threshold = sc.threshold;
+    ac.extraSegs = sc.extraSegs;
+    ac.useScore = sc.useScore;
+    ac.scoring = sc.scoring;
+    ac.numWorkers = jc.numWorkers;
+
+    if (service) {
+
+        Service::ServiceConfig svc;
+        svc.socketPath = c.get(SERVICE_SOCKET);
+        svc.numJobs = std::max(1UL, std::stoul(c.get(SERVICE_NUM_JOBS)));
+
+        AmpliconPools* refPools = 0;
+        if (c.peek(ASSIGN_REFERENCE_FILE)) {
+
+            refPools = Preprocessor::run(c, std::vector<std::string>(1, c.get(ASSIGN_REFERENCE_FILE)));
+            if (refPools == 0) return 1;
+
+        }
+
+        bool success = Service::serve(c, refPools, ac, svc, &run);
+
+        std::cout << "Cleaning up..." << std::endl;
+        delete refPools;
+        std::cout << "Computation finished." << std::endl;
+
+        return success ? 0 : 1;
+
+    }
+
+
+    /* ===== Assignment to reference amplicons (no clustering) ===== */
+
+    if (c.peek(ASSIGN_REFERENCE_FILE)) {
+
+        if (!c.peek(ASSIGN_OUTPUT_FILE)) {
+
+            std::cerr << "ERROR: The assignment mode requires an output file." << std::endl;
+            return 1;
+
+        }
+
+        auto refPools = Preprocessor::run(c, std::vector<std::string>(1, c.get(ASSIGN_REFERENCE_FILE)));
+        if (refPools == 0) return 1;
+
+        bool success = Assignment::assign(c, *refPools, files, ac);
+
+        std::cout << "Cleaning up..." << std::endl;
+        delete refPools;
+        std::cout << "Computation finished." << std::endl;
+
+        return success ? 0 : 1;
+
+    }
+
+
     /* ===== Preprocessing ===== */
 
-    auto pools = Preprocessor::run(c, files);
+    auto pools = (sc.outOfCore) ? Preprocessor::runOutOfCore(c, files, c.get(SPILL_FILE)) : Preprocessor::run(c, files);
+    if (pools == 0) return 1;
 
     if (c.get(PREPROCESSING_ONLY) == "1") {
 
@@ -178,12 +389,49 @@ int run(int argc, const char* argv[]) {
     }
 
 
+    /* ===== Sharded clustering ===== */
+
+    if (!sc.shardRole.empty()) {
+
+        bool success = (sc.shardRole == "coordinator") ? SwarmClustering::shardCoordinate(*pools, sc)
+                       : (sc.shardRole == "worker") ? SwarmClustering::shardWork(*pools, sc)
+                       : SwarmClustering::shardMerge(*pools, sc);
+
+        std::cout << "Cleaning up..." << std::endl;
+        delete pools;
+        std::cout << "Computation finished." << std::endl;
+
+        return success ? 0 : 1;
+
+    }
+
+
+    /* ===== Similarity join ===== */
+
+    if (c.peek(MATCHES_OUTPUT_FILE)) {
+        SimilarityJoin::join(*pools, jc);
+    }
+
+
     /* ===== Clustering resp. dereplication ===== */
 
-    if (sc.dereplicate) {
-        SwarmClustering::dereplicate(*pools, sc);
-    } else {
-        SwarmClustering::cluster(*pools, sc);
+    bool success = true;
+    if (sc.outInternals || sc.outOtus || sc.outStatistics || sc.outSeeds || sc.outUclust || sc.outPhase1 || sc.outBinary || sc.outState) {
+
+        if (sc.dereplicate) {
+            SwarmClustering::dereplicate(*pools, sc);
+        } else if (sc.multiThreshold) {
+            success = SwarmClustering::clusterMultiThreshold(*pools, sc);
+        } else if (!sc.sweep.empty()) {
+            success = SwarmClustering::clusterSweep(*pools, sc);
+        } else if (sc.outOfCore && sc.fastidious) {
+            success = SwarmClustering::clusterOutOfCore(*pools, sc);
+        } else if (sc.streaming || sc.outOfCore) {
+            success = SwarmClustering::clusterStreaming(*pools, sc);
+        } else {
+            success = SwarmClustering::cluster(*pools, sc);
+        }
+
     }
 
 
@@ -193,7 +441,7 @@ int run(int argc, const char* argv[]) {
     delete pools;
     std::cout << "Computation finished." << std::endl;
 
-    return 0;
+    return success ? 0 : 1;
 
 }
 
@@ -202,6 +450,6 @@ int run(int argc, const char* argv[]) {
 
 int main(int argc, const char* argv[]) {
 
-    GeFaST::run(argc, argv);
+    return GeFaST::run(argc, argv);
 
 }
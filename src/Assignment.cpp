@@ -0,0 +1,422 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#include "../include/Assignment.hpp"
+#include "../include/Preprocessor.hpp"
+#include "../include/SIMD.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <thread>
+
+namespace GeFaST {
+
+AmpliconCollection* Assignment::indexReferences(const AmpliconPools& pools, ReferenceIndices& indices, const AssignConfig& ac) {
+
+    std::map<lenSeqs_t, numSeqs_t> lengths;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+
+        AmpliconCollection* pool = pools.get(p);
+        for (auto iter = pool->begin(); iter != pool->end(); iter++) {
+            lengths[iter->len]++;
+        }
+
+    }
+
+    std::vector<std::pair<lenSeqs_t, numSeqs_t>> counts(lengths.begin(), lengths.end());
+    AmpliconCollection* refs = new AmpliconCollection(pools.numAmplicons(), counts);
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+
+        AmpliconCollection* pool = pools.get(p);
+        for (auto iter = pool->begin(); iter != pool->end(); iter++) {
+            refs->push_back(*iter);
+        }
+
+    }
+    std::stable_sort(refs->begin(), refs->end(), AmpliconCompareLen());
+
+    std::vector<numSeqs_t> groupStarts; // position of the first amplicon of each length
+    numSeqs_t start = 0;
+    for (auto& c : counts) {
+
+        groupStarts.push_back(start);
+        start += c.second;
+        indices.roll(c.first); // create all rows beforehand, so that the indexing threads only modify disjoint rows
+
+    }
+
+    std::atomic<numSeqs_t> nextLength(0);
+    auto indexLengths = [&]() {
+
+        Segments segments(ac.threshold + ac.extraSegs);
+        for (numSeqs_t g = nextLength++; g < counts.size(); g = nextLength++) {
+
+            selectSegments(segments, counts[g].first, ac.threshold, ac.extraSegs);
+            auto& row = indices.getIndicesRow(counts[g].first);
+
+            for (numSeqs_t label = groupStarts[g]; label < groupStarts[g] + counts[g].second; label++) {
+                for (lenSeqs_t i = 0; i < ac.threshold + ac.extraSegs; i++) {
+                    row[i].add(StringIteratorPair((*refs)[label].seq + segments[i].first,
+                                                  (*refs)[label].seq + segments[i].first + segments[i].second), label);
+                }
+            }
+
+        }
+
+    };
+
+    std::thread workers[ac.numWorkers];
+    for (unsigned long w = 0; w < ac.numWorkers; w++) {
+        workers[w] = std::thread(indexLengths);
+    }
+    for (unsigned long w = 0; w < ac.numWorkers; w++) {
+        workers[w].join();
+    }
+
+    return refs;
+
+}
+
+bool Assignment::bestHit(const Amplicon& query, const AmpliconCollection& refs, ReferenceIndices& indices, SubstringsArchive& substrsArchive,
+                         std::vector<numSeqs_t>& candCnts, lenSeqs_t* M, val_t* D, val_t* P, lenSeqs_t* cntDiffs, lenSeqs_t* cntDiffsP,
+                         numSeqs_t& ref, lenSeqs_t& dist, const AssignConfig& ac) {
+
+    lenSeqs_t seqLen = query.len;
+    lenSeqs_t t = ac.threshold;
+    bool found = false;
+
+    std::unordered_map<lenSeqs_t, std::vector<Substrings>>& substrs = substrsArchive[seqLen];
+    if (substrs.empty()) { // position information shared by all queries of this length
+
+        for (lenSeqs_t partnerLen = (seqLen > t) * (seqLen - t); partnerLen <= seqLen + t; partnerLen++) {
+
+            std::vector<Substrings>& vec = substrs[partnerLen];
+            for (lenSeqs_t segmentIndex = 0; segmentIndex < t + ac.extraSegs; segmentIndex++) {
+                if (partnerLen <= seqLen) {
+                    vec.push_back(selectSubstrs(seqLen, partnerLen, segmentIndex, t, ac.extraSegs));
+                } else {
+                    vec.push_back(selectSubstrsBackward(seqLen, partnerLen, segmentIndex, t, ac.extraSegs));
+                }
+            }
+
+        }
+
+    }
+
+    // verify the candidate (if it could improve on the best hit so far)
+    auto verify = [&](const numSeqs_t cand) {
+
+        const Amplicon& r = refs[cand];
+#if QGRAM_FILTER
+        if (qgram_diff(query, r) > t) return;
+#endif
+
+        lenSeqs_t d = ac.useScore ?
+                        Verification::computeGotohLengthAwareEarlyRow(query.seq, query.len, r.seq, r.len, t, ac.scoring, D, P, cntDiffs, cntDiffsP)
+                      : Verification::computeLengthAwareRow(query.seq, query.len, r.seq, r.len, t, M);
+
+        if (d <= t && (!found || d < dist || (d == dist && r.rank < refs[ref].rank))) {
+
+            found = true;
+            ref = cand;
+            dist = d;
+
+        }
+
+    };
+
+    StringIteratorPair sip;
+    for (lenSeqs_t len = (seqLen > t) * (seqLen - t); len <= seqLen + t; len++) {
+
+        if (!indices.contains(len)) continue;
+
+        candCnts.clear();
+        for (lenSeqs_t i = 0; i < t + ac.extraSegs; i++) { // apply segment filter for each segment
+
+            Substrings& subs = substrs[len][i];
+            ReferenceInvertedIndex& inv = indices.getIndex(len, i);
+            sip.first = query.seq + subs.first;
+            sip.second = sip.first + subs.len;
+
+            for (auto substrPos = subs.first; substrPos <= subs.last; substrPos++, sip.first++, sip.second++) {
+                inv.addLabelCountsOf(sip, candCnts);
+            }
+
+        }
+
+        std::sort(candCnts.begin(), candCnts.end());
+
+        // general pigeonhole principle: for being a candidate, at least extraSegs segments have to be matched
+        lenSeqs_t cnt = 0;
+        numSeqs_t prevCand = (candCnts.size() > 0) ? candCnts.front() : 0;
+        for (auto candId : candCnts) {
+
+            if (prevCand != candId) {
+
+                if (cnt >= ac.extraSegs) verify(prevCand);
+
+                cnt = 1;
+                prevCand = candId;
+
+            } else {
+                cnt++;
+            }
+
+        }
+        if (cnt >= ac.extraSegs) verify(prevCand);
+
+    }
+
+    return found;
+
+}
+
+void Assignment::assignQueries(const std::vector<Amplicon>& queries, const AmpliconCollection& refs, ReferenceIndices& indices,
+                               std::vector<std::pair<numSeqs_t, lenSeqs_t>>& hits, std::atomic<numSeqs_t>& nextQuery, const lenSeqs_t width,
+                               const AssignConfig& ac) {
+
+    const numSeqs_t chunkSize = 64;
+
+    SubstringsArchive substrsArchive;
+    std::vector<numSeqs_t> candCnts;
+
+    // reusable DP-matrices (wide enough for all possible calculations for these queries and references)
+    std::vector<lenSeqs_t> M(ac.useScore ? 1 : width);
+    std::vector<val_t> D(ac.useScore ? width : 1);
+    std::vector<val_t> P(ac.useScore ? width : 1);
+    std::vector<lenSeqs_t> cntDiffs(ac.useScore ? width : 1);
+    std::vector<lenSeqs_t> cntDiffsP(ac.useScore ? width : 1);
+
+    for (numSeqs_t begin = nextQuery.fetch_add(chunkSize); begin < queries.size(); begin = nextQuery.fetch_add(chunkSize)) {
+
+        numSeqs_t end = std::min(begin + chunkSize, (numSeqs_t)queries.size());
+        for (numSeqs_t q = begin; q < end; q++) {
+
+            numSeqs_t ref = 0;
+            lenSeqs_t dist = 0;
+            bool found = bestHit(queries[q], refs, indices, substrsArchive, candCnts,
+                                 M.data(), D.data(), P.data(), cntDiffs.data(), cntDiffsP.data(), ref, dist, ac);
+            hits[q] = std::make_pair(found ? ref : refs.size(), dist);
+
+        }
+
+    }
+
+}
+
+// filters of the preprocessing (see Preprocessor::analyseInput(...)) applied to the queries
+struct QueryFilter {
+
+    lenSeqs_t minLength = 0;
+    lenSeqs_t maxLength = std::numeric_limits<lenSeqs_t>::max();
+    std::string alphabet;
+    bool flagAlph = false;
+    int flagLength = 0;
+
+    QueryFilter(const Config<std::string>& conf) {
+
+        flagLength = std::stoi(conf.get(FILTER_LENGTH));
+
+#if QGRAM_FILTER
+        flagAlph = true;
+        alphabet = "ACGTU";
+#else
+        flagAlph = bool(std::stoi(conf.get(FILTER_ALPHABET)));
+        if (flagAlph) {
+            alphabet = conf.get(ALPHABET);
+        }
+#endif
+
+        if (flagLength == 1 || flagLength == 3) maxLength = std::stoul(conf.get(MAX_LENGTH));
+        if (flagLength == 2 || flagLength == 3) minLength = std::stoul(conf.get(MIN_LENGTH));
+
+    }
+
+};
+
+// read up to max further queries passing the filters from a FASTA file,
+// header holds the header line of the next entry (empty when the file is exhausted)
+inline void readQueries(std::ifstream& iStream, std::string& header, const numSeqs_t max, const QueryFilter& filter, const std::string& sep,
+                        std::vector<Preprocessor::Defline>& deflines, std::vector<std::string>& seqs, numSeqs_t& numFiltered) {
+
+    std::string line, seq;
+    while (deflines.size() < max && !header.empty()) {
+
+        std::string next;
+        seq.clear();
+        while (std::getline(iStream, line)) {
+
+            if (line.empty() || line[0] == ';') continue; // skip empty and comment lines (begin with ';')
+            if (line[0] == '>') {
+
+                next = line;
+                break;
+
+            }
+            seq += line;
+
+        }
+
+        Preprocessor::upperCase(seq);
+        if (Preprocessor::checkSequence(seq, filter.alphabet, filter.minLength, filter.maxLength, filter.flagAlph, filter.flagLength)) {
+
+            deflines.push_back(Preprocessor::parseDescriptionLine(header, sep));
+            seqs.push_back(seq);
+
+        } else {
+            numFiltered++;
+        }
+
+        header = next;
+
+    }
+
+}
+
+bool Assignment::assignFiles(const Config<std::string>& conf, const AmpliconCollection& refs, ReferenceIndices& indices,
+                             const std::vector<std::string>& queryFiles, const std::string oFile, const AssignConfig& ac) {
+
+    if (!Preprocessor::checkLengthLimits(conf)) return false;
+
+    std::ofstream oStream(oFile);
+    if (!oStream.good()) {
+
+        std::cerr << "ERROR: Could not open output file " << oFile << "." << std::endl;
+        return false;
+
+    }
+
+    lenSeqs_t refMaxLen = (refs.size() > 0) ? refs.back().len : 0;
+
+    std::cout << "Assigning queries..." << std::endl;
+    QueryFilter filter(conf);
+    numSeqs_t numQueries = 0;
+    numSeqs_t numAssigned = 0;
+    numSeqs_t numFiltered = 0;
+    bool success = true;
+
+    std::vector<Preprocessor::Defline> deflines;
+    std::vector<std::string> seqs;
+    std::vector<Amplicon> queries;
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> hits;
+    std::string out;
+
+    for (auto& file : queryFiles) {
+
+        std::ifstream iStream(file);
+        if (!iStream.good()) {
+
+            std::cerr << "ERROR: File '" << file << "' not opened correctly. No sequences are read from it." << std::endl;
+            success = false;
+            continue;
+
+        }
+
+        std::string header;
+        while (std::getline(iStream, header) && (header.empty() || header[0] != '>')) {
+            // skip everything before the first entry
+        }
+        if (!header.empty() && header[0] != '>') header.clear();
+
+        while (!header.empty()) {
+
+            deflines.clear();
+            seqs.clear();
+            readQueries(iStream, header, ac.batchSize, filter, ac.sepAbundance, deflines, seqs, numFiltered);
+
+            // the strings are not moved anymore, so that the amplicons can refer to them
+            queries.clear();
+            lenSeqs_t width = refMaxLen;
+            for (numSeqs_t q = 0; q < seqs.size(); q++) {
+
+                queries.push_back(Amplicon(&deflines[q].id[0], &seqs[q][0], seqs[q].size(), deflines[q].abundance));
+                width = std::max(width, (lenSeqs_t)seqs[q].size());
+
+            }
+
+            hits.assign(queries.size(), std::make_pair(refs.size(), 0));
+            std::atomic<numSeqs_t> nextQuery(0);
+            std::thread workers[ac.numWorkers];
+            for (unsigned long w = 0; w < ac.numWorkers; w++) {
+                workers[w] = std::thread(&Assignment::assignQueries, std::cref(queries), std::cref(refs), std::ref(indices), std::ref(hits),
+                                         std::ref(nextQuery), width + 1, std::cref(ac));
+            }
+            for (unsigned long w = 0; w < ac.numWorkers; w++) {
+                workers[w].join();
+            }
+
+            out.clear();
+            for (numSeqs_t q = 0; q < queries.size(); q++) {
+
+                out.append(queries[q].id).push_back('\t');
+                if (hits[q].first < refs.size()) {
+
+                    const Amplicon& r = refs[hits[q].first];
+                    out.append(r.id).push_back('\t');
+                    out.append(std::to_string(hits[q].second)).push_back('\n');
+                    numAssigned++;
+
+                } else {
+                    out.append("*\t*\n");
+                }
+
+            }
+            oStream << out;
+            numQueries += queries.size();
+
+        }
+
+    }
+
+    oStream.close();
+
+    std::cout << "Assigned " << numAssigned << " of " << numQueries << " queries (" << numFiltered << " filtered out)." << std::endl << std::endl;
+
+    if (!oStream) {
+
+        std::cerr << "ERROR: Could not write the assignments to " << oFile << "." << std::endl;
+        return false;
+
+    }
+
+    return success;
+
+}
+
+bool Assignment::assign(const Config<std::string>& conf, const AmpliconPools& refPools, const std::vector<std::string>& queryFiles,
+                        const AssignConfig& ac) {
+
+    std::cout << "Indexing references..." << std::endl;
+    ReferenceIndices indices(ac.threshold, ac.threshold + ac.extraSegs, true, false);
+    AmpliconCollection* refs = indexReferences(refPools, indices, ac);
+
+    bool success = assignFiles(conf, *refs, indices, queryFiles, ac.oFile, ac);
+    delete refs;
+
+    return success;
+
+}
+
+}
@@ -22,7 +22,11 @@
  */
 
 #include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "../include/Base.hpp"
 
@@ -208,6 +212,7 @@ void selectSegments(Segments& segments, const lenSeqs_t seqLen, const lenSeqs_t
 AmpliconCollection::AmpliconCollection(const numSeqs_t capacity, const std::vector<std::pair<lenSeqs_t, numSeqs_t>>& counts) {
 
     amplicons_ = new Amplicon[capacity];
+    seqGroups_ = new numSeqs_t[capacity];
     size_ = 0;
     capacity_ = capacity;
     numLengths_ = counts.size();
@@ -221,12 +226,16 @@ AmpliconCollection::AmpliconCollection(const numSeqs_t capacity, const std::vect
 AmpliconCollection::~AmpliconCollection() {
 
     delete[] counts_;
+    delete[] seqGroups_;
     delete[] amplicons_;
 
 }
 
 void AmpliconCollection::push_back(const Amplicon& ampl) {
+
+    seqGroups_[size_] = size_;
     amplicons_[size_++] = ampl;
+
 }
 
 Amplicon& AmpliconCollection::operator[](const numSeqs_t i) {
@@ -277,12 +286,19 @@ void AmpliconCollection::reserve(const numSeqs_t newCapacity) {
     if (capacity_ >= newCapacity || size_ >= newCapacity) return;
 
     Amplicon* tmp = new Amplicon[newCapacity];
+    numSeqs_t* tmpGroups = new numSeqs_t[newCapacity];
     for (numSeqs_t i = 0; i < size_; i++) {
+
         tmp[i] = amplicons_[i];
+        tmpGroups[i] = seqGroups_[i];
+
     }
 
     delete[] amplicons_;
+    delete[] seqGroups_;
     amplicons_ = tmp;
+    seqGroups_ = tmpGroups;
+    capacity_ = newCapacity;
 
 }
 
@@ -297,72 +313,188 @@ std::vector<lenSeqs_t> AmpliconCollection::allLengths() const {
 
 }
 
+void AmpliconCollection::setSeqGroup(const numSeqs_t i, const numSeqs_t g) {
+    seqGroups_[i] = g;
+}
+
+numSeqs_t AmpliconCollection::seqGroup(const numSeqs_t i) const {
+    return seqGroups_[i];
+}
+
 
 // ===== AmpliconPools =====
 
-AmpliconPools::AmpliconPools(std::map<lenSeqs_t, numSeqs_t>& counts, const unsigned long long capacity, const lenSeqs_t threshold) {
+AmpliconPools::AmpliconPools(std::map<lenSeqs_t, numSeqs_t>& counts, const unsigned long long seqCapacity,
+                             const unsigned long long idCapacity, const lenSeqs_t threshold, const std::string idFile) {
 
-    strings_ = new char[capacity];
-    nextPos_ = strings_;
-    capacity_ = capacity;
+    seqs_ = new char[seqCapacity];
+    nextSeq_ = seqs_;
+    seqCapacity_ = seqCapacity;
+
+    ids_ = 0;
+    idCapacity_ = idCapacity;
+    if (!idFile.empty() && idCapacity > 0) {
+
+        int fd = open(idFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0 && ftruncate(fd, idCapacity) == 0) {
+
+            void* addr = mmap(0, idCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+
+                ids_ = static_cast<char*>(addr);
+                idFile_ = idFile;
+
+            }
+
+        }
+        if (fd >= 0) close(fd);
+
+        if (ids_ == 0) {
+
+            std::cerr << "WARNING: Identifier storage file '" << idFile << "' could not be mapped. Keeping the identifiers in memory instead." << std::endl;
+            std::remove(idFile.c_str());
+
+        }
+
+    }
+    if (ids_ == 0) ids_ = new char[idCapacity];
+    nextId_ = ids_;
+
+    auto poolCounts = determinePools(counts, threshold);
+    for (auto iter = poolCounts.begin(); iter != poolCounts.end(); iter++) {
+
+        numSeqs_t poolSize = 0;
+        for (auto& c : *iter) {
+            poolSize += c.second;
+        }
+
+        pools_.push_back(new AmpliconCollection(poolSize, *iter));
+
+    }
+
+}
+
+AmpliconPools::AmpliconPools(const std::string& spillFile, const std::vector<SpilledPool>& spilled) {
+
+    seqs_ = nextSeq_ = 0;
+    seqCapacity_ = 0;
+    ids_ = nextId_ = 0;
+    idCapacity_ = 0;
+
+    spillFile_ = spillFile;
+    spilled_ = spilled;
+    pools_ = std::vector<AmpliconCollection*>(spilled.size(), 0);
+    poolStrings_ = std::vector<char*>(spilled.size(), 0);
+
+}
+
+AmpliconPools::~AmpliconPools() {
+
+    for (auto iter = pools_.begin(); iter != pools_.end(); iter++) {
+        delete *iter;
+    }
+
+    for (auto iter = poolStrings_.begin(); iter != poolStrings_.end(); iter++) {
+        delete[] *iter;
+    }
+
+    delete[] seqs_;
+
+    if (idFile_.empty()) {
+        delete[] ids_;
+    } else {
+
+        munmap(ids_, idCapacity_);
+        std::remove(idFile_.c_str());
+
+    }
+
+    if (!spillFile_.empty()) {
+        std::remove(spillFile_.c_str());
+    }
+
+}
+
+std::vector<std::vector<std::pair<lenSeqs_t, numSeqs_t>>> AmpliconPools::determinePools(std::map<lenSeqs_t, numSeqs_t>& counts,
+                                                                                        const lenSeqs_t threshold) {
+
+    std::vector<std::vector<std::pair<lenSeqs_t, numSeqs_t>>> poolCounts;
 
     if (counts.size() != 0) {
 
-        numSeqs_t curPoolSize = 0;
         std::vector<std::pair<lenSeqs_t, numSeqs_t>> localCounts;
 
         // start the pool that will comprise the shortest amplicons
         lenSeqs_t lastLen = counts.begin()->first;
-        curPoolSize += counts.begin()->second;
-        localCounts.push_back(std::make_pair(lastLen, curPoolSize));
-        counts.begin()->second = pools_.size();
+        localCounts.push_back(std::make_pair(lastLen, counts.begin()->second));
+        counts.begin()->second = poolCounts.size();
 
         // iterate over the remaining length groups, starting a new one if a break is detected
         for (auto iter = ++counts.begin(); iter != counts.end(); iter++) {
 
             if ((lastLen + threshold) < iter->first) { // new pool
 
-                pools_.push_back(new AmpliconCollection(curPoolSize, localCounts));
-
-                curPoolSize = 0;
+                poolCounts.push_back(localCounts);
                 localCounts.clear();
 
             }
 
             localCounts.push_back(std::make_pair(iter->first, iter->second));
-            curPoolSize += iter->second;
-            iter->second = pools_.size();
+            iter->second = poolCounts.size();
             lastLen = iter->first;
 
         }
 
-        pools_.push_back(new AmpliconCollection(curPoolSize, localCounts));
+        poolCounts.push_back(localCounts);
 
     }
 
+    return poolCounts;
+
 }
 
-AmpliconPools::~AmpliconPools() {
+void AmpliconPools::add(const lenSeqs_t i, const std::string& header, const std::string& sequence, const numSeqs_t abundance) {
 
-    for (auto iter = pools_.begin(); iter != pools_.end(); iter++) {
-        delete *iter;
-    }
+    char* h = nextId_;
+    strcpy(nextId_, header.c_str());
+    nextId_ += header.length() + 1;
+
+    char* s = nextSeq_;
+    strcpy(nextSeq_, sequence.c_str());
+    nextSeq_ += sequence.length() + 1;
 
-    delete[] strings_;
+    pools_[i]->push_back(Amplicon(h, s, sequence.length(), abundance));
 
 }
 
-void AmpliconPools::add(const lenSeqs_t i, const std::string& header, const std::string& sequence, const numSeqs_t abundance) {
+void AmpliconPools::compact() {
 
-    char* h = nextPos_;
-    strcpy(nextPos_, header.c_str());
-    nextPos_ += header.length() + 1;
+    char* packed = new char[seqCapacity_];
+    char* next = packed;
 
-    char* s = nextPos_;
-    nextPos_ = strcpy(nextPos_, sequence.c_str());
-    nextPos_ += sequence.length() + 1;
+    for (auto ac : pools_) {
 
-    pools_[i]->push_back(Amplicon(h, s, sequence.length(), abundance));
+        for (auto iter = ac->begin(); iter != ac->end(); iter++) {
+
+            memcpy(next, iter->seq, iter->len + 1);
+            iter->seq = next;
+            next += iter->len + 1;
+
+        }
+
+    }
+
+    delete[] seqs_;
+    seqs_ = packed;
+    nextSeq_ = next;
+
+    // dirty pages are written back to the file, so the mapped identifiers can be dropped from memory and read again on demand
+    if (!idFile_.empty()) {
+
+        msync(ids_, idCapacity_, MS_ASYNC);
+        madvise(ids_, idCapacity_, MADV_DONTNEED);
+
+    }
 
 }
 
@@ -370,6 +502,29 @@ AmpliconCollection* AmpliconPools::get(const lenSeqs_t i) const {
     return (i < pools_.size()) ? pools_[i] : 0;
 }
 
+void AmpliconPools::release(const lenSeqs_t i) {
+
+    delete pools_[i];
+    pools_[i] = 0;
+
+    if (i < poolStrings_.size()) {
+
+        delete[] poolStrings_[i];
+        poolStrings_[i] = 0;
+
+    }
+
+}
+
+void AmpliconPools::install(const lenSeqs_t i, AmpliconCollection* ac, char* strings) {
+
+    release(i);
+
+    pools_[i] = ac;
+    poolStrings_[i] = strings;
+
+}
+
 lenSeqs_t AmpliconPools::numPools() const {
     return pools_.size();
 }
@@ -377,14 +532,41 @@ lenSeqs_t AmpliconPools::numPools() const {
 numSeqs_t AmpliconPools::numAmplicons() const {
 
     numSeqs_t sum = 0;
-    for (auto iter = pools_.begin(); iter != pools_.end(); iter++) {
-        sum += (*iter)->size();
+
+    if (outOfCore()) {
+
+        for (auto iter = spilled_.begin(); iter != spilled_.end(); iter++) {
+            sum += iter->size;
+        }
+
+    } else {
+
+        for (auto iter = pools_.begin(); iter != pools_.end(); iter++) {
+            sum += (*iter != 0) ? (*iter)->size() : 0;
+        }
+
     }
 
     return sum;
 
 }
 
+lenSeqs_t AmpliconPools::maxLen(const lenSeqs_t i) const {
+    return (pools_[i] != 0) ? pools_[i]->maxLen() : spilled_[i].counts.back().first;
+}
+
+bool AmpliconPools::outOfCore() const {
+    return !spillFile_.empty();
+}
+
+const std::string& AmpliconPools::spillFile() const {
+    return spillFile_;
+}
+
+const SpilledPool& AmpliconPools::spilled(const lenSeqs_t i) const {
+    return spilled_[i];
+}
+
 
 //TODO? custom hash function (e.g. FNV) to avoid construction of temporary string
 size_t hashStringIteratorPair::operator()(const StringIteratorPair& p) const {
@@ -0,0 +1,205 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+
+#include "../include/Microvariants.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace GeFaST {
+namespace Microvariants {
+
+hash_t hashSequence(const char* seq, const lenSeqs_t len) {
+
+    hash_t h = 0;
+    for (lenSeqs_t i = 0; i < len; i++) {
+        h = h * HASH_BASE + hash_t((unsigned char)seq[i]);
+    }
+
+    return h;
+
+}
+
+// mark the characters occurring in the sequences of the collection
+void markCharacters(const AmpliconCollection& ac, bool* occurs) {
+
+    for (auto iter = ac.begin(); iter != ac.end(); iter++) {
+        for (lenSeqs_t i = 0; i < iter->len; i++) {
+            occurs[(unsigned char)iter->seq[i]] = true;
+        }
+    }
+
+}
+
+std::vector<char> collectCharacters(const bool* occurs) {
+
+    std::vector<char> alphabet;
+    for (int c = 0; c < 256; c++) {
+        if (occurs[c]) alphabet.push_back(char(c));
+    }
+
+    return alphabet;
+
+}
+
+std::vector<char> determineAlphabet(const AmpliconCollection& ac) {
+
+    bool occurs[256] = {false};
+    markCharacters(ac, occurs);
+
+    return collectCharacters(occurs);
+
+}
+
+std::vector<char> determineAlphabet(const AmpliconPools& pools) {
+
+    bool occurs[256] = {false};
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        markCharacters(*(pools.get(p)), occurs);
+    }
+
+    return collectCharacters(occurs);
+
+}
+
+
+MicrovariantGenerator::MicrovariantGenerator(const std::vector<char>& alphabet, const lenSeqs_t maxLen) : alphabet_(alphabet) {
+
+    pow_ = std::vector<hash_t>(maxLen + 2);
+    pow_[0] = 1;
+    for (lenSeqs_t i = 1; i < pow_.size(); i++) {
+        pow_[i] = pow_[i - 1] * HASH_BASE;
+    }
+
+    pre_ = std::vector<hash_t>(maxLen + 1);
+    seq_ = 0;
+    len_ = 0;
+
+}
+
+void MicrovariantGenerator::setSequence(const char* seq, const lenSeqs_t len) {
+
+    seq_ = seq;
+    len_ = len;
+
+    pre_[0] = 0;
+    for (lenSeqs_t i = 0; i < len; i++) {
+        pre_[i + 1] = pre_[i] * HASH_BASE + hash_t((unsigned char)seq[i]);
+    }
+
+}
+
+hash_t MicrovariantGenerator::hash() const {
+    return pre_[len_];
+}
+
+lenSeqs_t MicrovariantGenerator::materialise(const Microvariant& mv, char* buf) const {
+
+    memcpy(buf, seq_, mv.pos);
+
+    switch (mv.type) {
+
+        case Microvariant::SUBSTITUTION:
+            buf[mv.pos] = mv.c;
+            memcpy(buf + mv.pos + 1, seq_ + mv.pos + 1, len_ - mv.pos - 1);
+            return len_;
+
+        case Microvariant::DELETION:
+            memcpy(buf + mv.pos, seq_ + mv.pos + 1, len_ - mv.pos - 1);
+            return len_ - 1;
+
+        default: // INSERTION
+            buf[mv.pos] = mv.c;
+            memcpy(buf + mv.pos + 1, seq_ + mv.pos, len_ - mv.pos);
+            return len_ + 1;
+
+    }
+
+}
+
+
+BloomFilter::BloomFilter(const unsigned long long numElements, const unsigned long bitsPerElement) {
+
+    unsigned long long numWords = 1;
+    while (numWords * 64 < numElements * bitsPerElement) {
+        numWords <<= 1;
+    }
+
+    words_ = std::vector<unsigned long long>(numWords, 0);
+    mask_ = numWords - 1;
+
+}
+
+void BloomFilter::insert(const hash_t h) {
+
+    hash_t m = mix(h);
+    __sync_fetch_and_or(&words_[(m >> 32) & mask_], pattern(m));
+
+}
+
+bool BloomFilter::contains(const hash_t h) const {
+
+    hash_t m = mix(h);
+    unsigned long long p = pattern(m);
+
+    return (words_[(m >> 32) & mask_] & p) == p;
+
+}
+
+
+SequenceTable::SequenceTable(const AmpliconCollection& ac) : ac_(ac), filter_(ac.size()) {
+
+    entries_.reserve(ac.size());
+    for (numSeqs_t i = 0; i < ac.size(); i++) {
+
+        hash_t h = hashSequence(ac[i].seq, ac[i].len);
+        entries_.emplace_back(h, i);
+        filter_.insert(h);
+
+    }
+
+    std::sort(entries_.begin(), entries_.end());
+
+}
+
+void SequenceTable::find(const hash_t h, const char* seq, const lenSeqs_t len, std::vector<numSeqs_t>& labels) const {
+
+    auto iter = std::lower_bound(entries_.begin(), entries_.end(), std::make_pair(h, numSeqs_t(0)));
+    for (; iter != entries_.end() && iter->first == h; iter++) {
+
+        const Amplicon& ampl = ac_[iter->second];
+        if (ampl.len == len && memcmp(ampl.seq, seq, len) == 0) {
+            labels.push_back(iter->second);
+        }
+
+    }
+
+}
+
+bool SequenceTable::mayContain(const hash_t h) const {
+    return filter_.contains(h);
+}
+
+}
+}
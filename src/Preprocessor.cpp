@@ -21,9 +21,12 @@
  * PO box 100131, DE-33501 Bielefeld, Germany
  */
 
+#include <cstdio>
 #include <fstream>
 #include <limits>
+#include <queue>
 
+#include "../include/Buffer.hpp"
 #include "../include/Preprocessor.hpp"
 
 
@@ -32,14 +35,14 @@ namespace GeFaST {
 Preprocessor::Defline Preprocessor::parseDescriptionLine(const std::string& defline, const std::string sep) {
 
     auto pos = defline.find(' ');
-    numSeqs_t abundance = 1;
+    unsigned long long abundance = 1;
     std::string firstPart = defline.substr(1, pos - 1);
     std::string secondPart = defline.substr(pos + 1);
 
     pos = firstPart.find(sep);
 
     if (pos != std::string::npos) {
-        abundance = std::stoul(firstPart.substr(pos + sep.size()));
+        abundance = std::stoull(firstPart.substr(pos + sep.size()));
         firstPart = firstPart.substr(0, pos);
     }
 
@@ -100,12 +103,47 @@ bool Preprocessor::checkSequence(const std::string& seq, const std::string& alph
         }
     }
 
+#if COMPACT_INDICES
+    // the length has to be representable by the (16-bit) length type
+    valid = valid && seq.length() <= std::numeric_limits<lenSeqs_t>::max();
+#endif
+
     return valid;
 
 }
 
+bool Preprocessor::checkLengthLimits(const Config<std::string>& conf) {
+
+    int flagLength = std::stoi(conf.get(FILTER_LENGTH));
+    bool fits = true;
+
+    if (flagLength == 1 || flagLength == 3) fits = fits && std::stoull(conf.get(MAX_LENGTH)) <= std::numeric_limits<lenSeqs_t>::max();
+    if (flagLength == 2 || flagLength == 3) fits = fits && std::stoull(conf.get(MIN_LENGTH)) <= std::numeric_limits<lenSeqs_t>::max();
+
+    if (!fits) {
+        std::cerr << "ERROR: The length limits exceed the maximum sequence length of this build (" << std::numeric_limits<lenSeqs_t>::max() << ")." << std::endl;
+    }
+
+    return fits;
+
+}
+
+bool Preprocessor::checkAbundance(const unsigned long long totalAbundance) {
+
+    bool fits = totalAbundance <= std::numeric_limits<numSeqs_t>::max();
+
+    if (!fits) {
+        std::cerr << "ERROR: The total abundance of the input (" << totalAbundance << ") exceeds the maximum count of this build ("
+                  << std::numeric_limits<numSeqs_t>::max() << ")." << std::endl;
+    }
+
+    return fits;
+
+}
+
 unsigned long long Preprocessor::analyseInput(const Config<std::string>& conf, std::map<lenSeqs_t, numSeqs_t>& counts,
-                                              const std::string fileName, const std::string sep) {
+                                              const std::string fileName, const std::string sep, unsigned long long* idLength,
+                                              unsigned long long* abundance) {
 
     std::ifstream iStream(fileName);
     if (!iStream.good()) {
@@ -120,6 +158,8 @@ unsigned long long Preprocessor::analyseInput(const Config<std::string>& conf, s
     lenSeqs_t maxLength = std::numeric_limits<lenSeqs_t>::max();
     std::string alphabet;
     unsigned long long totalLength = 0;
+    unsigned long long totalIdLength = 0;
+    unsigned long long totalAbundance = 0;
 
     int flagLength = std::stoi(conf.get(FILTER_LENGTH));
 
@@ -183,6 +223,8 @@ unsigned long long Preprocessor::analyseInput(const Config<std::string>& conf, s
 
                     counts[seq.length()]++;
                     totalLength += dl.id.length() + seq.length() + 2;
+                    totalIdLength += dl.id.length() + 1;
+                    totalAbundance += dl.abundance;
 
                 }
 
@@ -204,11 +246,16 @@ unsigned long long Preprocessor::analyseInput(const Config<std::string>& conf, s
 
             counts[seq.length()]++;
             totalLength += dl.id.length() + seq.length() + 2;
+            totalIdLength += dl.id.length() + 1;
+            totalAbundance += dl.abundance;
 
         }
 
     }
 
+    if (idLength != 0) *idLength += totalIdLength;
+    if (abundance != 0) *abundance += totalAbundance;
+
     return totalLength;
 
 }
@@ -318,19 +365,223 @@ void Preprocessor::appendInput(const Config<std::string>& conf, AmpliconPools& p
 }
 
 
+Preprocessor::PoolSpiller::PoolSpiller(std::ofstream& oStream, const lenSeqs_t numPools, const size_t bufferSize) : oStream_(oStream) {
+
+    bufferSize_ = bufferSize;
+    buffers_ = std::vector<std::string>(numPools);
+    chunks_ = std::vector<std::vector<std::pair<unsigned long long, unsigned long long>>>(numPools);
+
+}
+
+void Preprocessor::PoolSpiller::append(const lenSeqs_t p, const char* data, const size_t len) {
+
+    if (buffers_[p].capacity() < bufferSize_) buffers_[p].reserve(bufferSize_);
+
+    buffers_[p].append(data, len);
+    if (buffers_[p].size() >= bufferSize_) flush(p);
+
+}
+
+void Preprocessor::PoolSpiller::flush() {
+
+    for (lenSeqs_t p = 0; p < buffers_.size(); p++) {
+        flush(p);
+    }
+
+}
+
+void Preprocessor::PoolSpiller::flush(const lenSeqs_t p) {
+
+    if (buffers_[p].empty()) return;
+
+    chunks_[p].emplace_back(oStream_.tellp(), buffers_[p].size());
+    oStream_.write(buffers_[p].data(), buffers_[p].size());
+    buffers_[p].clear();
+
+}
+
+const std::vector<std::pair<unsigned long long, unsigned long long>>& Preprocessor::PoolSpiller::chunks(const lenSeqs_t p) const {
+    return chunks_[p];
+}
+
+// writes the spill record of the given amplicon to the chunks of pool p
+inline void spillAmplicon(Preprocessor::PoolSpiller& spiller, const lenSeqs_t p, const std::string& id, const std::string& seq,
+                          const numSeqs_t abundance) {
+
+    Preprocessor::SpillRecord rec;
+    rec.abundance = abundance;
+    rec.idLen = id.length();
+    rec.seqLen = seq.length();
+
+    spiller.append(p, reinterpret_cast<const char*>(&rec), sizeof(Preprocessor::SpillRecord));
+    spiller.append(p, id.data(), id.length());
+    spiller.append(p, seq.data(), seq.length());
+
+}
+
+// like appendInput(), but the amplicons are written to the spill chunks of their pools instead of being kept in memory
+void Preprocessor::spillInput(const Config<std::string>& conf, PoolSpiller& spiller, std::map<lenSeqs_t, numSeqs_t>& poolMap,
+                              const std::string fileName, const std::string sep) {
+
+    std::ifstream iStream(fileName);
+    if (!iStream.good()) {
+
+        std::cerr << "ERROR: File '" << fileName << "' not opened correctly. No sequences are read from it." << std::endl;
+        return;
+
+    }
+
+    // set up filters (depending on configuration)
+    lenSeqs_t minLength = 0;
+    lenSeqs_t maxLength = std::numeric_limits<lenSeqs_t>::max();
+    std::string alphabet;
+
+    int flagLength = std::stoi(conf.get(FILTER_LENGTH));
+
+#if QGRAM_FILTER
+
+    bool flagAlph = true;
+    alphabet = "ACGTU";
+
+#else
+
+    bool flagAlph = bool(std::stoi(conf.get(FILTER_ALPHABET)));
+    if (flagAlph) {
+        alphabet = conf.get(ALPHABET);
+    }
+
+#endif
+
+    switch (flagLength) {
+        case 1: { // 01 = only max
+            maxLength = std::stoul(conf.get(MAX_LENGTH));
+            break;
+        }
+
+        case 2: { // 10 = only min
+            minLength = std::stoul(conf.get(MIN_LENGTH));
+            break;
+        }
+
+        case 3: { // 11 = min & max
+            minLength = std::stoul(conf.get(MIN_LENGTH));
+            maxLength = std::stoul(conf.get(MAX_LENGTH));
+            break;
+        }
+
+        default: {
+            // do nothing
+        }
+    }
+
+
+    Defline dl;
+    std::string line, seq;
+    bool first = true;
+
+
+    while (std::getline(iStream, line).good()) {
+
+        if (line.empty() || line[0] == ';') continue; // skip empty and comment lines (begin with ';')
+
+        if (line[0] == '>') { // header line
+
+            if (first) { // first entry found (no previous entry to finish), simply parse header
+
+                dl = parseDescriptionLine(line, sep);
+                first = false;
+
+            } else { // finish and store previous entry, then collect parse header of new entry
+
+                upperCase(seq);
+
+                if (checkSequence(seq, alphabet, minLength, maxLength, flagAlph, flagLength)) {
+                    spillAmplicon(spiller, poolMap[seq.length()], dl.id, seq, dl.abundance);
+                }
+
+                seq.clear();
+                dl = parseDescriptionLine(line, sep);
+
+            }
+
+        } else { // still the same entry, continue to collect sequence
+            seq += line;
+        }
+    }
+
+    if (!first) { // ensures that last entry (if any) is written to file.
+
+        upperCase(seq);
+
+        if (checkSequence(seq, alphabet, minLength, maxLength, flagAlph, flagLength)) {
+            spillAmplicon(spiller, poolMap[seq.length()], dl.id, seq, dl.abundance);
+        }
+
+    }
+
+}
+
+
+void Preprocessor::assignSeqGroups(AmpliconCollection& ac) {
+
+    std::unordered_map<StringIteratorPair, numSeqs_t, hashStringIteratorPair, equalStringIteratorPair> firstOcc;
+
+    for (numSeqs_t i = 0; i < ac.size(); i++) {
+
+        auto res = firstOcc.insert(std::make_pair(StringIteratorPair(ac[i].seq, ac[i].seq + ac[i].len), i));
+        ac.setSeqGroup(i, res.first->second);
+
+    }
+
+}
+
+
+void Preprocessor::assignRanks(AmpliconPools& pools) {
+
+    auto before = [&pools](const std::pair<numSeqs_t, numSeqs_t>& a, const std::pair<numSeqs_t, numSeqs_t>& b) { // inverted for the max-heap
+        const Amplicon& amplA = (*pools.get(a.first))[a.second];
+        const Amplicon& amplB = (*pools.get(b.first))[b.second];
+        return (amplA.abundance < amplB.abundance) || ((amplA.abundance == amplB.abundance) && (strcmp(amplA.id, amplB.id) > 0));
+    };
+    std::priority_queue<std::pair<numSeqs_t, numSeqs_t>, std::vector<std::pair<numSeqs_t, numSeqs_t>>, decltype(before)> heads(before);
+
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        if (pools.get(p)->size() > 0) heads.push(std::make_pair(p, 0));
+    }
+
+    numSeqs_t rank = 0;
+    while (!heads.empty()) {
+
+        auto head = heads.top();
+        heads.pop();
+
+        (*pools.get(head.first))[head.second].rank = rank++;
+        if (head.second + 1 < pools.get(head.first)->size()) heads.push(std::make_pair(head.first, head.second + 1));
+
+    }
+
+}
+
+
 AmpliconPools* Preprocessor::run(const Config<std::string>& conf, const std::vector<std::string>& fileNames) {
 
+    if (!checkLengthLimits(conf)) return 0;
+
     std::string sep = conf.get(SEPARATOR_ABUNDANCE);
 
     unsigned long long totalLength = 0;
+    unsigned long long idLength = 0;
+    unsigned long long totalAbundance = 0;
     std::map<lenSeqs_t, numSeqs_t> counts;
 
     std::cout << "Analysing input files..." << std::endl;
     for (auto iter = fileNames.begin(); iter != fileNames.end(); iter++) {
-        totalLength += analyseInput(conf, counts, *iter, sep);
+        totalLength += analyseInput(conf, counts, *iter, sep, &idLength, &totalAbundance);
     }
+    if (!checkAbundance(totalAbundance)) return 0;
 
-    AmpliconPools* pools = new AmpliconPools(counts, totalLength, std::stoul(conf.get(THRESHOLD)));
+    AmpliconPools* pools = new AmpliconPools(counts, totalLength - idLength, idLength, std::stoul(conf.get(THRESHOLD)),
+                                             conf.peek(ID_STORAGE_FILE) ? conf.get(ID_STORAGE_FILE) : "");
 
     std::cout << "Reading input files..." << std::endl;
     for (auto iter = fileNames.begin(); iter != fileNames.end(); iter++) {
@@ -346,11 +597,277 @@ AmpliconPools* Preprocessor::run(const Config<std::string>& conf, const std::vec
                       return (amplA.abundance > amplB.abundance) || ((amplA.abundance == amplB.abundance) && (strcmp(amplA.id, amplB.id) < 0));
                   }
         );
+        assignSeqGroups(*ac);
 
     }
+    assignRanks(*pools);
+    pools->compact();
 
     return pools;
 
 }
 
-}
\ No newline at end of file
+// reads the given chunks (in this order) into data
+inline bool readChunks(std::ifstream& iStream, const std::vector<std::pair<unsigned long long, unsigned long long>>& chunks,
+                       std::vector<char>& data) {
+
+    unsigned long long total = 0;
+    for (auto& c : chunks) {
+        total += c.second;
+    }
+    data.resize(total);
+
+    char* next = data.data();
+    for (auto& c : chunks) {
+
+        iStream.seekg(c.first);
+        iStream.read(next, c.second);
+        next += c.second;
+
+    }
+
+    return !iStream.fail();
+
+}
+
+// abundance (descending) and, for ties, identifier (ascending) of two spill records (as in run(...))
+inline bool spillRecordBefore(const char* a, const char* b) {
+
+    Preprocessor::SpillRecord recA, recB;
+    memcpy(&recA, a, sizeof(Preprocessor::SpillRecord));
+    memcpy(&recB, b, sizeof(Preprocessor::SpillRecord));
+
+    if (recA.abundance != recB.abundance) return recA.abundance > recB.abundance;
+
+    int cmp = memcmp(a + sizeof(Preprocessor::SpillRecord), b + sizeof(Preprocessor::SpillRecord), std::min(recA.idLen, recB.idLen));
+    return (cmp < 0) || ((cmp == 0) && (recA.idLen < recB.idLen));
+
+}
+
+AmpliconPools* Preprocessor::runOutOfCore(const Config<std::string>& conf, const std::vector<std::string>& fileNames,
+                                          const std::string spillFile) {
+
+    if (!checkLengthLimits(conf)) return 0;
+
+    std::string sep = conf.get(SEPARATOR_ABUNDANCE);
+
+    unsigned long long totalAbundance = 0;
+    std::map<lenSeqs_t, numSeqs_t> counts;
+
+    std::cout << "Analysing input files..." << std::endl;
+    for (auto iter = fileNames.begin(); iter != fileNames.end(); iter++) {
+        analyseInput(conf, counts, *iter, sep, 0, &totalAbundance);
+    }
+    if (!checkAbundance(totalAbundance)) return 0;
+
+    auto poolCounts = AmpliconPools::determinePools(counts, std::stoul(conf.get(THRESHOLD)));
+    lenSeqs_t numPools = poolCounts.size();
+
+    std::vector<SpilledPool> spilled(numPools);
+    for (lenSeqs_t p = 0; p < numPools; p++) {
+
+        spilled[p].counts = poolCounts[p];
+        for (auto& c : poolCounts[p]) {
+            spilled[p].size += c.second;
+        }
+
+    }
+
+    // distribute the amplicons to the pools
+    std::string rawFile = spillFile + ".raw";
+    std::ofstream rawStream(rawFile, std::ios::out | std::ios::binary | std::ios::trunc);
+    std::ofstream oStream(spillFile, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!rawStream.good() || !oStream.good()) {
+
+        std::cerr << "ERROR: Spill file '" << spillFile << "' not opened correctly." << std::endl;
+        return 0;
+
+    }
+
+    std::cout << "Reading input files..." << std::endl;
+    std::vector<std::vector<std::pair<unsigned long long, unsigned long long>>> rawChunks(numPools);
+    {
+        PoolSpiller spiller(rawStream, numPools, 1 << 16);
+        for (auto iter = fileNames.begin(); iter != fileNames.end(); iter++) {
+            spillInput(conf, spiller, counts, *iter, sep);
+        }
+        spiller.flush();
+
+        for (lenSeqs_t p = 0; p < numPools; p++) {
+            rawChunks[p] = spiller.chunks(p);
+        }
+    }
+    rawStream.close();
+
+    // sort the pools one by one and write them contiguously to the spill file
+    std::cout << "Sorting amplicons..." << std::endl;
+    std::ifstream rawIn(rawFile, std::ios::in | std::ios::binary);
+    bool success = true;
+
+    for (lenSeqs_t p = 0; p < numPools && success; p++) {
+
+        std::vector<char> data;
+        success = readChunks(rawIn, rawChunks[p], data);
+
+        std::vector<const char*> recs;
+        recs.reserve(spilled[p].size);
+        for (size_t pos = 0; pos < data.size(); ) {
+
+            SpillRecord rec;
+            memcpy(&rec, data.data() + pos, sizeof(SpillRecord));
+
+            recs.push_back(data.data() + pos);
+            spilled[p].stringsLength += rec.idLen + rec.seqLen + 2;
+            pos += sizeof(SpillRecord) + rec.idLen + rec.seqLen;
+
+        }
+        std::sort(recs.begin(), recs.end(), spillRecordBefore);
+
+        spilled[p].offset = oStream.tellp();
+        for (auto r : recs) {
+
+            SpillRecord rec;
+            memcpy(&rec, r, sizeof(SpillRecord));
+            oStream.write(r, sizeof(SpillRecord) + rec.idLen + rec.seqLen);
+
+        }
+        spilled[p].length = (unsigned long long)oStream.tellp() - spilled[p].offset;
+
+    }
+
+    rawIn.close();
+    std::remove(rawFile.c_str());
+    oStream.flush();
+
+    // determine the global ranks by merging the sorted pools
+    std::ifstream iStream(spillFile, std::ios::in | std::ios::binary);
+    std::vector<SegmentReader> readers(numPools);
+
+    auto before = [&readers](const lenSeqs_t a, const lenSeqs_t b) { // inverted for the max-heap
+        return spillRecordBefore(readers[b].current(), readers[a].current());
+    };
+    std::priority_queue<lenSeqs_t, std::vector<lenSeqs_t>, decltype(before)> heads(before);
+
+    // make the next record of the reader completely available
+    auto advance = [&](const lenSeqs_t p) {
+
+        SegmentReader& reader = readers[p];
+        if (reader.empty()) return;
+
+        success = success && reader.fill(iStream, sizeof(SpillRecord));
+        if (!success) return;
+
+        SpillRecord rec = reader.peek<SpillRecord>();
+        success = reader.fill(iStream, sizeof(SpillRecord) + rec.idLen + rec.seqLen);
+        if (success) heads.push(p);
+
+    };
+
+    PoolSpiller rankSpiller(oStream, numPools, 1 << 14);
+    for (lenSeqs_t p = 0; p < numPools && success; p++) {
+
+        readers[p] = SegmentReader(spilled[p].offset, spilled[p].length);
+        advance(p);
+
+    }
+
+    numSeqs_t rank = 0;
+    while (success && !heads.empty()) {
+
+        lenSeqs_t p = heads.top();
+        heads.pop();
+
+        rankSpiller.append(p, reinterpret_cast<const char*>(&rank), sizeof(numSeqs_t));
+        rank++;
+
+        SpillRecord rec = readers[p].peek<SpillRecord>();
+        readers[p].pos += sizeof(SpillRecord) + rec.idLen + rec.seqLen;
+        advance(p);
+
+    }
+    rankSpiller.flush();
+
+    for (lenSeqs_t p = 0; p < numPools; p++) {
+        spilled[p].rankChunks = rankSpiller.chunks(p);
+    }
+
+    iStream.close();
+    oStream.close();
+
+    if (!success || oStream.fail()) {
+
+        std::cerr << "ERROR: Spill file '" << spillFile << "' not written correctly." << std::endl;
+        std::remove(spillFile.c_str());
+        return 0;
+
+    }
+
+    return new AmpliconPools(spillFile, spilled);
+
+}
+
+void Preprocessor::loadPool(AmpliconPools& pools, const lenSeqs_t i) {
+
+    if (pools.get(i) != 0) return;
+
+    const SpilledPool& sp = pools.spilled(i);
+    AmpliconCollection* ac = new AmpliconCollection(sp.size, sp.counts);
+    char* strings = new char[sp.stringsLength];
+
+    std::ifstream iStream(pools.spillFile(), std::ios::in | std::ios::binary);
+    std::vector<char> data(sp.length);
+    std::vector<char> ranks;
+
+    iStream.seekg(sp.offset);
+    iStream.read(data.data(), sp.length);
+    if (iStream.fail() || !readChunks(iStream, sp.rankChunks, ranks) || ranks.size() != sp.size * sizeof(numSeqs_t)) {
+
+        std::cerr << "ERROR: Pool " << i << " could not be loaded from the spill file '" << pools.spillFile() << "'." << std::endl;
+        pools.install(i, ac, strings);
+        return;
+
+    }
+
+    // the sequences are packed densely at the front, the identifiers follow behind them
+    unsigned long long seqLength = 0;
+    for (size_t pos = 0; pos < data.size(); ) {
+
+        SpillRecord rec;
+        memcpy(&rec, data.data() + pos, sizeof(SpillRecord));
+        seqLength += rec.seqLen + 1;
+        pos += sizeof(SpillRecord) + rec.idLen + rec.seqLen;
+
+    }
+
+    char* nextSeq = strings;
+    char* nextId = strings + seqLength;
+    size_t pos = 0;
+    for (numSeqs_t j = 0; j < sp.size; j++) {
+
+        SpillRecord rec;
+        memcpy(&rec, data.data() + pos, sizeof(SpillRecord));
+        pos += sizeof(SpillRecord);
+
+        char* id = nextId;
+        memcpy(nextId, data.data() + pos, rec.idLen);
+        nextId[rec.idLen] = '\0';
+        nextId += rec.idLen + 1;
+        pos += rec.idLen;
+
+        char* seq = nextSeq;
+        memcpy(nextSeq, data.data() + pos, rec.seqLen);
+        nextSeq[rec.seqLen] = '\0';
+        nextSeq += rec.seqLen + 1;
+        pos += rec.seqLen;
+
+        ac->push_back(Amplicon(id, seq, rec.seqLen, rec.abundance));
+        memcpy(&(*ac)[j].rank, ranks.data() + j * sizeof(numSeqs_t), sizeof(numSeqs_t));
+
+    }
+
+    assignSeqGroups(*ac);
+    pools.install(i, ac, strings);
+
+}
+
+}
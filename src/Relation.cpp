@@ -0,0 +1,265 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#include "../include/Relation.hpp"
+
+#include <cstring>
+#include <thread>
+
+namespace GeFaST {
+
+// append the variable-length encoding of val (7 bits per byte, highest bit set on all but the last byte)
+inline void encodeVarint(unsigned long val, std::vector<unsigned char>& bytes) {
+
+    while (val >= 0x80) {
+
+        bytes.push_back((unsigned char)((val & 0x7F) | 0x80));
+        val >>= 7;
+
+    }
+    bytes.push_back((unsigned char)val);
+
+}
+
+// decode the variable-length integer starting at pos and advance pos behind it
+inline unsigned long decodeVarint(const unsigned char*& pos) {
+
+    unsigned long val = 0;
+    unsigned shift = 0;
+
+    while (*pos & 0x80) {
+
+        val |= (unsigned long)(*pos & 0x7F) << shift;
+        shift += 7;
+        pos++;
+
+    }
+    val |= (unsigned long)(*pos) << shift;
+    pos++;
+
+    return val;
+
+}
+
+MatchGraph::MatchGraph() {
+
+    offsets_.push_back(0);
+    numMatches_ = 0;
+
+}
+
+MatchGraph::MatchGraph(const numSeqs_t numNodes, Matches& matches, const unsigned long numThreads) {
+
+    // each thread encodes a contiguous range of amplicons, the encodings are concatenated afterwards
+    unsigned long numParts = std::max(1UL, std::min(numThreads, (unsigned long) numNodes));
+    std::vector<std::vector<unsigned char>> bytes(numParts);
+    std::vector<std::vector<unsigned long>> offsets(numParts);
+    std::vector<unsigned long> cnts(numParts, 0);
+
+    std::vector<std::thread> threads;
+    for (unsigned long t = 0; t < numParts; t++) {
+        threads.emplace_back(&MatchGraph::encodeRange, numNodes * t / numParts, numNodes * (t + 1) / numParts, std::ref(matches),
+                             std::ref(bytes[t]), std::ref(offsets[t]), std::ref(cnts[t]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    unsigned long total = 0;
+    for (auto& b : bytes) {
+        total += b.size();
+    }
+
+    offsets_.reserve(numNodes + 1);
+    data_.reserve(total);
+    numMatches_ = 0;
+    for (unsigned long t = 0; t < numParts; t++) {
+
+        for (auto o : offsets[t]) {
+            offsets_.push_back(data_.size() + o);
+        }
+        data_.insert(data_.end(), bytes[t].begin(), bytes[t].end());
+        std::vector<unsigned char>().swap(bytes[t]);
+
+        numMatches_ += cnts[t];
+
+    }
+    offsets_.push_back(data_.size());
+
+}
+
+void MatchGraph::encodeRange(const numSeqs_t first, const numSeqs_t last, Matches& matches,
+                             std::vector<unsigned char>& bytes, std::vector<unsigned long>& offsets, unsigned long& cnt) {
+
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> partners;
+
+    for (numSeqs_t i = first; i < last; i++) {
+
+        offsets.push_back(bytes.size());
+
+        // only reading accesses, which do not interfere with each other
+        partners = matches.getMatchesOfAugmented(i);
+        std::sort(partners.begin(), partners.end());
+
+        numSeqs_t prev = 0;
+        for (auto& p : partners) {
+
+            encodeVarint(p.first - prev, bytes);
+            encodeVarint(p.second, bytes);
+            prev = p.first;
+
+        }
+
+        cnt += partners.size();
+
+    }
+
+}
+
+void MatchGraph::getMatchesOfAugmented(const numSeqs_t id, std::vector<std::pair<numSeqs_t, lenSeqs_t>>& res) const {
+
+    res.clear();
+
+    const unsigned char* pos = data_.data() + offsets_[id];
+    const unsigned char* end = data_.data() + offsets_[id + 1];
+    numSeqs_t partner = 0;
+
+    while (pos < end) {
+
+        partner += decodeVarint(pos);
+        lenSeqs_t dist = decodeVarint(pos);
+        res.emplace_back(partner, dist);
+
+    }
+
+}
+
+std::vector<std::pair<numSeqs_t, lenSeqs_t>> MatchGraph::getMatchesOfAugmented(const numSeqs_t id) const {
+
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> res;
+    getMatchesOfAugmented(id, res);
+
+    return res;
+
+}
+
+numSeqs_t MatchGraph::numNodes() const {
+    return offsets_.size() - 1;
+}
+
+unsigned long MatchGraph::numMatches() const {
+    return numMatches_ / 2; // every pair is stored for both amplicons
+}
+
+unsigned long MatchGraph::numBytes() const {
+    return data_.size() * sizeof(unsigned char) + offsets_.size() * sizeof(unsigned long);
+}
+
+
+MatchWriter::MatchWriter(const std::string& oFile, const bool binary) : binary_(binary), numMatches_(0) {
+
+    oStream_.open(oFile, binary ? (std::ios::out | std::ios::binary) : std::ios::out);
+
+    if (binary_) {
+
+        const char header[6] = {'G', 'F', 'M', 'J', (char)sizeof(numSeqs_t), (char)sizeof(lenSeqs_t)};
+        oStream_.write(header, 6);
+
+    }
+
+}
+
+MatchWriter::~MatchWriter() {
+    oStream_.close();
+}
+
+void MatchWriter::write(const std::string& block, const unsigned long num) {
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    oStream_.write(block.data(), block.size());
+    numMatches_ += num;
+
+}
+
+bool MatchWriter::binary() const {
+    return binary_;
+}
+
+bool MatchWriter::good() const {
+    return oStream_.good();
+}
+
+unsigned long long MatchWriter::numMatches() const {
+    return numMatches_.load();
+}
+
+
+MatchBuffer::MatchBuffer(MatchWriter& writer, const AmpliconCollection& ac, const unsigned long capacity) :
+        writer_(writer), ac_(ac), size_(0), capacity_(capacity) {
+    block_.reserve(capacity_ * (writer_.binary() ? 2 * sizeof(numSeqs_t) + sizeof(lenSeqs_t) : 32));
+}
+
+MatchBuffer::~MatchBuffer() {
+    flush();
+}
+
+void MatchBuffer::add(const numSeqs_t i, const numSeqs_t j, const lenSeqs_t dist) {
+
+    const Amplicon* first = &ac_[i];
+    const Amplicon* second = &ac_[j];
+    if (second->rank < first->rank) std::swap(first, second);
+
+    if (writer_.binary()) {
+
+        char rec[2 * sizeof(numSeqs_t) + sizeof(lenSeqs_t)];
+        memcpy(rec, &first->rank, sizeof(numSeqs_t));
+        memcpy(rec + sizeof(numSeqs_t), &second->rank, sizeof(numSeqs_t));
+        memcpy(rec + 2 * sizeof(numSeqs_t), &dist, sizeof(lenSeqs_t));
+        block_.append(rec, sizeof(rec));
+
+    } else {
+
+        block_.append(first->id);
+        block_.push_back('\t');
+        block_.append(second->id);
+        block_.push_back('\t');
+        block_.append(std::to_string(dist));
+        block_.push_back('\n');
+
+    }
+
+    if (++size_ == capacity_) flush();
+
+}
+
+void MatchBuffer::flush() {
+
+    if (size_ == 0) return;
+
+    writer_.write(block_, size_);
+    block_.clear();
+    size_ = 0;
+
+}
+
+}
@@ -149,7 +149,8 @@ void SegmentFilter::filterForward(const AmpliconCollection& ac, const Subpool& s
 }
 
 
-void SegmentFilter::filterForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+template<typename S>
+void SegmentFilter::filterForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                           const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring) {
 
     RollingIndices<InvertedIndex> indices(t + 1, t + k, true);
@@ -233,7 +234,7 @@ void SegmentFilter::filterForwardDirectly(const AmpliconCollection& ac, const Su
 
             // general pigeonhole principle: for being a candidate, at least k segments have to be matched
             lenSeqs_t cnt = 0;
-            numSeqs_t prevCand = (candCnts.front() > 0) ? candCnts.front() : 0;
+            numSeqs_t prevCand = (candCnts.size() > 0) ? candCnts.front() : 0;
             for (auto candId : candCnts) {
 
                 if (prevCand != candId) {
@@ -415,7 +416,8 @@ void SegmentFilter::filterBackward(const AmpliconCollection& ac, const Subpool&
 }
 
 
-void SegmentFilter::filterBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+template<typename S>
+void SegmentFilter::filterBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                            const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring) {
 
     RollingIndices<InvertedIndex> indices(t + 1, t + k, false);
@@ -726,7 +728,8 @@ void SegmentFilter::filterForwardBackward(const AmpliconCollection& ac, const Su
 }
 
 
-void SegmentFilter::filterForwardBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+template<typename S>
+void SegmentFilter::filterForwardBackwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                                   const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring) {
 
     RollingIndices<InvertedIndex> indices(t + 1, t + k, true);
@@ -1082,7 +1085,8 @@ void SegmentFilter::filterBackwardForward(const AmpliconCollection& ac, const Su
 }
 
 
-void SegmentFilter::filterBackwardForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+template<typename S>
+void SegmentFilter::filterBackwardForwardDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                                   const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring) {
 
     RollingIndices<InvertedIndex> indices(t + 1, t + k, false);
@@ -1302,7 +1306,8 @@ void SegmentFilter::filter(const AmpliconCollection& ac, const Subpool& sp, Rota
 
 }
 
-void SegmentFilter::filterDirectly(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+template<typename S>
+void SegmentFilter::filterDirectly(const AmpliconCollection& ac, const Subpool& sp, S& matches,
                                    const lenSeqs_t t, const lenSeqs_t k, const int mode, const bool useScore, const Verification::Scoring& scoring) {
 
     switch (mode) {
@@ -1330,4 +1335,28 @@ void SegmentFilter::filterDirectly(const AmpliconCollection& ac, const Subpool&
 
 }
 
-}
\ No newline at end of file
+// explicit instantiations for the supported match sinks
+template void SegmentFilter::filterForwardDirectly<Matches>(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+                                                            const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterBackwardDirectly<Matches>(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+                                                             const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterForwardBackwardDirectly<Matches>(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+                                                                    const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterBackwardForwardDirectly<Matches>(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+                                                                    const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterDirectly<Matches>(const AmpliconCollection& ac, const Subpool& sp, Matches& matches,
+                                                     const lenSeqs_t t, const lenSeqs_t k, const int mode, const bool useScore, const Verification::Scoring& scoring);
+
+
+template void SegmentFilter::filterForwardDirectly<MatchBuffer>(const AmpliconCollection& ac, const Subpool& sp, MatchBuffer& matches,
+                                                                const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterBackwardDirectly<MatchBuffer>(const AmpliconCollection& ac, const Subpool& sp, MatchBuffer& matches,
+                                                                 const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterForwardBackwardDirectly<MatchBuffer>(const AmpliconCollection& ac, const Subpool& sp, MatchBuffer& matches,
+                                                                        const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterBackwardForwardDirectly<MatchBuffer>(const AmpliconCollection& ac, const Subpool& sp, MatchBuffer& matches,
+                                                                        const lenSeqs_t t, const lenSeqs_t k, const bool useScore, const Verification::Scoring& scoring);
+template void SegmentFilter::filterDirectly<MatchBuffer>(const AmpliconCollection& ac, const Subpool& sp, MatchBuffer& matches,
+                                                         const lenSeqs_t t, const lenSeqs_t k, const int mode, const bool useScore, const Verification::Scoring& scoring);
+
+}
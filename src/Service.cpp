@@ -0,0 +1,348 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#include "../include/Service.hpp"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace GeFaST {
+
+/*
+ * Read one request line from the connection (without the line break).
+ * Returns false if the connection is closed before anything was read.
+ */
+// remove the socket file of an earlier service that is no longer listening (no file or a removed stale socket yields true)
+inline bool removeStaleSocket(const sockaddr_un& addr) {
+
+    struct stat st;
+    if (lstat(addr.sun_path, &st) != 0) {
+
+        if (errno == ENOENT) return true;
+
+        std::cerr << "ERROR: Could not inspect socket path " << addr.sun_path << " (" << strerror(errno) << ")." << std::endl;
+        return false;
+
+    }
+
+    if (!S_ISSOCK(st.st_mode)) {
+
+        std::cerr << "ERROR: " << addr.sun_path << " exists and is not a socket." << std::endl;
+        return false;
+
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+
+        std::cerr << "ERROR: Could not create a socket (" << strerror(errno) << ")." << std::endl;
+        return false;
+
+    }
+
+    bool connected = (connect(fd, (const sockaddr*) &addr, sizeof(addr)) == 0);
+    int err = errno;
+    close(fd);
+
+    if (connected) {
+
+        std::cerr << "ERROR: Socket " << addr.sun_path << " is still in use by another service." << std::endl;
+        return false;
+
+    }
+
+    if (err != ECONNREFUSED) {
+
+        std::cerr << "ERROR: Could not check socket " << addr.sun_path << " (" << strerror(err) << ")." << std::endl;
+        return false;
+
+    }
+
+    unlink(addr.sun_path);
+
+    return true;
+
+}
+
+inline bool readRequest(int conn, std::string& request) {
+
+    request.clear();
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(conn, buf, sizeof(buf), 0)) != 0) {
+
+        if (n < 0) {
+
+            if (errno == EINTR) continue;
+            return false;
+
+        }
+
+        request.append(buf, n);
+        auto pos = request.find('\n');
+        if (pos != std::string::npos) {
+
+            request.resize(pos);
+            break;
+
+        }
+
+    }
+
+    if (!request.empty() && request.back() == '\r') request.pop_back();
+
+    return !request.empty();
+
+}
+
+/*
+ * Write the reply line to the connection (a vanished client must not terminate the service).
+ */
+inline void writeReply(int conn, const std::string& reply) {
+
+    std::string line = reply + "\n";
+    const char* pos = line.data();
+    size_t left = line.size();
+    while (left > 0) {
+
+        ssize_t n = send(conn, pos, left, MSG_NOSIGNAL);
+        if (n < 0) {
+
+            if (errno == EINTR) continue;
+            return;
+
+        }
+
+        pos += n;
+        left -= n;
+
+    }
+
+}
+
+std::string Service::handleRequest(const std::string& request, const Config<std::string>& conf, ResidentData& data, JobRunner runner,
+                                   bool& shutdown) {
+
+    std::vector<std::string> tokens;
+    std::stringstream sStream(request);
+    std::string token;
+    while (sStream >> token) {
+        tokens.push_back(token);
+    }
+
+    if (tokens.empty()) return "ERROR empty request";
+
+    if (tokens[0] == "shutdown") {
+
+        shutdown = true;
+        return "OK";
+
+    }
+
+    if (tokens[0] == "assign") {
+
+        if (data.refs == 0) return "ERROR no resident references (start the service with --assign-reference)";
+        if (tokens.size() < 3) return "ERROR expected: assign <output file> <query file>...";
+
+        std::vector<std::string> queryFiles(tokens.begin() + 2, tokens.end());
+        bool success = Assignment::assignFiles(conf, *data.refs, *data.indices, queryFiles, tokens[1], data.ac);
+
+        return success ? "OK" : "ERROR assignment to " + tokens[1] + " failed";
+
+    }
+
+    if (tokens[0] == "cluster") {
+
+        if (tokens.size() < 2) return "ERROR expected: cluster <arguments>...";
+
+        std::vector<const char*> args(1, "GeFaST");
+        for (auto iter = tokens.begin() + 1; iter != tokens.end(); iter++) {
+            args.push_back(iter->c_str());
+        }
+
+        // the socket can also be requested through a config file (-c), so inspect the parsed configuration
+        if (getConfiguration(args.size(), args.data()).peek(SERVICE_SOCKET)) return "ERROR a job cannot start another service";
+
+        int code = runner(args.size(), args.data());
+
+        return (code == 0) ? "OK" : "ERROR job exited with code " + std::to_string(code);
+
+    }
+
+    return "ERROR unknown request '" + tokens[0] + "' (expected assign, cluster or shutdown)";
+
+}
+
+bool Service::serve(const Config<std::string>& conf, const AmpliconPools* refPools, const Assignment::AssignConfig& ac,
+                    const ServiceConfig& svc, JobRunner runner) {
+
+    sockaddr_un addr;
+    if (svc.socketPath.size() >= sizeof(addr.sun_path)) {
+
+        std::cerr << "ERROR: Socket path " << svc.socketPath << " is too long." << std::endl;
+        return false;
+
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, svc.socketPath.c_str());
+
+    if (!removeStaleSocket(addr)) return false;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+
+        std::cerr << "ERROR: Could not listen on socket " << svc.socketPath << " (" << strerror(errno) << ")." << std::endl;
+        if (fd >= 0) close(fd);
+        return false;
+
+    }
+
+    ResidentData data;
+    data.ac = ac;
+    if (refPools != 0) {
+
+        std::cout << "Indexing references..." << std::endl;
+        data.indices = new Assignment::ReferenceIndices(ac.threshold, ac.threshold + ac.extraSegs, true, false);
+        data.refs = Assignment::indexReferences(*refPools, *data.indices, ac);
+
+    }
+
+    std::cout << "Waiting for requests on " << svc.socketPath << "..." << std::endl << std::endl;
+
+    std::queue<int> pending; // accepted connections waiting for a job thread
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+    bool failed = false; // accepting connections failed
+
+    auto processRequests = [&]() {
+
+        std::string request;
+        while (true) {
+
+            int conn;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&]() { return !pending.empty() || stopping; });
+                if (pending.empty()) break;
+
+                conn = pending.front();
+                pending.pop();
+            }
+
+            if (readRequest(conn, request)) {
+
+                bool shutdown = false;
+                std::string reply = handleRequest(request, conf, data, runner, shutdown);
+                writeReply(conn, reply);
+
+                if (shutdown) {
+
+                    {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        stopping = true;
+                    }
+                    cv.notify_all();
+                    ::shutdown(fd, SHUT_RDWR); // wakes up the blocked accept
+
+                }
+
+            }
+
+            close(conn);
+
+        }
+
+    };
+
+    std::vector<std::thread> jobs;
+    for (unsigned long j = 0; j < svc.numJobs; j++) {
+        jobs.emplace_back(processRequests);
+    }
+
+    while (true) {
+
+        int conn = accept(fd, 0, 0);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+
+            if (conn >= 0) close(conn);
+            break;
+
+        }
+
+        if (conn < 0) {
+
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+
+            std::cerr << "ERROR: Could not accept a connection on socket " << svc.socketPath << " (" << strerror(errno) << ")." << std::endl;
+            stopping = true;
+            failed = true;
+            break;
+
+        }
+
+        timeval timeout;
+        timeout.tv_sec = svc.requestTimeout;
+        timeout.tv_usec = 0;
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)); // silent clients must not block a job thread
+
+        pending.push(conn);
+        cv.notify_one();
+
+    }
+    cv.notify_all();
+
+    for (auto& job : jobs) {
+        job.join();
+    }
+
+    close(fd);
+    unlink(svc.socketPath.c_str());
+
+    delete data.refs;
+    delete data.indices;
+
+    std::cout << "Service stopped." << std::endl;
+
+    return !failed;
+
+}
+
+}
@@ -0,0 +1,119 @@
+/*
+ * GeFaST
+ *
+ * Copyright (C) 2016 - 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+
+#include "../include/SimilarityJoin.hpp"
+
+#include <iostream>
+#include <thread>
+
+namespace GeFaST {
+
+AmpliconCollection* SimilarityJoin::sortByLength(const AmpliconCollection& ac) {
+
+    std::vector<std::pair<lenSeqs_t, numSeqs_t>> counts;
+    for (auto len : ac.allLengths()) {
+        counts.push_back(std::make_pair(len, ac.numSeqsOfLen(len)));
+    }
+
+    AmpliconCollection* sorted = new AmpliconCollection(ac.size(), counts);
+    for (auto iter = ac.begin(); iter != ac.end(); iter++) {
+        sorted->push_back(*iter);
+    }
+
+    // stable sorting keeps the amplicons of the same length ordered by abundance
+    std::stable_sort(sorted->begin(), sorted->end(), AmpliconCompareLen());
+
+    return sorted;
+
+}
+
+void SimilarityJoin::joinTasks(const std::vector<JoinTask>& tasks, std::atomic<unsigned long>& nextTask, MatchWriter& writer, const JoinConfig& jc) {
+
+    for (auto i = nextTask++; i < tasks.size(); i = nextTask++) {
+
+        MatchBuffer buffer(writer, *(tasks[i].ac));
+        SegmentFilter::filterDirectly(*(tasks[i].ac), tasks[i].sp, buffer, jc.threshold, jc.extraSegs, jc.filterMode,
+                                      jc.useScore, jc.scoring);
+
+    }
+
+}
+
+void SimilarityJoin::join(const AmpliconPools& pools, const JoinConfig& jc) {
+
+    MatchWriter writer(jc.oFile, jc.binary);
+    if (!writer.good()) {
+
+        std::cerr << "ERROR: Could not open output file " << jc.oFile << "." << std::endl;
+        return;
+
+    }
+
+    bool backward = (jc.filterMode == 1) || (jc.filterMode == 3);
+    std::vector<AmpliconCollection*> sortedPools;
+    std::vector<JoinTask> tasks;
+
+    std::cout << "Joining..." << std::endl;
+    for (lenSeqs_t p = 0; p < pools.numPools(); p++) {
+
+        AmpliconCollection* ac = pools.get(p);
+        if (ac->size() < 2) continue;
+
+        sortedPools.push_back(sortByLength(*ac));
+
+        // number of subpools proportional to the share of the pool (rounded up)
+        numSeqs_t num = std::min((unsigned long long)jc.numWorkers,
+                                 ((unsigned long long)ac->size() * jc.numWorkers + pools.numAmplicons() - 1) / pools.numAmplicons());
+
+        auto subpools = backward ? getSubpoolBoundariesBackward(*(sortedPools.back()), num, jc.threshold)
+                                 : getSubpoolBoundaries(*(sortedPools.back()), num, jc.threshold);
+        for (auto& sp : subpools) {
+            tasks.push_back(JoinTask(sortedPools.back(), sp));
+        }
+
+    }
+
+    // largest subpools first (amplicons to be filtered and index-only amplicons)
+    std::stable_sort(tasks.begin(), tasks.end(), [](const JoinTask& a, const JoinTask& b) {
+        return (a.sp.end - std::min(a.sp.beginIndex, a.sp.beginMatch)) > (b.sp.end - std::min(b.sp.beginIndex, b.sp.beginMatch));
+    });
+
+    std::atomic<unsigned long> nextTask(0);
+    std::thread workers[jc.numWorkers];
+    for (unsigned long w = 0; w < jc.numWorkers; w++) {
+        workers[w] = std::thread(&SimilarityJoin::joinTasks, std::ref(tasks), std::ref(nextTask), std::ref(writer), std::ref(jc));
+    }
+    for (unsigned long w = 0; w < jc.numWorkers; w++) {
+        workers[w].join();
+    }
+
+    for (auto ac : sortedPools) {
+        delete ac;
+    }
+
+    std::cout << "Found " << writer.numMatches() << " matches." << std::endl << std::endl;
+
+}
+
+}
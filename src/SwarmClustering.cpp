@@ -21,12 +21,25 @@
  * PO box 100131, DE-33501 Bielefeld, Germany
  */
 
+#include "../include/Microvariants.hpp"
+#include "../include/Preprocessor.hpp"
 #include "../include/SIMD.hpp"
 #include "../include/SwarmClustering.hpp"
 #include "../include/SwarmingSegmentFilter.hpp"
 
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
 #include <set>
 #include <sstream>
 #include <thread>
@@ -35,7 +48,107 @@
 
 namespace GeFaST {
 
-void SwarmClustering::explorePool(const AmpliconCollection& ac, Matches& matches, std::vector<Otu*>& otus, const SwarmConfig& sc) {
+SwarmClustering::OtuArena::OtuArena() {
+
+    otuBlockSize_ = otusUsed_ = 0;
+    memberBlockSize_ = membersUsed_ = openBegin_ = 0;
+
+}
+
+SwarmClustering::OtuArena::~OtuArena() {
+
+    for (auto b : otuBlocks_) {
+        delete[] b;
+    }
+    for (auto b : memberBlocks_) {
+        delete[] b;
+    }
+
+}
+
+SwarmClustering::Otu* SwarmClustering::OtuArena::newOtu(const Amplicon* ampls) {
+
+    if (otusUsed_ == otuBlockSize_) {
+
+        otuBlockSize_ = (otuBlockSize_ == 0) ? MIN_BLOCK_SIZE : std::min(2 * otuBlockSize_, MAX_BLOCK_SIZE);
+        otuBlocks_.push_back(new Otu[otuBlockSize_]);
+        otusUsed_ = 0;
+
+    }
+
+    Otu* otu = otuBlocks_.back() + otusUsed_++;
+    otu->ampls = ampls;
+
+    return otu;
+
+}
+
+void SwarmClustering::OtuArena::addMember(const OtuEntry& entry) {
+
+    if (membersUsed_ == memberBlockSize_) {
+
+        // move the open members to the beginning of a new block that can hold (at least) twice as many members
+        numSeqs_t numOpen = membersUsed_ - openBegin_;
+        numSeqs_t size = (memberBlockSize_ == 0) ? MIN_BLOCK_SIZE : std::min(2 * memberBlockSize_, MAX_BLOCK_SIZE);
+        size = std::max(size, 2 * numOpen);
+
+        OtuEntry* block = new OtuEntry[size];
+        if (numOpen > 0) {
+            std::copy(memberBlocks_.back() + openBegin_, memberBlocks_.back() + membersUsed_, block);
+        }
+
+        // a block containing only open members is not referenced by any closed OTU
+        if (numOpen > 0 && openBegin_ == 0) {
+
+            delete[] memberBlocks_.back();
+            memberBlocks_.back() = block;
+
+        } else {
+            memberBlocks_.push_back(block);
+        }
+
+        memberBlockSize_ = size;
+        membersUsed_ = numOpen;
+        openBegin_ = 0;
+
+    }
+
+    memberBlocks_.back()[membersUsed_++] = entry;
+
+}
+
+SwarmClustering::OtuEntry* SwarmClustering::OtuArena::openMembers() const {
+    return memberBlocks_.empty() ? 0 : memberBlocks_.back() + openBegin_;
+}
+
+numSeqs_t SwarmClustering::OtuArena::numOpenMembers() const {
+    return membersUsed_ - openBegin_;
+}
+
+void SwarmClustering::OtuArena::closeMembers(Otu& otu) {
+
+    otu.members = openMembers();
+    otu.numMembers = numOpenMembers();
+    openBegin_ = membersUsed_;
+
+}
+
+void SwarmClustering::OtuArena::absorb(OtuArena& other) {
+
+    // the blocks are inserted at the front to keep filling the current last blocks
+    otuBlocks_.insert(otuBlocks_.begin(), other.otuBlocks_.begin(), other.otuBlocks_.end());
+    memberBlocks_.insert(memberBlocks_.begin(), other.memberBlocks_.begin(), other.memberBlocks_.end());
+
+    other.otuBlocks_.clear();
+    other.memberBlocks_.clear();
+    other.otuBlockSize_ = other.otusUsed_ = 0;
+    other.memberBlockSize_ = other.membersUsed_ = other.openBegin_ = 0;
+
+}
+
+
+void SwarmClustering::explorePool(const AmpliconCollection& ac, const MatchGraph& graph, std::vector<Otu*>& otus, OtuArena& arena,
+                                  const SwarmConfig& sc) {
 
     // determine order of amplicons based on abundance (descending) without invalidating the integer (position) ids of the amplicons
     std::vector<numSeqs_t> index(ac.size());
@@ -43,10 +156,11 @@ void SwarmClustering::explorePool(const AmpliconCollection& ac, Matches& matches
     std::sort(index.begin(), index.end(), CompareIndicesAbund(ac));
 
     Otu* curOtu = 0;
-    std::vector<SwarmClustering::OtuEntryPrecursor> tmpMembers;
+    std::vector<SwarmClustering::OtuEntry> sortBuffer;
     std::vector<bool> visited(ac.size(), false); // visited amplicons are already included in an OTU
+    std::vector<lenSeqs_t> rads(ac.size(), 0); // radius of the amplicons (accumulated differences to their OTU seed)
 
-    OtuEntryPrecursor curSeed, newSeed;
+    OtuEntry curSeed, newSeed;
     bool unique;
     std::unordered_set<StringIteratorPair, hashStringIteratorPair, equalStringIteratorPair> uniqueSeqs;
     std::vector<std::pair<numSeqs_t, lenSeqs_t>> next;
@@ -60,60 +174,64 @@ void SwarmClustering::explorePool(const AmpliconCollection& ac, Matches& matches
         if (!visited[*seedIter]) {
 
             /* (a) Initialise new OTU with seed */
-            curOtu = new Otu();
+            curOtu = arena.newOtu(begin);
 
-            newSeed.member = &ac[*seedIter];
+            newSeed.member = *seedIter;
             newSeed.parent = newSeed.member;
             newSeed.parentDist = 0;
             newSeed.gen = 0;
-            newSeed.rad = 0;
-            tmpMembers.push_back(newSeed);
+            arena.addMember(newSeed);
 
             visited[*seedIter] = true;
-            uniqueSeqs.insert(StringIteratorPair(newSeed.member->seq, newSeed.member->seq + newSeed.member->len));
+            uniqueSeqs.insert(StringIteratorPair(ac[newSeed.member].seq, ac[newSeed.member].seq + ac[newSeed.member].len));
 
             lastGen = 0;
 
 
             /* (b) BFS through 'match space' */
             pos = 0;
-            while (pos < tmpMembers.size()) { // expand current OTU until no further similar amplicons can be added
+            while (pos < arena.numOpenMembers()) { // expand current OTU until no further similar amplicons can be added
 
-                if (lastGen != tmpMembers[pos].gen) { // work through generation by decreasing abundance
+                if (lastGen != arena.openMembers()[pos].gen) { // work through generation by decreasing abundance
 
                     uniqueSeqs.clear();
-                    std::sort(tmpMembers.begin() + pos, tmpMembers.end(), CompareOtuEntryPrecursorsAbund());
+                    sortGeneration(arena.openMembers() + pos, arena.openMembers() + arena.numOpenMembers(), sortBuffer,
+                            [begin](const OtuEntry& e) {return begin[e.member].rank;});
 
                 }
 
                 // get next OTU (sub)seed
-                curSeed = tmpMembers[pos];
+                curSeed = arena.openMembers()[pos];
 
                 // unique sequences contribute when they occur, non-unique sequences only at their first occurrence
                 unique = (curSeed.parentDist != 0) &&
-                        uniqueSeqs.insert(StringIteratorPair(curSeed.member->seq, curSeed.member->seq + curSeed.member->len)).second;
+                        uniqueSeqs.insert(StringIteratorPair(ac[curSeed.member].seq, ac[curSeed.member].seq + ac[curSeed.member].len)).second;
 
                 // update OTU information
-                curOtu->mass += curSeed.member->abundance;
+                curOtu->mass += ac[curSeed.member].abundance;
 
                 // Consider yet unseen (unvisited) amplicons to continue the exploration.
                 // An amplicon is marked as 'visited' as soon as it occurs the first time as matching partner
                 // in order to prevent the algorithm from queueing it more than once coming from different amplicons.
-                next = matches.getMatchesOfAugmented(curSeed.member - begin);
+                // Like in the swarm filters, only these amplicons (the children) decide on the uniqueness of the sequence.
+                graph.getMatchesOfAugmented(curSeed.member, next);
                 for (auto matchIter = next.begin(); matchIter != next.end(); matchIter++) {
 
-                    unique &= (matchIter->second != 0);
+                    if (!visited[matchIter->first] && (matchIter->second <= sc.threshold)
+                        && (sc.noOtuBreaking || ac[matchIter->first].abundance <= ac[curSeed.member].abundance)) {
 
-                    if (!visited[matchIter->first] && (sc.noOtuBreaking || ac[matchIter->first].abundance <= curSeed.member->abundance)) {
+                        unique &= (matchIter->second != 0);
 
-                        newSeed.member = begin + matchIter->first;
+                        newSeed.member = matchIter->first;
                         newSeed.parent = curSeed.member;
                         newSeed.parentDist = matchIter->second;
                         newSeed.gen = curSeed.gen + 1;
-                        newSeed.rad = curSeed.rad + matchIter->second;
-                        tmpMembers.push_back(newSeed);
+                        arena.addMember(newSeed);
                         visited[matchIter->first] = true;
 
+                        rads[matchIter->first] = rads[curSeed.member] + matchIter->second;
+                        curOtu->maxRad = std::max(curOtu->maxRad, rads[matchIter->first]);
+
                     }
 
                 }
@@ -127,8 +245,7 @@ void SwarmClustering::explorePool(const AmpliconCollection& ac, Matches& matches
 
             /* (c) Close the no longer extendable OTU */
             uniqueSeqs.clear();
-            curOtu->setMembers(tmpMembers);
-            std::vector<SwarmClustering::OtuEntryPrecursor>().swap(tmpMembers);
+            arena.closeMembers(*curOtu);
             otus.push_back(curOtu);
 
         }
@@ -137,6 +254,47 @@ void SwarmClustering::explorePool(const AmpliconCollection& ac, Matches& matches
 
 }
 
+void SwarmClustering::computeMatchGraph(const AmpliconCollection& ac, MatchGraph& graph, const SwarmConfig& sc) {
+
+    // sort (positions of) amplicons by length, as required by the segment filter
+    std::vector<numSeqs_t> perm(ac.size());
+    std::iota(perm.begin(), perm.end(), 0);
+    std::stable_sort(perm.begin(), perm.end(), [&ac](const numSeqs_t a, const numSeqs_t b) {
+        return ac[a].len < ac[b].len;
+    });
+
+    std::vector<std::pair<lenSeqs_t, numSeqs_t>> counts;
+    for (auto len : ac.allLengths()) {
+        counts.push_back(std::make_pair(len, ac.numSeqsOfLen(len)));
+    }
+    AmpliconCollection sorted(ac.size(), counts);
+    for (auto i : perm) {
+        sorted.push_back(ac[i]);
+    }
+
+    Matches matches;
+    {
+        Matches sortedMatches;
+        SegmentFilter::filterDirectly(sorted, Subpool(0, 0, sorted.size()), sortedMatches, sc.threshold, sc.extraSegs, 0,
+                                      sc.useScore, sc.scoring);
+
+        // translate the matches back to the positions in the pool
+        for (numSeqs_t i = 0; i < sorted.size(); i++) {
+
+            for (auto& m : sortedMatches.getMatchesOfAugmented(i)) {
+
+                if (i < m.first) {
+                    matches.add(perm[i], perm[m.first], m.second);
+                }
+
+            }
+
+        }
+    }
+
+    graph = MatchGraph(ac.size(), matches, 1);
+
+}
 
 void SwarmClustering::fastidiousIndexOtu(PrecursorIndices& indices, std::vector<std::pair<lenSeqs_t, Segments>>& segmentsArchive,
                                          const AmpliconCollection& ac, Otu& otu, std::vector<GraftCandidate>& graftCands, const SwarmConfig& sc) {
@@ -144,7 +302,7 @@ void SwarmClustering::fastidiousIndexOtu(PrecursorIndices& indices, std::vector<
     auto begin = ac.begin();
     for (numSeqs_t m = 0; m < otu.numMembers; m++) {
 
-        auto ampl = otu.members[m].member;
+        auto ampl = otu.amplicon(otu.members[m].member);
         Segments& segments = std::lower_bound(segmentsArchive.begin(), segmentsArchive.end(), ampl->len,
                                               [](const std::pair<lenSeqs_t, Segments>& lhs, const lenSeqs_t rhs) {return lhs.first < rhs;})->second;
         indices.roll(ampl->len);
@@ -162,7 +320,7 @@ void SwarmClustering::fastidiousIndexOtu(PrecursorIndices& indices, std::vector<
 }
 
 inline bool compareCandidates(const Amplicon& newCand, const Amplicon& oldCand) {
-    return (newCand.abundance > oldCand.abundance) || ((newCand.abundance == oldCand.abundance) && (strcmp(newCand.id, oldCand.id) < 0));
+    return newCand.rank < oldCand.rank;
 }
 
 void SwarmClustering::verifyFastidious(const AmpliconPools& pools, const AmpliconCollection& acOtus, const AmpliconCollection& acIndices,
@@ -185,16 +343,16 @@ void SwarmClustering::verifyFastidious(const AmpliconPools& pools, const Amplico
 
                 std::unique_lock<std::mutex> lock(mtx);
                 if ((graftCands[*childIter].parentOtu == 0) ||
-                        compareCandidates(*c.parentMember->member, *graftCands[*childIter].parentMember->member)) {
+                        compareCandidates(*c.parentAmplicon(), *graftCands[*childIter].parentAmplicon())) {
 
                     lock.unlock();
-                    if (Verification::computeLengthAwareRow(c.parentMember->member->seq, c.parentMember->member->len,
+                    if (Verification::computeLengthAwareRow(c.parentAmplicon()->seq, c.parentAmplicon()->len,
                                                             acIndices[*childIter].seq, acIndices[*childIter].len,
                                                             t, M) <= t) {
 
                         lock.lock();
                         if ((graftCands[*childIter].parentOtu == 0) ||
-                                compareCandidates(*c.parentMember->member, *graftCands[*childIter].parentMember->member)) {
+                                compareCandidates(*c.parentAmplicon(), *graftCands[*childIter].parentAmplicon())) {
 
                             graftCands[*childIter].parentOtu = c.parentOtu;
                             graftCands[*childIter].parentMember = c.parentMember;
@@ -239,16 +397,16 @@ void SwarmClustering::verifyGotohFastidious(const AmpliconPools& pools, const Am
 
                 std::unique_lock<std::mutex> lock(mtx);
                 if ((graftCands[*childIter].parentOtu == 0) ||
-                        compareCandidates(*c.parentMember->member, *graftCands[*childIter].parentMember->member)) {
+                        compareCandidates(*c.parentAmplicon(), *graftCands[*childIter].parentAmplicon())) {
 
                     lock.unlock();
-                    if (Verification::computeGotohLengthAwareEarlyRow(c.parentMember->member->seq, c.parentMember->member->len,
+                    if (Verification::computeGotohLengthAwareEarlyRow(c.parentAmplicon()->seq, c.parentAmplicon()->len,
                                                                       acIndices[*childIter].seq, acIndices[*childIter].len,
                                                                       t, scoring, D, P, cntDiffs, cntDiffsP) <= t) {
 
                         lock.lock();
                         if ((graftCands[*childIter].parentOtu == 0) ||
-                                compareCandidates(*c.parentMember->member, *graftCands[*childIter].parentMember->member)) {
+                                compareCandidates(*c.parentAmplicon(), *graftCands[*childIter].parentAmplicon())) {
 
                             graftCands[*childIter].parentOtu = c.parentOtu;
                             graftCands[*childIter].parentMember = c.parentMember;
@@ -285,7 +443,7 @@ void SwarmClustering::fastidiousCheckOtus(RotatingBuffers<CandidateFastidious>&
 
             for (numSeqs_t m = 0; m < (*otuIter)->numMembers; m++) { // ... consider every amplicon in the OTU and ...
 
-                auto ampl = (*otuIter)->members[m].member;
+                auto ampl = (*otuIter)->amplicon((*otuIter)->members[m].member);
                 seqLen = ampl->len;
 
                 std::unordered_map<lenSeqs_t, std::vector<Substrings>>& substrs = substrsArchive[seqLen];
@@ -400,7 +558,7 @@ void SwarmClustering::fastidiousCheckOtusDirectly(const AmpliconPools& pools, co
 
             for (numSeqs_t m = 0; m < (*otuIter)->numMembers; m++) { // ... consider every amplicon in the OTU and ...
 
-                auto ampl = (*otuIter)->members[m].member;
+                auto ampl = (*otuIter)->amplicon((*otuIter)->members[m].member);
                 seqLen = ampl->len;
 
                 std::unordered_map<lenSeqs_t, std::vector<Substrings>>& substrs = substrsArchive[seqLen];
@@ -472,11 +630,11 @@ void SwarmClustering::fastidiousCheckOtusDirectly(const AmpliconPools& pools, co
                             std::unique_lock<std::mutex> lock(graftCandsMtx);
 #if QGRAM_FILTER
                             if ((cnt >= sc.extraSegs) && ((graftCands[prevCand].parentOtu == 0) ||
-                                    compareCandidates(*ampl, *graftCands[prevCand].parentMember->member)) &&
+                                    compareCandidates(*ampl, *graftCands[prevCand].parentAmplicon())) &&
                                     (qgram_diff(*ampl, acIndices[prevCand]) <= sc.fastidiousThreshold)) {
 #else
                             if ((cnt >= sc.extraSegs) && ((graftCands[prevCand].parentOtu == 0) ||
-                                    compareCandidates(*ampl, *graftCands[prevCand].parentMember->member))) {
+                                    compareCandidates(*ampl, *graftCands[prevCand].parentAmplicon()))) {
 #endif
 
                                 lock.unlock();
@@ -489,7 +647,7 @@ void SwarmClustering::fastidiousCheckOtusDirectly(const AmpliconPools& pools, co
                                                                           sc.fastidiousThreshold, M)) <= sc.fastidiousThreshold) {
 
                                     lock.lock();
-                                    if (((graftCands[prevCand].parentOtu == 0) || compareCandidates(*ampl, *graftCands[prevCand].parentMember->member))) {
+                                    if (((graftCands[prevCand].parentOtu == 0) || compareCandidates(*ampl, *graftCands[prevCand].parentAmplicon()))) {
 
                                         graftCands[prevCand].parentOtu = *otuIter;
                                         graftCands[prevCand].parentMember = (*otuIter)->members + m;
@@ -513,11 +671,11 @@ void SwarmClustering::fastidiousCheckOtusDirectly(const AmpliconPools& pools, co
                     std::unique_lock<std::mutex> lock(graftCandsMtx);
 #if QGRAM_FILTER
                     if ((cnt >= sc.extraSegs) && ((graftCands[prevCand].parentOtu == 0) ||
-                            compareCandidates(*ampl, *graftCands[prevCand].parentMember->member)) &&
+                            compareCandidates(*ampl, *graftCands[prevCand].parentAmplicon())) &&
                             (qgram_diff(*ampl, acIndices[prevCand]) <= sc.fastidiousThreshold)) {
 #else
                     if ((cnt >= sc.extraSegs) && ((graftCands[prevCand].parentOtu == 0) ||
-                            compareCandidates(*ampl, *graftCands[prevCand].parentMember->member))) {
+                            compareCandidates(*ampl, *graftCands[prevCand].parentAmplicon()))) {
 #endif
 
                         lock.unlock();
@@ -530,7 +688,7 @@ void SwarmClustering::fastidiousCheckOtusDirectly(const AmpliconPools& pools, co
                                                                    sc.fastidiousThreshold, M)) <= sc.fastidiousThreshold) {
 
                             lock.lock();
-                            if (((graftCands[prevCand].parentOtu == 0) || compareCandidates(*ampl, *graftCands[prevCand].parentMember->member))) {
+                            if (((graftCands[prevCand].parentOtu == 0) || compareCandidates(*ampl, *graftCands[prevCand].parentAmplicon()))) {
 
                                 graftCands[prevCand].parentOtu = *otuIter;
                                 graftCands[prevCand].parentMember = (*otuIter)->members + m;
@@ -677,7 +835,7 @@ void SwarmClustering::determineGrafts(const AmpliconPools& pools, const std::vec
     std::mutex graftCandsMtx;
     lenSeqs_t halfRange = sc.fastidiousThreshold / (sc.threshold + 1);
     lenSeqs_t minP = (p > halfRange) ? (p - halfRange) : 0;
-    lenSeqs_t maxP = std::min(p + halfRange, pools.numPools() - 1);
+    lenSeqs_t maxP = std::min(lenSeqs_t(p + halfRange), lenSeqs_t(pools.numPools() - 1));
 #if FASTIDIOUS_PARALLEL_CHECK
 
     switch (sc.fastidiousCheckingMode) {
@@ -818,401 +976,2366 @@ void SwarmClustering::determineGrafts(const AmpliconPools& pools, const std::vec
 
 }
 
-void SwarmClustering::graftOtus(numSeqs_t& maxSize, numSeqs_t& numOtus, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc) {
+AmpliconCollection* SwarmClustering::collectLightAmplicons(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                                           std::vector<GraftCandidate>& graftCands, const SwarmConfig& sc) {
 
-    std::vector<GraftCandidate> allGraftCands;
-    std::mutex allGraftCandsMtx;
+    std::vector<std::pair<Otu*, const Amplicon*>> lightAmpls;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        for (auto otuIter = otus[p].begin(); otuIter != otus[p].end(); otuIter++) {
 
-    std::cout << "Determining grafting candidates..." << std::endl;
+            if ((*otuIter)->mass < sc.boundary) {
+                for (numSeqs_t m = 0; m < (*otuIter)->numMembers; m++) {
+                    lightAmpls.emplace_back(*otuIter, (*otuIter)->amplicon((*otuIter)->members[m].member));
+                }
+            }
 
-#if FASTIDIOUS_PARALLEL_POOL
+        }
+    }
 
-    std::thread grafters[sc.numGrafters];
-    unsigned long r = 0;
-    for (; r + sc.numGrafters <= pools.numPools(); r += sc.numGrafters) {
+    std::stable_sort(lightAmpls.begin(), lightAmpls.end(),
+                     [](const std::pair<Otu*, const Amplicon*>& lhs, const std::pair<Otu*, const Amplicon*>& rhs) {
+                         return lhs.second->len < rhs.second->len;
+                     });
 
-        for (unsigned long g = 0; g < sc.numGrafters; g++) {
-            grafters[g] = std::thread(&SwarmClustering::determineGrafts, std::ref(pools), std::ref(otus), std::ref(allGraftCands),
-                                      r + g, std::ref(allGraftCandsMtx), std::ref(sc));
-        }
-        for (unsigned long g = 0; g < sc.numGrafters; g++) {
-            grafters[g].join();
+    std::vector<std::pair<lenSeqs_t, numSeqs_t>> counts;
+    for (auto& la : lightAmpls) {
+
+        if (counts.empty() || counts.back().first != la.second->len) {
+            counts.emplace_back(la.second->len, 0);
         }
+        counts.back().second++;
 
     }
 
-    for (unsigned long g = 0; g < pools.numPools() % sc.numGrafters; g++) {
-        grafters[g] = std::thread(&SwarmClustering::determineGrafts, std::ref(pools), std::ref(otus), std::ref(allGraftCands),
-                                  r + g, std::ref(allGraftCandsMtx), std::ref(sc));
-    }
-    for (unsigned long g = 0; g < pools.numPools() % sc.numGrafters; g++) {
-        grafters[g].join();
-    }
+    AmpliconCollection* acLight = new AmpliconCollection(lightAmpls.size(), counts);
+    graftCands = std::vector<GraftCandidate>(lightAmpls.size());
+    for (numSeqs_t i = 0; i < lightAmpls.size(); i++) {
 
-#else
+        acLight->push_back(*(lightAmpls[i].second));
+        graftCands[i].childOtu = lightAmpls[i].first;
+        graftCands[i].childMember = lightAmpls[i].second; // refers to the amplicon in its pool (not to the copy)
 
-    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
-        determineGrafts(pools, otus, allGraftCands, p, allGraftCandsMtx, sc);
     }
 
-#endif
-
-    // Sort all graft candidates and perform actual grafting
-    std::cout << "Got " << allGraftCands.size() << " graft candidates." << std::endl;
-    std::cout << "Processing grafting candidates..." << std::endl;
-    std::sort(allGraftCands.begin(), allGraftCands.end(), CompareGraftCandidatesAbund());
-    Otu* parentOtu = 0;
-    Otu* childOtu = 0;
-    numSeqs_t numGrafts = 0;
-    for (auto graftIter = allGraftCands.begin(); graftIter != allGraftCands.end(); graftIter++) {
-
-        if (!(graftIter->childOtu->attached())) {
+    return acLight;
 
-            parentOtu = graftIter->parentOtu;
-            childOtu = graftIter->childOtu;
+}
 
-            // "attach the seed of the light swarm to the tail of the heavy swarm"
-            // OTU entries are moved unchanged (entry of seed of attached swarm stays 'incomplete', grafting 'link' is not recorded)
-            parentOtu->attach(childOtu, graftIter->parentMember, graftIter->childMember);
+#if !SUCCINCT_FASTIDIOUS
+void SwarmClustering::determineGraftsGlobally(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                              std::vector<GraftCandidate>& allGraftCands, const SwarmConfig& sc) {
 
-            // update stats
-            maxSize = std::max(maxSize, parentOtu->numTotalMembers());
+    // a) Collect the amplicons of all light OTUs (over all pools) in one length-sorted collection
+    std::vector<GraftCandidate> graftCands;
+    AmpliconCollection* lightAc = collectLightAmplicons(pools, otus, graftCands, sc);
+    AmpliconCollection& acLight = *lightAc;
 
-            numGrafts++;
-            numOtus--;
+    lenSeqs_t maxLen = 0;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
 
+        AmpliconCollection* ac = pools.get(p);
+        for (auto iter = ac->begin(); iter != ac->end(); iter++) {
+            maxLen = std::max(maxLen, iter->len);
         }
 
     }
 
-    std::cout << "Made " << numGrafts << " grafts." << std::endl;
+    std::vector<std::pair<lenSeqs_t, numSeqs_t>> counts;
+    std::vector<numSeqs_t> groupStarts; // label of the first amplicon of each length
+    for (numSeqs_t i = 0; i < acLight.size(); i++) {
 
-}
+        if (counts.empty() || counts.back().first != acLight[i].len) {
 
+            counts.emplace_back(acLight[i].len, 0);
+            groupStarts.push_back(i);
 
-void SwarmClustering::processOtus(const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc) {
+        }
+        counts.back().second++;
 
-    // make OTU IDs unique over all pools (so far IDs start at 1 in each pool) (currently commented out)
-    // add pool IDs and determine some overall statistics
-    numSeqs_t numOtus = 0;
-    numSeqs_t numOtusAdjusted = 0;
-    numSeqs_t numAmplicons = 0;
-    numSeqs_t maxSize = 0;
-    numSeqs_t maxGen = 0;
+    }
 
-    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+    // b) Index the light amplicons, one length (= one row of the index) per task
+    IndicesFastidious indices(2 * sc.fastidiousThreshold + 1, sc.fastidiousThreshold + sc.extraSegs, true, false);
+    for (auto& c : counts) {
+        indices.roll(c.first); // create all rows beforehand, so that the indexing threads only modify disjoint rows
+    }
 
-        for (auto otuIter = otus[p].begin(); otuIter != otus[p].end(); otuIter++) {
+    std::atomic<numSeqs_t> nextLength(0);
+    auto indexLengths = [&]() {
 
-            maxSize = std::max(maxSize, (*otuIter)->numMembers); // sufficient prior to fastidious grafting
-            maxGen = std::max(maxGen, (*otuIter)->maxGen());
+        Segments segments(sc.fastidiousThreshold + sc.extraSegs);
+        for (numSeqs_t g = nextLength++; g < counts.size(); g = nextLength++) {
+
+            selectSegments(segments, counts[g].first, sc.fastidiousThreshold, sc.extraSegs);
+            auto& row = indices.getIndicesRow(counts[g].first);
+
+            for (numSeqs_t label = groupStarts[g]; label < groupStarts[g] + counts[g].second; label++) {
+                for (lenSeqs_t i = 0; i < sc.fastidiousThreshold + sc.extraSegs; i++) {
+                    row[i].add(StringIteratorPair(acLight[label].seq + segments[i].first,
+                                                  acLight[label].seq + segments[i].first + segments[i].second), label);
+                }
+            }
 
         }
 
-        numOtus += otus[p].size();
-        numAmplicons += pools.get(p)->size();
+    };
 
+    std::thread workers[sc.numGrafters];
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+        workers[g] = std::thread(indexLengths);
+    }
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+        workers[g].join();
     }
 
-    numOtusAdjusted = numOtus;
+    // c) Search with the amplicons of the heavy OTUs of every pool (each heavy amplicon is filtered exactly once)
+    std::mutex graftCandsMtx;
+    std::atomic<numSeqs_t> nextPool(0);
+    auto checkPools = [&]() {
+        for (numSeqs_t q = nextPool++; q < pools.numPools(); q = nextPool++) {
+            checkAndVerify(pools, otus[q], *(pools.get(q)), indices, acLight, graftCands, maxLen + 1, graftCandsMtx, sc);
+        }
+    };
 
-    /* (b) Optional (second) clustering phase of Swarm */
-    if (sc.fastidious) {
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+        workers[g] = std::thread(checkPools);
+    }
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+        workers[g].join();
+    }
 
-        std::cout << "Results before fastidious processing: " << std::endl;
-        std::cout << "Number of swarms: " << numOtus << std::endl;
-        std::cout << "Largest swarms: " << maxSize << std::endl << std::endl;
+    // d) Collect the (actual = non-empty) graft candidates
+    auto newEnd = std::remove_if(
+            graftCands.begin(),
+            graftCands.end(),
+            [](GraftCandidate& gc) {
+                return gc.parentOtu == 0;
+            });
 
-        numSeqs_t numLightOtus = 0;
-        numSeqs_t numAmplLightOtus = 0;
+    allGraftCands.reserve(allGraftCands.size() + std::distance(graftCands.begin(), newEnd));
+    std::move(graftCands.begin(), newEnd, std::back_inserter(allGraftCands));
 
-        std::cout << "Counting amplicons in heavy and light swarms..." << std::endl;
-        for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+    delete lightAc;
 
-            for (auto otuIter = otus[p].begin(); otuIter != otus[p].end(); otuIter++) {
+}
+#endif
 
-                numLightOtus += ((*otuIter)->mass < sc.boundary);
-                numAmplLightOtus += ((*otuIter)->mass < sc.boundary) * (*otuIter)->numMembers; // sufficient prior to fastidious grafting
+void SwarmClustering::determineGraftsMicrovariants(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                                   std::vector<GraftCandidate>& allGraftCands, const SwarmConfig& sc) {
 
-            }
+    std::vector<GraftCandidate> graftCands;
+    AmpliconCollection* acLight = collectLightAmplicons(pools, otus, graftCands, sc);
 
-        }
-        std::cout << "Heavy swarms: " << (numOtus - numLightOtus) << ", with " << (numAmplicons - numAmplLightOtus) << " amplicons" << std::endl;
-        std::cout << "Light swarms: " << numLightOtus << ", with " << numAmplLightOtus << " amplicons" << std::endl << std::endl;
+    lenSeqs_t maxLen = 0;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
 
-        if ((numLightOtus == 0) || (numLightOtus == numOtus)) {
-            std::cout << "Only light or only heavy OTUs. No further action." << std::endl;
-        } else {
-            graftOtus(maxSize, numOtusAdjusted, pools, otus, sc);
+        AmpliconCollection* ac = pools.get(p);
+        for (auto iter = ac->begin(); iter != ac->end(); iter++) {
+            maxLen = std::max(maxLen, iter->len);
         }
-        std::cout << std::endl;
-
-    }
-
-    /* (c) Generating results */
-    std::vector<Otu*> flattened(numOtus);
-    auto iter = flattened.begin();
-    for (auto p = 0; p < pools.numPools(); p++) {
-
-        iter = std::move(otus[p].begin(), otus[p].end(), iter);
-        otus[p] = std::vector<Otu*>();
 
     }
 
-    std::cout << "Sorting OTUs by seed abundance..." << std::endl;
-    std::sort(flattened.begin(), flattened.end(), CompareOtusSeedAbund());
-
-    if (sc.outInternals) outputInternalStructures(sc.oFileInternals, pools, flattened, sc);
-    if (sc.outOtus) {
-        (sc.outMothur) ?
-          outputOtusMothur(sc.oFileOtus, pools, flattened, sc.threshold, numOtusAdjusted, sc.sepMothur, sc.sepMothurOtu, sc.sepAbundance)
-        : outputOtus(sc.oFileOtus, pools, flattened, sc.sepOtus, sc.sepAbundance);
-    }
-    if (sc.outStatistics) outputStatistics(sc.oFileStatistics, pools, flattened, sc.sepStatistics);
-    if (sc.outSeeds) outputSeeds(sc.oFileSeeds, pools, flattened, sc.sepAbundance);
-    if (sc.outUclust) outputUclust(sc.oFileUclust, pools, flattened, sc);
+    std::vector<char> alphabet = Microvariants::determineAlphabet(pools);
+    std::thread workers[sc.numGrafters];
 
-    std::cout << std::endl;
-    std::cout << "Number of swarms: " << numOtusAdjusted << std::endl;
-    std::cout << "Largest swarm: " << maxSize << std::endl;
-    std::cout << "Max generations: " << maxGen << std::endl << std::endl;
+    // a) Hash the sequences of the light amplicons and (for threshold 2) put all their microvariants into a Bloom filter
+    Microvariants::SequenceTable table(*acLight);
+    Microvariants::BloomFilter* variantFilter = 0;
 
+    if (sc.fastidiousThreshold == 2) {
 
-    /* (d) Cleaning up */
-    for (auto otuIter = flattened.begin(); otuIter != flattened.end(); otuIter++) {
-        delete *otuIter;
-    }
+        unsigned long long numVariants = 0;
+        for (auto iter = acLight->begin(); iter != acLight->end(); iter++) {
+            numVariants += (2 * iter->len + 1) * alphabet.size();
+        }
+        variantFilter = new Microvariants::BloomFilter(numVariants, 16);
 
-}
+        std::atomic<numSeqs_t> nextLabel(0);
+        const numSeqs_t chunkSize = 1024;
+        auto insertVariants = [&]() {
 
+            Microvariants::MicrovariantGenerator gen(alphabet, maxLen);
+            for (numSeqs_t first = nextLabel.fetch_add(chunkSize); first < acLight->size(); first = nextLabel.fetch_add(chunkSize)) {
+                for (numSeqs_t i = first; i < std::min(first + chunkSize, acLight->size()); i++) {
 
-void SwarmClustering::cluster(const AmpliconPools& pools, const SwarmConfig& sc) {
+                    gen.setSequence((*acLight)[i].seq, (*acLight)[i].len);
+                    gen.forEach([&](const Microvariants::Microvariant& mv) {
+                        variantFilter->insert(mv.hash);
+                    });
 
-    /* (a) Mandatory (first) clustering phase of Swarm */
-    // determine OTUs by exploring all pools
-    std::vector<std::vector<Otu*>> otus(pools.numPools());
-    std::thread explorers[sc.numExplorers];
-    auto fun = (sc.numThreadsPerExplorer == 1) ? &SegmentFilter::swarmFilterDirectly : &SegmentFilter::swarmFilter;
-    unsigned long r = 0;
+                }
+            }
 
-    std::cout << "Clustering..." << std::endl;
-    for (; r + sc.numExplorers <= pools.numPools(); r += sc.numExplorers) {
+        };
 
-        for (unsigned long e = 0; e < sc.numExplorers; e++) {
-            explorers[e] = std::thread(fun, std::ref(*(pools.get(r + e))), std::ref(otus[r + e]), std::ref(sc));
+        for (unsigned long g = 0; g < sc.numGrafters; g++) {
+            workers[g] = std::thread(insertVariants);
         }
-        for (unsigned long e = 0; e < sc.numExplorers; e++) {
-            explorers[e].join();
+        for (unsigned long g = 0; g < sc.numGrafters; g++) {
+            workers[g].join();
         }
 
     }
 
-    for (unsigned long e = 0; e < pools.numPools() % sc.numExplorers; e++) {
-        explorers[e] = std::thread(fun, std::ref(*(pools.get(r + e))), std::ref(otus[r + e]), std::ref(sc));
-    }
-    for (unsigned long e = 0; e < pools.numPools() % sc.numExplorers; e++) {
-        explorers[e].join();
-    }
-    std::cout << std::endl;
+    // b) Enumerate the microvariants of the amplicons of the heavy OTUs and look them up among the light amplicons
+    // (for threshold 2, microvariants found in the Bloom filter are expanded once more)
+    std::mutex graftCandsMtx;
+    std::atomic<numSeqs_t> nextPool(0);
+    auto checkPools = [&]() {
 
-    processOtus(pools, otus, sc);
+        Microvariants::MicrovariantGenerator gen(alphabet, maxLen);
+        Microvariants::MicrovariantGenerator succGen(alphabet, maxLen + 1);
+        std::vector<char> buf(maxLen + 1);
+        std::vector<char> succBuf(maxLen + 2);
+        std::vector<numSeqs_t> labels;
 
-}
+        for (numSeqs_t q = nextPool++; q < pools.numPools(); q = nextPool++) {
+            for (auto otuIter = otus[q].begin(); otuIter != otus[q].end(); otuIter++) {
 
+                if ((*otuIter)->mass < sc.boundary) continue;
 
-void SwarmClustering::dereplicate(const AmpliconPools& pools, const SwarmConfig& sc) {
+                for (numSeqs_t m = 0; m < (*otuIter)->numMembers; m++) {
 
-    struct lessCharArray {
-        bool operator()(const char* lhs, const char* rhs) const {
-            return strcmp(lhs, rhs) < 0;
-        }
-    };
+                    auto ampl = (*otuIter)->amplicon((*otuIter)->members[m].member);
+                    labels.clear();
 
-    std::vector<Otu*> otus;
+                    gen.setSequence(ampl->seq, ampl->len);
+                    if (table.mayContain(gen.hash())) { // identical sequences (input not necessarily dereplicated)
+                        table.find(gen.hash(), ampl->seq, ampl->len, labels);
+                    }
+                    gen.forEach([&](const Microvariants::Microvariant& mv) {
 
-    std::cout << "Dereplicating..." << std::endl;
-    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+                        bool light = table.mayContain(mv.hash);
+                        bool nearLight = (variantFilter != 0) && variantFilter->contains(mv.hash);
+                        if (!light && !nearLight) return;
 
-        AmpliconCollection* ac = pools.get(p);
-        std::map<const char*, std::vector<Amplicon*>, lessCharArray> groups;
+                        lenSeqs_t len = gen.materialise(mv, buf.data());
+                        if (light) {
+                            table.find(mv.hash, buf.data(), len, labels);
+                        }
 
-        for (auto iter = ac->begin(); iter != ac->end(); iter++) {
-            groups[iter->seq].push_back(iter);
-        }
+                        if (nearLight) {
 
-        for (auto& g : groups) {
+                            succGen.setSequence(buf.data(), len);
+                            succGen.forEach([&](const Microvariants::Microvariant& succMv) {
 
-            Otu* otu = new Otu();
+                                if (table.mayContain(succMv.hash)) {
 
-            otu->numMembers = g.second.size();
-            otu->numUniqueSequences = otu->numMembers;
-            otu->members = new OtuEntry[otu->numMembers];
+                                    lenSeqs_t succLen = succGen.materialise(succMv, succBuf.data());
+                                    table.find(succMv.hash, succBuf.data(), succLen, labels);
 
-            for (auto i = 0; i < otu->numMembers; i++) {
+                                }
 
-                otu->members[i] = OtuEntry(g.second[i], g.second[0], 0, 0);
-                otu->mass += g.second[i]->abundance;
+                            });
 
-            }
+                        }
 
-            otus.push_back(otu);
+                    });
 
-        }
+                    if (!labels.empty()) {
 
-    }
-    std::cout << std::endl;
+                        std::lock_guard<std::mutex> lock(graftCandsMtx);
+                        for (auto label : labels) {
 
-    std::cout << "Sorting OTUs by mass..." << std::endl;
-    std::sort(otus.begin(), otus.end(), CompareOtusMass());
-    outputDereplicate(pools, otus, sc);
+                            if ((graftCands[label].parentOtu == 0) || compareCandidates(*ampl, *graftCands[label].parentAmplicon())) {
 
-    numSeqs_t maxSize = 0;
-    for (auto& o : otus) {
-        maxSize = std::max(maxSize, o->numMembers);
-    }
+                                graftCands[label].parentOtu = *otuIter;
+                                graftCands[label].parentMember = (*otuIter)->members + m;
 
-    std::cout << "Number of swarms: " << otus.size() << std::endl;
+                            }
+
+                        }
+
+                    }
+
+                }
+
+            }
+        }
+
+    };
+
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+        workers[g] = std::thread(checkPools);
+    }
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+        workers[g].join();
+    }
+
+    // c) Collect the (actual = non-empty) graft candidates
+    auto newEnd = std::remove_if(
+            graftCands.begin(),
+            graftCands.end(),
+            [](GraftCandidate& gc) {
+                return gc.parentOtu == 0;
+            });
+
+    allGraftCands.reserve(allGraftCands.size() + std::distance(graftCands.begin(), newEnd));
+    std::move(graftCands.begin(), newEnd, std::back_inserter(allGraftCands));
+
+    delete variantFilter;
+    delete acLight;
+
+}
+
+void SwarmClustering::sortGraftCandidates(std::vector<GraftCandidate>& graftCands, const unsigned long numThreads) {
+
+    std::vector<GraftKey> keys(graftCands.size());
+    for (numSeqs_t i = 0; i < graftCands.size(); i++) {
+
+        keys[i].parentRank = graftCands[i].parentAmplicon()->rank;
+        keys[i].childRank = graftCands[i].childMember->rank;
+        keys[i].pos = i;
+
+    }
+
+    parallelSort(keys, numThreads);
+
+    std::vector<GraftCandidate> sortedCands;
+    sortedCands.reserve(graftCands.size());
+    for (auto& k : keys) {
+        sortedCands.push_back(graftCands[k.pos]);
+    }
+    graftCands.swap(sortedCands);
+
+}
+
+void SwarmClustering::determineAllGrafts(const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                         std::vector<GraftCandidate>& allGraftCands, const SwarmConfig& sc) {
+
+    std::mutex allGraftCandsMtx;
+
+    std::cout << "Determining grafting candidates..." << std::endl;
+
+    if (sc.fastidiousCheckingMode == 4) {
+
+        if (!sc.useScore && sc.fastidiousThreshold > 0 && sc.fastidiousThreshold <= 2) {
+
+            determineGraftsMicrovariants(pools, otus, allGraftCands, sc);
+            std::cout << "Got " << allGraftCands.size() << " graft candidates." << std::endl;
+            sortGraftCandidates(allGraftCands, sc.numGrafters);
+
+            return;
+
+        }
+
+        std::cerr << "WARNING: Microvariant-based fastidious checking requires a fastidious threshold of 1 or 2 and no scoring function. "
+                  << "Using the segment filter instead." << std::endl;
+
+    }
+
+#if !SUCCINCT_FASTIDIOUS
+    if (sc.fastidiousCheckingMode == 3) {
+
+        determineGraftsGlobally(pools, otus, allGraftCands, sc);
+        std::cout << "Got " << allGraftCands.size() << " graft candidates." << std::endl;
+        sortGraftCandidates(allGraftCands, sc.numGrafters);
+
+        return;
+
+    }
+#endif
+
+#if FASTIDIOUS_PARALLEL_POOL
+
+    std::thread grafters[sc.numGrafters];
+    unsigned long r = 0;
+    for (; r + sc.numGrafters <= pools.numPools(); r += sc.numGrafters) {
+
+        for (unsigned long g = 0; g < sc.numGrafters; g++) {
+            grafters[g] = std::thread(&SwarmClustering::determineGrafts, std::ref(pools), std::ref(otus), std::ref(allGraftCands),
+                                      r + g, std::ref(allGraftCandsMtx), std::ref(sc));
+        }
+        for (unsigned long g = 0; g < sc.numGrafters; g++) {
+            grafters[g].join();
+        }
+
+    }
+
+    for (unsigned long g = 0; g < pools.numPools() % sc.numGrafters; g++) {
+        grafters[g] = std::thread(&SwarmClustering::determineGrafts, std::ref(pools), std::ref(otus), std::ref(allGraftCands),
+                                  r + g, std::ref(allGraftCandsMtx), std::ref(sc));
+    }
+    for (unsigned long g = 0; g < pools.numPools() % sc.numGrafters; g++) {
+        grafters[g].join();
+    }
+
+#else
+
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        determineGrafts(pools, otus, allGraftCands, p, allGraftCandsMtx, sc);
+    }
+
+#endif
+
+    std::cout << "Got " << allGraftCands.size() << " graft candidates." << std::endl;
+    sortGraftCandidates(allGraftCands, sc.numGrafters);
+
+}
+
+void SwarmClustering::graftOtus(numSeqs_t& maxSize, numSeqs_t& numOtus, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                const SwarmConfig& sc, const std::vector<GraftCandidate>* graftCands) {
+
+    std::vector<GraftCandidate> allGraftCands;
+    if (graftCands == 0) {
+
+        determineAllGrafts(pools, otus, allGraftCands, sc);
+        graftCands = &allGraftCands;
+
+    }
+
+    // Perform actual grafting (candidates are sorted)
+    // Processing the candidates sequentially in this order, a light OTU is grafted by its first candidate
+    // and the OTUs grafted upon a heavy OTU are chained in the order of their candidates.
+    // The same result is obtained in parallel:
+    // (1) every light OTU is claimed by its first candidate (candidates sorted by child OTU and position),
+    // (2) the successful candidates are applied in their order, with each heavy OTU handled by one thread.
+    std::cout << "Processing grafting candidates..." << std::endl;
+    const numSeqs_t numCands = graftCands->size();
+
+    std::vector<std::pair<Otu*, numSeqs_t>> claims(numCands);
+    for (numSeqs_t i = 0; i < numCands; i++) {
+        claims[i] = std::make_pair((*graftCands)[i].childOtu, i);
+    }
+    parallelSort(claims, sc.numGrafters);
+
+    std::vector<char> successful(numCands, 0);
+    numSeqs_t numGrafts = 0;
+    for (numSeqs_t j = 0; j < numCands; j++) {
+
+        if ((j == 0 || claims[j].first != claims[j - 1].first) && !(claims[j].first->attached())) {
+
+            successful[claims[j].second] = 1;
+            numGrafts++;
+
+        }
+
+    }
+    std::vector<std::pair<Otu*, numSeqs_t>>().swap(claims);
+
+    std::thread grafters[sc.numGrafters];
+    std::vector<numSeqs_t> maxSizes(sc.numGrafters, 0);
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+
+        grafters[g] = std::thread([&, g]() {
+
+            for (numSeqs_t i = 0; i < numCands; i++) {
+
+                auto& gc = (*graftCands)[i];
+                if (successful[i] && (reinterpret_cast<std::uintptr_t>(gc.parentOtu) / sizeof(Otu)) % sc.numGrafters == g) {
+
+                    // "attach the seed of the light swarm to the tail of the heavy swarm"
+                    // OTU entries are moved unchanged (entry of seed of attached swarm stays 'incomplete', grafting 'link' is not recorded)
+                    gc.parentOtu->attach(gc.childOtu, gc.parentMember, gc.childMember);
+                    maxSizes[g] = std::max(maxSizes[g], gc.parentOtu->numTotalMembers());
+
+                }
+
+            }
+
+        });
+
+    }
+    for (unsigned long g = 0; g < sc.numGrafters; g++) {
+
+        grafters[g].join();
+        maxSize = std::max(maxSize, maxSizes[g]);
+
+    }
+
+    numOtus -= numGrafts;
+
+    std::cout << "Made " << numGrafts << " grafts." << std::endl;
+
+}
+
+
+void SwarmClustering::processOtus(const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, const SwarmConfig& sc,
+                                  const std::vector<GraftCandidate>* graftCands) {
+
+    // make OTU IDs unique over all pools (so far IDs start at 1 in each pool) (currently commented out)
+    // add pool IDs and determine some overall statistics
+    numSeqs_t numOtus = 0;
+    numSeqs_t numOtusAdjusted = 0;
+    numSeqs_t numAmplicons = 0;
+    numSeqs_t maxSize = 0;
+    lenSeqs_t maxGen = 0;
+
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+
+        for (auto otuIter = otus[p].begin(); otuIter != otus[p].end(); otuIter++) {
+
+            maxSize = std::max(maxSize, (*otuIter)->numMembers); // sufficient prior to fastidious grafting
+            maxGen = std::max(maxGen, (*otuIter)->maxGen());
+
+        }
+
+        numOtus += otus[p].size();
+        numAmplicons += pools.get(p)->size();
+
+    }
+
+    numOtusAdjusted = numOtus;
+
+    /* (b) Optional (second) clustering phase of Swarm */
+    if (sc.fastidious) {
+
+        std::cout << "Results before fastidious processing: " << std::endl;
+        std::cout << "Number of swarms: " << numOtus << std::endl;
+        std::cout << "Largest swarms: " << maxSize << std::endl << std::endl;
+
+        numSeqs_t numLightOtus = 0;
+        numSeqs_t numAmplLightOtus = 0;
+
+        std::cout << "Counting amplicons in heavy and light swarms..." << std::endl;
+        for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+
+            for (auto otuIter = otus[p].begin(); otuIter != otus[p].end(); otuIter++) {
+
+                numLightOtus += ((*otuIter)->mass < sc.boundary);
+                numAmplLightOtus += ((*otuIter)->mass < sc.boundary) * (*otuIter)->numMembers; // sufficient prior to fastidious grafting
+
+            }
+
+        }
+        std::cout << "Heavy swarms: " << (numOtus - numLightOtus) << ", with " << (numAmplicons - numAmplLightOtus) << " amplicons" << std::endl;
+        std::cout << "Light swarms: " << numLightOtus << ", with " << numAmplLightOtus << " amplicons" << std::endl << std::endl;
+
+        if ((numLightOtus == 0) || (numLightOtus == numOtus)) {
+            std::cout << "Only light or only heavy OTUs. No further action." << std::endl;
+        } else {
+            graftOtus(maxSize, numOtusAdjusted, pools, otus, sc, graftCands);
+        }
+        std::cout << std::endl;
+
+    }
+
+    /* (c) Generating results */
+    std::vector<Otu*> flattened(numOtus);
+    auto iter = flattened.begin();
+    for (auto p = 0; p < pools.numPools(); p++) {
+
+        iter = std::move(otus[p].begin(), otus[p].end(), iter);
+        otus[p] = std::vector<Otu*>();
+
+    }
+
+    std::cout << "Sorting OTUs by seed abundance..." << std::endl;
+    std::sort(flattened.begin(), flattened.end(), CompareOtusSeedAbund());
+
+    lenSeqs_t maxLen = 0;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        maxLen = std::max(maxLen, pools.get(p)->maxLen());
+    }
+    outputResults(flattened, numOtusAdjusted, maxLen, sc);
+
+    std::cout << std::endl;
+    std::cout << "Number of swarms: " << numOtusAdjusted << std::endl;
+    std::cout << "Largest swarm: " << maxSize << std::endl;
+    std::cout << "Max generations: " << maxGen << std::endl << std::endl;
+
+    // OTUs are released together with the arenas of the pools
+
+}
+
+
+// binary I/O of single values (native byte order)
+template<typename T>
+inline void writeValue(std::ofstream& oStream, const T& val) {
+    oStream.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template<typename T>
+inline T readValue(std::ifstream& iStream) {
+
+    T val = T();
+    iStream.read(reinterpret_cast<char*>(&val), sizeof(T));
+
+    return val;
+
+}
+
+const char PHASE1_MAGIC[4] = {'G', 'F', 'P', '1'};
+
+// fingerprint of a pool (number of amplicons and total abundance)
+inline unsigned long long poolMass(const AmpliconCollection& ac) {
+
+    unsigned long long mass = 0;
+    for (auto iter = ac.begin(); iter != ac.end(); iter++) {
+        mass += iter->abundance;
+    }
+
+    return mass;
+
+}
+
+// header of a first-phase file (format, clustering parameters and number of pools)
+inline void writePhase1Header(std::ofstream& oStream, const numSeqs_t numPools, const SwarmClustering::SwarmConfig& sc,
+                              const char* magic = PHASE1_MAGIC) {
+
+    oStream.write(magic, 4);
+    writeValue(oStream, (unsigned char)sizeof(numSeqs_t));
+    writeValue(oStream, (unsigned char)sizeof(lenSeqs_t));
+    writeValue(oStream, sc.threshold);
+    writeValue(oStream, (unsigned char)sc.noOtuBreaking);
+    writeValue(oStream, numPools);
+
+}
+
+// (the number of pools is read into numPools)
+inline bool readPhase1Header(std::ifstream& iStream, numSeqs_t& numPools, const SwarmClustering::SwarmConfig& sc,
+                             const char* expectedMagic = PHASE1_MAGIC) {
+
+    char magic[4];
+    iStream.read(magic, 4);
+
+    bool fits = iStream.good() && std::equal(magic, magic + 4, expectedMagic)
+                && (readValue<unsigned char>(iStream) == sizeof(numSeqs_t))
+                && (readValue<unsigned char>(iStream) == sizeof(lenSeqs_t))
+                && (readValue<lenSeqs_t>(iStream) == sc.threshold)
+                && (readValue<unsigned char>(iStream) == (unsigned char)sc.noOtuBreaking);
+    numPools = readValue<numSeqs_t>(iStream);
+
+    return fits && iStream.good();
+
+}
+
+// section of one pool in a first-phase file (fingerprint of the pool and its OTUs)
+inline void writePhase1Pool(std::ofstream& oStream, const AmpliconCollection& ac, const std::vector<SwarmClustering::Otu*>& otus) {
+
+    writeValue(oStream, ac.size());
+    writeValue(oStream, poolMass(ac));
+    writeValue(oStream, (numSeqs_t)otus.size());
+
+    for (auto otu : otus) {
+
+        writeValue(oStream, otu->numMembers);
+        writeValue(oStream, otu->mass);
+        writeValue(oStream, otu->numUniqueSequences);
+        writeValue(oStream, otu->maxRad);
+
+        for (auto m = otu->members; m != otu->members + otu->numMembers; m++) {
+
+            writeValue(oStream, m->member);
+            writeValue(oStream, m->parent);
+            writeValue(oStream, m->parentDist);
+            writeValue(oStream, m->gen);
+
+        }
+
+    }
+
+}
+
+inline bool readPhase1Pool(std::ifstream& iStream, const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus,
+                           SwarmClustering::OtuArena& arena) {
+
+    bool fits = (readValue<numSeqs_t>(iStream) == ac.size()) && (readValue<unsigned long long>(iStream) == poolMass(ac));
+
+    numSeqs_t numOtus = readValue<numSeqs_t>(iStream);
+    for (numSeqs_t i = 0; fits && i < numOtus; i++) {
+
+        SwarmClustering::Otu* otu = arena.newOtu(ac.begin());
+
+        numSeqs_t numMembers = readValue<numSeqs_t>(iStream);
+        otu->mass = readValue<numSeqs_t>(iStream);
+        otu->numUniqueSequences = readValue<numSeqs_t>(iStream);
+        otu->maxRad = readValue<lenSeqs_t>(iStream);
+
+        SwarmClustering::OtuEntry entry;
+        for (numSeqs_t j = 0; j < numMembers; j++) {
+
+            entry.member = readValue<numSeqs_t>(iStream);
+            entry.parent = readValue<numSeqs_t>(iStream);
+            entry.parentDist = readValue<lenSeqs_t>(iStream);
+            entry.gen = readValue<lenSeqs_t>(iStream);
+            arena.addMember(entry);
+
+            fits = fits && (entry.member < ac.size()) && (entry.parent < ac.size());
+
+        }
+
+        fits = fits && iStream.good() && (numMembers > 0);
+        arena.closeMembers(*otu);
+        otus.push_back(otu);
+
+    }
+
+    return fits && iStream.good();
+
+}
+
+void SwarmClustering::outputPhase1(const std::string oFile, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                   const SwarmConfig& sc) {
+
+    std::ofstream oStream(oFile, std::ios::out | std::ios::binary);
+
+    writePhase1Header(oStream, pools.numPools(), sc);
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        writePhase1Pool(oStream, *(pools.get(p)), otus[p]);
+    }
+
+    oStream.close();
+
+}
+
+bool SwarmClustering::readPhase1(const std::string iFile, const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus,
+                                 std::vector<OtuArena>& arenas, const SwarmConfig& sc) {
+
+    std::ifstream iStream(iFile, std::ios::in | std::ios::binary);
+    if (!iStream.good()) {
+
+        std::cerr << "ERROR: Could not read first-phase OTUs from " << iFile << "." << std::endl;
+        return false;
+
+    }
+
+    numSeqs_t numPools = 0;
+    bool fits = readPhase1Header(iStream, numPools, sc) && (numPools == pools.numPools());
+    for (numSeqs_t p = 0; fits && p < pools.numPools(); p++) {
+        fits = readPhase1Pool(iStream, *(pools.get(p)), otus[p], arenas[p]);
+    }
+
+    iStream.close();
+
+    if (!fits) {
+        std::cerr << "ERROR: First-phase OTUs in " << iFile << " do not match the input data or the clustering parameters." << std::endl;
+    }
+
+    return fits;
+
+}
+
+
+const char STATE_MAGIC[4] = {'G', 'F', 'S', '1'};
+
+// fingerprint of the content of a (sorted) pool (FNV-1a hash over identifiers, sequences and abundances)
+inline uint64_t poolHash(const AmpliconCollection& ac) {
+
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const char* data, const size_t len) {
+
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+        }
+
+    };
+
+    for (auto iter = ac.begin(); iter != ac.end(); iter++) {
+
+        add(iter->id, strlen(iter->id) + 1);
+        add(iter->seq, iter->len + 1);
+        add(reinterpret_cast<const char*>(&iter->abundance), sizeof(numSeqs_t));
+
+    }
+
+    return hash;
+
+}
+
+// skip the section of one pool in a first-phase file
+inline bool skipPhase1Pool(std::ifstream& iStream) {
+
+    readValue<numSeqs_t>(iStream);
+    readValue<unsigned long long>(iStream);
+
+    numSeqs_t numOtus = readValue<numSeqs_t>(iStream);
+    for (numSeqs_t i = 0; iStream.good() && i < numOtus; i++) {
+
+        numSeqs_t numMembers = readValue<numSeqs_t>(iStream);
+        iStream.seekg(2 * sizeof(numSeqs_t) + sizeof(lenSeqs_t) + numMembers * (2 * sizeof(numSeqs_t) + 2 * sizeof(lenSeqs_t)),
+                      std::ios::cur);
+
+    }
+
+    return iStream.good();
+
+}
+
+// scoring function used for the first clustering phase (only relevant with useScore)
+inline void writeScoring(std::ofstream& oStream, const SwarmClustering::SwarmConfig& sc) {
+
+    writeValue(oStream, (unsigned char)sc.useScore);
+    writeValue(oStream, sc.useScore ? sc.scoring.penMismatch : 0);
+    writeValue(oStream, sc.useScore ? sc.scoring.penOpen : 0);
+    writeValue(oStream, sc.useScore ? sc.scoring.penExtend : 0);
+
+}
+
+inline bool readScoring(std::ifstream& iStream, const SwarmClustering::SwarmConfig& sc) {
+
+    bool fits = (readValue<unsigned char>(iStream) == (unsigned char)sc.useScore);
+    fits = (readValue<val_t>(iStream) == (sc.useScore ? sc.scoring.penMismatch : 0)) && fits;
+    fits = (readValue<val_t>(iStream) == (sc.useScore ? sc.scoring.penOpen : 0)) && fits;
+    fits = (readValue<val_t>(iStream) == (sc.useScore ? sc.scoring.penExtend : 0)) && fits;
+
+    return fits;
+
+}
+
+void SwarmClustering::outputState(const std::string prefix, const AmpliconPools& pools, const std::vector<std::vector<Otu*>>& otus,
+                                  const SwarmConfig& sc) {
+
+    // amplicons (as FASTA, so that later runs read them like any other input file)
+    std::ofstream aStream(prefix + ".fasta", std::ios::out);
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+
+        const AmpliconCollection& ac = *(pools.get(p));
+        for (auto iter = ac.begin(); iter != ac.end(); iter++) {
+            aStream << ">" << iter->id << sc.sepAbundance << iter->abundance << "\n" << iter->seq << "\n";
+        }
+
+    }
+    aStream.close();
+
+    // first-phase OTUs of each pool, preceded by the fingerprint of the pool
+    std::ofstream oStream(prefix + ".otus", std::ios::out | std::ios::binary);
+    writePhase1Header(oStream, pools.numPools(), sc, STATE_MAGIC);
+    writeScoring(oStream, sc);
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+
+        writeValue(oStream, poolHash(*(pools.get(p))));
+        writePhase1Pool(oStream, *(pools.get(p)), otus[p]);
+
+    }
+    oStream.close();
+
+    if (!aStream || !oStream) {
+        std::cerr << "ERROR: Could not write the state to " << prefix << ".fasta and " << prefix << ".otus." << std::endl;
+    }
+
+}
+
+bool SwarmClustering::readState(const std::string prefix, const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus,
+                                std::vector<OtuArena>& arenas, std::vector<bool>& reused, const SwarmConfig& sc) {
+
+    std::string iFile = prefix + ".otus";
+    std::ifstream iStream(iFile, std::ios::in | std::ios::binary);
+    if (!iStream.good()) {
+
+        std::cerr << "ERROR: Could not read the state from " << iFile << "." << std::endl;
+        return false;
+
+    }
+
+    numSeqs_t numOldPools = 0;
+    if (!readPhase1Header(iStream, numOldPools, sc, STATE_MAGIC) || !readScoring(iStream, sc)) {
+
+        std::cerr << "ERROR: The state in " << iFile << " does not match the clustering parameters." << std::endl;
+        return false;
+
+    }
+
+    // pools with exactly the same (sorted) amplicons as an old pool are explored in exactly the same way
+    std::unordered_map<uint64_t, numSeqs_t> current;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        current[poolHash(*(pools.get(p)))] = p;
+    }
+
+    bool fits = true;
+    for (numSeqs_t q = 0; fits && q < numOldPools; q++) {
+
+        auto match = current.find(readValue<uint64_t>(iStream));
+        if (match != current.end() && !reused[match->second]) {
+
+            fits = readPhase1Pool(iStream, *(pools.get(match->second)), otus[match->second], arenas[match->second]);
+            reused[match->second] = true;
+
+        } else {
+            fits = skipPhase1Pool(iStream);
+        }
+
+    }
+
+    iStream.close();
+
+    if (!fits) {
+        std::cerr << "ERROR: The state in " << iFile << " is damaged or does not match the input data." << std::endl;
+    }
+
+    return fits;
+
+}
+
+
+// exploration function for one pool according to the exploration mode (not considering mode 1)
+inline decltype(&SegmentFilter::swarmFilterDirectly) explorerFunction(const SwarmClustering::SwarmConfig& sc, const bool warn) {
+
+    bool microvariants = (sc.explorationMode == 3) && (sc.threshold == 1) && !sc.useScore;
+
+    if (sc.explorationMode == 3 && !microvariants && warn) {
+        std::cerr << "WARNING: Microvariant-based exploration requires a threshold of 1 and no scoring function. "
+                  << "Using the segment filter instead." << std::endl;
+    }
+
+    return microvariants ? &SegmentFilter::swarmMicrovariants
+           : (sc.explorationMode == 2) ? &SegmentFilter::swarmFilterSpeculative
+           : (sc.numThreadsPerExplorer == 1) ? &SegmentFilter::swarmFilterDirectly : &SegmentFilter::swarmFilter;
+
+}
+
+bool SwarmClustering::explorePools(const AmpliconPools& pools, std::vector<std::vector<Otu*>>& otus, std::vector<OtuArena>& arenas,
+                                   const SwarmConfig& sc) {
+
+    std::thread explorers[sc.numExplorers];
+    auto fun = explorerFunction(sc, !sc.inPhase1);
+    std::vector<bool> reused(pools.numPools(), false);
+
+    if (sc.inPhase1) { // reuse OTUs of an earlier run
+
+        std::cout << "Reading first-phase OTUs..." << std::endl;
+        if (!readPhase1(sc.iFilePhase1, pools, otus, arenas, sc)) return false;
+        reused.assign(pools.numPools(), true);
+
+    } else if (sc.inState) { // reuse OTUs of the pools not changed since an earlier run
+
+        std::cout << "Reading state..." << std::endl;
+        if (!readState(sc.iPrefixState, pools, otus, arenas, reused, sc)) return false;
+        std::cout << "Reusing the OTUs of " << std::count(reused.begin(), reused.end(), true) << " of " << pools.numPools()
+                  << " pools." << std::endl;
+
+    }
+
+    // pools still to be explored
+    std::vector<numSeqs_t> todo;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        if (!reused[p]) todo.push_back(p);
+    }
+    unsigned long r = 0;
+
+    if (!todo.empty()) std::cout << "Clustering..." << std::endl;
+
+    if (sc.explorationMode == 1) { // all explorer threads work on the components of one pool at a time
+
+        for (; r < todo.size(); r++) {
+            SegmentFilter::swarmFilterComponents(*(pools.get(todo[r])), otus[todo[r]], arenas[todo[r]], sc);
+        }
+
+    } else {
+
+        for (; r + sc.numExplorers <= todo.size(); r += sc.numExplorers) {
+
+            for (unsigned long e = 0; e < sc.numExplorers; e++) {
+                explorers[e] = std::thread(fun, std::ref(*(pools.get(todo[r + e]))), std::ref(otus[todo[r + e]]), std::ref(arenas[todo[r + e]]),
+                                           std::ref(sc));
+            }
+            for (unsigned long e = 0; e < sc.numExplorers; e++) {
+                explorers[e].join();
+            }
+
+        }
+
+        for (unsigned long e = 0; e < todo.size() % sc.numExplorers; e++) {
+            explorers[e] = std::thread(fun, std::ref(*(pools.get(todo[r + e]))), std::ref(otus[todo[r + e]]), std::ref(arenas[todo[r + e]]),
+                                       std::ref(sc));
+        }
+        for (unsigned long e = 0; e < todo.size() % sc.numExplorers; e++) {
+            explorers[e].join();
+        }
+
+    }
+    std::cout << std::endl;
+
+    if (sc.outPhase1) outputPhase1(sc.oFilePhase1, pools, otus, sc);
+    if (sc.outState) outputState(sc.oPrefixState, pools, otus, sc);
+
+    return true;
+
+}
+
+bool SwarmClustering::cluster(const AmpliconPools& pools, const SwarmConfig& sc) {
+
+    /* (a) Mandatory (first) clustering phase of Swarm */
+    // determine OTUs by exploring all pools
+    std::vector<std::vector<Otu*>> otus(pools.numPools());
+    std::vector<OtuArena> arenas(pools.numPools()); // storage of the OTUs of each pool
+
+    if (!explorePools(pools, otus, arenas, sc)) return false;
+
+    processOtus(pools, otus, sc);
+
+    return true;
+
+}
+
+// path of a file in the shard directory
+inline std::string shardFile(const std::string& dir, const std::string& name) {
+    return (!dir.empty() && dir.back() != '/') ? dir + "/" + name : dir + name;
+}
+
+inline std::string shardPoolFile(const std::string& dir, const numSeqs_t p) {
+    return shardFile(dir, "pool_" + std::to_string(p));
+}
+
+// check that the manifest of the shard directory describes the same pools and clustering parameters
+inline bool checkManifest(const AmpliconPools& pools, const SwarmClustering::SwarmConfig& sc) {
+
+    std::string manifest = shardFile(sc.shardDir, "manifest");
+    std::ifstream iStream(manifest, std::ios::in | std::ios::binary);
+    if (!iStream.good()) {
+
+        std::cerr << "ERROR: Could not read the shard manifest " << manifest << "." << std::endl;
+        return false;
+
+    }
+
+    numSeqs_t numPools = 0;
+    bool fits = readPhase1Header(iStream, numPools, sc) && (numPools == pools.numPools());
+    for (numSeqs_t p = 0; fits && p < pools.numPools(); p++) {
+
+        std::vector<SwarmClustering::Otu*> otus;
+        SwarmClustering::OtuArena arena;
+        fits = readPhase1Pool(iStream, *(pools.get(p)), otus, arena) && otus.empty();
+
+    }
+
+    iStream.close();
+
+    if (!fits) {
+        std::cerr << "ERROR: The shard manifest " << manifest << " does not match the input data or the clustering parameters." << std::endl;
+    }
+
+    return fits;
+
+}
+
+bool SwarmClustering::shardCoordinate(const AmpliconPools& pools, const SwarmConfig& sc) {
+
+    std::cout << "Preparing shard directory " << sc.shardDir << "..." << std::endl;
+
+    // remove results of earlier runs and reset the work queue
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        std::remove(shardPoolFile(sc.shardDir, p).c_str());
+    }
+
+    std::string queue = shardFile(sc.shardDir, "queue");
+    std::ofstream qStream(queue, std::ios::out | std::ios::binary);
+    writeValue(qStream, 0ULL);
+    qStream.close();
+
+    // the manifest (a first-phase file without OTUs) is written last and becomes visible at once,
+    // so that its presence signals that the queue is ready
+    std::string manifest = shardFile(sc.shardDir, "manifest");
+    std::ofstream oStream(manifest + ".tmp", std::ios::out | std::ios::binary);
+
+    std::vector<Otu*> noOtus;
+    writePhase1Header(oStream, pools.numPools(), sc);
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        writePhase1Pool(oStream, *(pools.get(p)), noOtus);
+    }
+
+    oStream.close();
+
+    if (!qStream || !oStream || std::rename((manifest + ".tmp").c_str(), manifest.c_str()) != 0) {
+
+        std::cerr << "ERROR: Could not write the manifest and the work queue to " << sc.shardDir << "." << std::endl;
+        std::remove((manifest + ".tmp").c_str());
+        return false;
+
+    }
+
+    std::cout << "Manifest of " << pools.numPools() << " pools written." << std::endl;
+
+    return true;
+
+}
+
+// take the next pool from the work queue (a counter in the queue file, guarded by an exclusive file lock),
+// returns false if the queue cannot be accessed or is exhausted
+inline bool claimPool(const int fd, std::mutex& mtx, const numSeqs_t numPools, numSeqs_t& p) {
+
+    // the mutex covers the threads of this process in case the file lock is only held per process (e.g. emulated on NFS)
+    std::lock_guard<std::mutex> lock(mtx);
+    if (flock(fd, LOCK_EX) != 0) return false;
+
+    unsigned long long next = 0;
+    bool claimed = (pread(fd, &next, sizeof(next), 0) == sizeof(next)) && (next < numPools);
+    if (claimed) {
+
+        p = next++;
+        claimed = (pwrite(fd, &next, sizeof(next), 0) == sizeof(next)) && (fsync(fd) == 0);
+
+    }
+
+    flock(fd, LOCK_UN);
+
+    return claimed;
+
+}
+
+bool SwarmClustering::shardWork(const AmpliconPools& pools, const SwarmConfig& sc) {
+
+    if (!checkManifest(pools, sc)) return false;
+
+    std::string queue = shardFile(sc.shardDir, "queue");
+    int fd = open(queue.c_str(), O_RDWR);
+    if (fd < 0) {
+
+        std::cerr << "ERROR: Could not open the work queue " << queue << "." << std::endl;
+        return false;
+
+    }
+
+    // exploration mode 1 uses all explorer threads for one pool at a time
+    bool components = (sc.explorationMode == 1);
+    auto fun = components ? &SegmentFilter::swarmFilterComponents : explorerFunction(sc, true);
+    unsigned long numThreads = components ? 1 : sc.numExplorers;
+
+    std::mutex mtx;
+    std::atomic<numSeqs_t> numClaimed(0);
+    std::atomic<bool> failed(false);
+
+    auto work = [&]() {
+
+        numSeqs_t p = 0;
+        while (!failed && claimPool(fd, mtx, pools.numPools(), p)) {
+
+            std::vector<Otu*> otus;
+            OtuArena arena;
+            fun(*(pools.get(p)), otus, arena, sc);
+
+            // write to a temporary file first, so that the merge step only sees complete pool results
+            std::string poolFile = shardPoolFile(sc.shardDir, p);
+            std::string tmpFile = poolFile + ".tmp." + std::to_string(getpid());
+            std::ofstream oStream(tmpFile, std::ios::out | std::ios::binary);
+            writePhase1Header(oStream, pools.numPools(), sc);
+            writeValue(oStream, p);
+            writePhase1Pool(oStream, *(pools.get(p)), otus);
+            oStream.close();
+
+            if (!oStream || std::rename(tmpFile.c_str(), poolFile.c_str()) != 0) {
+
+                std::cerr << "ERROR: Could not write the results of pool " << p << " to " << poolFile << "." << std::endl;
+                std::remove(tmpFile.c_str());
+                failed = true;
+
+            }
+
+            numClaimed++;
+
+        }
+
+    };
+
+    std::cout << "Clustering..." << std::endl;
+    std::thread workers[numThreads];
+    for (unsigned long w = 0; w < numThreads; w++) {
+        workers[w] = std::thread(work);
+    }
+    for (unsigned long w = 0; w < numThreads; w++) {
+        workers[w].join();
+    }
+    close(fd);
+
+    std::cout << "Explored " << numClaimed << " pools." << std::endl << std::endl;
+
+    return !failed;
+
+}
+
+bool SwarmClustering::shardMerge(const AmpliconPools& pools, const SwarmConfig& sc) {
+
+    if (!checkManifest(pools, sc)) return false;
+
+    std::vector<std::vector<Otu*>> otus(pools.numPools());
+    std::vector<OtuArena> arenas(pools.numPools());
+    std::vector<numSeqs_t> missing;
+
+    std::cout << "Reading first-phase OTUs of the shards..." << std::endl;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+
+        std::string poolFile = shardPoolFile(sc.shardDir, p);
+        std::ifstream iStream(poolFile, std::ios::in | std::ios::binary);
+        if (!iStream.good()) {
+
+            missing.push_back(p);
+            continue;
+
+        }
+
+        numSeqs_t numPools = 0;
+        bool fits = readPhase1Header(iStream, numPools, sc) && (numPools == pools.numPools()) && (readValue<numSeqs_t>(iStream) == p)
+                    && readPhase1Pool(iStream, *(pools.get(p)), otus[p], arenas[p]);
+        iStream.close();
+
+        if (!fits) {
+
+            std::cerr << "ERROR: First-phase OTUs in " << poolFile << " do not match the input data or the clustering parameters." << std::endl;
+            return false;
+
+        }
+
+    }
+
+    if (!missing.empty()) {
+
+        std::cerr << "ERROR: No results for " << missing.size() << " pools (";
+        for (auto iter = missing.begin(); iter != missing.end(); iter++) {
+            std::cerr << ((iter == missing.begin()) ? "" : ", ") << *iter;
+        }
+        std::cerr << ") in " << sc.shardDir << "." << std::endl;
+
+        return false;
+
+    }
+    std::cout << std::endl;
+
+    if (sc.outPhase1) outputPhase1(sc.oFilePhase1, pools, otus, sc);
+
+    processOtus(pools, otus, sc);
+
+    return true;
+
+}
+
+// append the member records of the given OTU (without grafted OTUs) and their strings,
+// parents are resolved via indices (member records of the amplicons) after all members got their index
+inline void appendMemberRecords(const SwarmClustering::Otu& otu, std::vector<SwarmClustering::ResultMember>& memberRecords, std::string& strings,
+                                std::unordered_map<const Amplicon*, uint64_t>& indices) {
+
+    auto addString = [&strings](const char* str, const size_t len) {
+
+        uint64_t offset = strings.size();
+        strings.append(str, len);
+        strings.push_back('\0');
+
+        return offset;
+
+    };
+
+    uint64_t first = memberRecords.size();
+    for (auto memberIter = otu.members; memberIter != otu.members + otu.numMembers; memberIter++) {
+
+        const Amplicon* ampl = otu.amplicon(memberIter->member);
+        indices[ampl] = memberRecords.size();
+
+        SwarmClustering::ResultMember rec = SwarmClustering::ResultMember();
+        rec.idLen = strlen(ampl->id);
+        rec.id = addString(ampl->id, rec.idLen);
+        rec.seqLen = ampl->len;
+        rec.seq = addString(ampl->seq, rec.seqLen);
+        rec.abundance = ampl->abundance;
+        rec.parentDist = memberIter->parentDist;
+        rec.gen = memberIter->gen;
+        memberRecords.push_back(rec);
+
+    }
+
+    for (numSeqs_t i = 0; i < otu.numMembers; i++) {
+        memberRecords[first + i].parent = indices[otu.amplicon(otu.members[i].parent)];
+    }
+
+}
+
+// fill the statistics of the OTU record
+inline void setOtuStatistics(SwarmClustering::Otu& otu, SwarmClustering::ResultOtu& rec) {
+
+    auto maxGenRad = otu.maxGenRad();
+    rec.mass = otu.mass;
+    rec.numUniqueSequences = otu.numUniqueSequences;
+    rec.seedAbundance = otu.seedAbundance();
+    rec.numSingletons = otu.numTotalSingletons();
+    rec.maxGen = maxGenRad.first;
+    rec.maxRad = maxGenRad.second;
+
+}
+
+void SwarmClustering::writeRun(std::string& run, std::vector<Otu*>& otus,
+                               const std::unordered_map<const Otu*, std::vector<SerialisedGraft>>* grafts) {
+
+    std::sort(otus.begin(), otus.end(), CompareOtusSeedAbund());
+
+    std::vector<ResultMember> memberRecords;
+    std::vector<ResultGraft> graftRecords;
+    std::string strings;
+    std::unordered_map<const Amplicon*, uint64_t> indices;
+
+    for (auto otu : otus) {
+
+        if (otu->attached()) continue;
+
+        memberRecords.clear();
+        graftRecords.clear();
+        strings.clear();
+        indices.clear();
+
+        appendMemberRecords(*otu, memberRecords, strings, indices);
+
+        RunOtu rec = RunOtu();
+        rec.seedRank = otu->seed()->rank;
+        rec.otu.numMembers = otu->numMembers;
+        setOtuStatistics(*otu, rec.otu);
+
+        const std::vector<SerialisedGraft>* otuGrafts = 0;
+        if (grafts != 0) {
+
+            auto iter = grafts->find(otu);
+            if (iter != grafts->end()) otuGrafts = &(iter->second);
+
+        }
+
+        if (otuGrafts != 0) {
+
+            // the serialised OTUs are appended in the order in which cluster(...) chains them
+            std::vector<const SerialisedGraft*> sorted;
+            for (auto& g : *otuGrafts) {
+                sorted.push_back(&g);
+            }
+            std::sort(sorted.begin(), sorted.end(), [](const SerialisedGraft* a, const SerialisedGraft* b) {
+                return (a->parentRank < b->parentRank) || ((a->parentRank == b->parentRank) && (a->childRank < b->childRank));
+            });
+
+            for (auto g : sorted) {
+
+                ResultGraft graft = ResultGraft();
+                graft.firstMember = memberRecords.size();
+                graft.numMembers = g->members.size();
+                graft.parent = g->parentMember;
+                graft.child = graft.firstMember + g->childMember;
+                graft.dist = g->dist;
+                graft.gen = g->gen;
+                graftRecords.push_back(graft);
+
+                for (auto member : g->members) {
+
+                    member.id += strings.size();
+                    member.seq += strings.size();
+                    member.parent += graft.firstMember;
+                    memberRecords.push_back(member);
+
+                }
+                strings.append(g->strings);
+
+                rec.otu.mass += g->mass;
+                rec.otu.numUniqueSequences += g->numUniqueSequences;
+                rec.otu.numSingletons += g->numSingletons;
+
+            }
+
+        }
+
+        rec.otu.numTotalMembers = memberRecords.size();
+        rec.otu.numGrafts = graftRecords.size();
+        rec.size = sizeof(RunOtu) + memberRecords.size() * sizeof(ResultMember) + graftRecords.size() * sizeof(ResultGraft) + strings.size();
+
+        run.append(reinterpret_cast<const char*>(&rec), sizeof(RunOtu));
+        run.append(reinterpret_cast<const char*>(memberRecords.data()), memberRecords.size() * sizeof(ResultMember));
+        run.append(reinterpret_cast<const char*>(graftRecords.data()), graftRecords.size() * sizeof(ResultGraft));
+        run.append(strings);
+
+    }
+
+}
+
+void SwarmClustering::mergeRuns(const std::string runFile, const std::vector<std::pair<uint64_t, uint64_t>>& runs, const numSeqs_t numOtus,
+                                const lenSeqs_t maxLen, const SwarmConfig& sc) {
+
+    enum OutputKind {
+        OUTPUT_INTERNALS, OUTPUT_OTUS, OUTPUT_STATISTICS, OUTPUT_SEEDS, OUTPUT_UCLUST
+    };
+
+    std::vector<std::pair<OutputKind, std::string>> outputs;
+    if (sc.outInternals) outputs.emplace_back(OUTPUT_INTERNALS, sc.oFileInternals);
+    if (sc.outOtus) outputs.emplace_back(OUTPUT_OTUS, sc.oFileOtus);
+    if (sc.outStatistics) outputs.emplace_back(OUTPUT_STATISTICS, sc.oFileStatistics);
+    if (sc.outSeeds) outputs.emplace_back(OUTPUT_SEEDS, sc.oFileSeeds);
+    if (sc.outUclust) outputs.emplace_back(OUTPUT_UCLUST, sc.oFileUclust);
+
+    std::ifstream iStream(runFile, std::ios::in | std::ios::binary);
+    std::vector<std::ofstream> oStreams(outputs.size());
+    for (numSeqs_t o = 0; o < outputs.size(); o++) {
+
+        oStreams[o].open(outputs[o].second);
+        if (outputs[o].first == OUTPUT_OTUS && sc.outMothur) oStreams[o] << "swarm_" << sc.threshold << "\t" << numOtus;
+
+    }
+
+    // one scratch space and buffer per output, the outputs of a batch are formatted concurrently
+    lenSeqs_t width = maxLen + 1; // the DP rows need one entry more than the longest sequence
+    std::vector<OutputScratch> scratches(outputs.size());
+    std::vector<OutputBuffer> bufs(outputs.size());
+    for (auto& scratch : scratches) {
+
+        scratch.M.resize(sc.useScore ? 1 : width);
+        scratch.D.resize(sc.useScore ? width : 1);
+        scratch.P.resize(sc.useScore ? width : 1);
+        scratch.cntDiffs.resize(sc.useScore ? width : 1);
+        scratch.cntDiffsP.resize(sc.useScore ? width : 1);
+
+    }
+
+    const numSeqs_t batchSize = 1024; // OTUs per batch
+    std::vector<ResultOtu> batchOtus;
+    std::vector<ResultMember> batchMembers;
+    std::vector<ResultGraft> batchGrafts;
+    std::vector<char> batchStrings;
+    numSeqs_t numWritten = 0;
+
+    auto flushBatch = [&]() {
+
+        std::vector<Amplicon> ampls;
+        OtuArena arena;
+        std::vector<Otu*> otus;
+        rebuildOtus(batchOtus, batchMembers, batchGrafts, batchStrings, ampls, arena, otus);
+
+        std::vector<numSeqs_t> unattached(otus.size());
+        std::iota(unattached.begin(), unattached.end(), 0);
+
+        auto format = [&](const numSeqs_t o) {
+
+            switch (outputs[o].first) {
+
+                case OUTPUT_INTERNALS:
+                    formatInternalStructures(bufs[o], otus, unattached, 0, otus.size(), scratches[o], sc, numWritten);
+                    break;
+
+                case OUTPUT_OTUS:
+                    (sc.outMothur) ?
+                      formatOtusMothur(bufs[o], otus, unattached, 0, otus.size(), sc.sepMothur, sc.sepMothurOtu, sc.sepAbundance)
+                    : formatOtus(bufs[o], otus, unattached, 0, otus.size(), sc.sepOtus, sc.sepAbundance);
+                    break;
+
+                case OUTPUT_STATISTICS:
+                    formatStatistics(bufs[o], otus, unattached, 0, otus.size(), sc.sepStatistics);
+                    break;
+
+                case OUTPUT_SEEDS:
+                    formatSeeds(bufs[o], otus, unattached, 0, otus.size(), sc.sepAbundance);
+                    break;
+
+                case OUTPUT_UCLUST:
+                    formatUclust(bufs[o], otus, unattached, 0, otus.size(), scratches[o], sc, numWritten);
+                    break;
+
+            }
+
+            oStreams[o].write(bufs[o].data(), bufs[o].size());
+            bufs[o].clear();
+
+        };
+
+        if (sc.numWriters > 1) {
+
+            std::thread formatters[outputs.size()];
+            for (numSeqs_t o = 0; o < outputs.size(); o++) {
+                formatters[o] = std::thread(format, o);
+            }
+            for (numSeqs_t o = 0; o < outputs.size(); o++) {
+                formatters[o].join();
+            }
+
+        } else {
+
+            for (numSeqs_t o = 0; o < outputs.size(); o++) {
+                format(o);
+            }
+
+        }
+
+        numWritten += otus.size();
+        batchOtus.clear();
+        batchMembers.clear();
+        batchGrafts.clear();
+        batchStrings.clear();
+
+    };
+
+    // k-way merge of the runs by the ranks of the seeds
+    std::vector<SegmentReader> readers(runs.size());
+    std::priority_queue<std::pair<uint64_t, numSeqs_t>, std::vector<std::pair<uint64_t, numSeqs_t>>, std::greater<std::pair<uint64_t, numSeqs_t>>> heads;
+    bool success = true;
+
+    for (numSeqs_t r = 0; r < runs.size(); r++) {
+
+        readers[r] = SegmentReader(runs[r].first, runs[r].second);
+        if (!readers[r].empty()) {
+
+            success = success && readers[r].fill(iStream, sizeof(RunOtu));
+            heads.emplace(readers[r].peek<RunOtu>().seedRank, r);
+
+        }
+
+    }
+
+    while (success && !heads.empty()) {
+
+        numSeqs_t r = heads.top().second;
+        SegmentReader& reader = readers[r];
+        heads.pop();
+
+        RunOtu head = reader.peek<RunOtu>();
+        success = reader.fill(iStream, head.size);
+        if (!success) break;
+
+        const char* rec = reader.current();
+        const char* memberRecs = rec + sizeof(RunOtu);
+        const char* graftRecs = memberRecs + head.otu.numTotalMembers * sizeof(ResultMember);
+        const char* strings = graftRecs + head.otu.numGrafts * sizeof(ResultGraft);
+
+        ResultOtu otu = head.otu;
+        otu.firstMember = batchMembers.size();
+        otu.firstGraft = batchGrafts.size();
+        batchOtus.push_back(otu);
+
+        for (numSeqs_t g = 0; g < otu.numGrafts; g++) {
+
+            ResultGraft graft;
+            memcpy(&graft, graftRecs + g * sizeof(ResultGraft), sizeof(ResultGraft));
+            graft.parent += otu.firstMember;
+            graft.child += otu.firstMember;
+            graft.firstMember += otu.firstMember;
+            batchGrafts.push_back(graft);
+
+        }
+
+        for (numSeqs_t m = 0; m < otu.numTotalMembers; m++) {
+
+            ResultMember member;
+            memcpy(&member, memberRecs + m * sizeof(ResultMember), sizeof(ResultMember));
+            member.id += batchStrings.size();
+            member.seq += batchStrings.size();
+            member.parent += otu.firstMember;
+            batchMembers.push_back(member);
+
+        }
+        batchStrings.insert(batchStrings.end(), strings, rec + head.size);
+
+        reader.pos += head.size;
+        if (!reader.empty()) {
+
+            success = reader.fill(iStream, sizeof(RunOtu));
+            heads.emplace(reader.peek<RunOtu>().seedRank, r);
+
+        }
+
+        if (batchOtus.size() == batchSize) flushBatch();
+
+    }
+
+    if (!success) {
+        std::cerr << "ERROR: Could not read the runs from " << runFile << "." << std::endl;
+    }
+    if (!batchOtus.empty()) flushBatch();
+
+    iStream.close();
+    for (numSeqs_t o = 0; o < outputs.size(); o++) {
+
+        if (outputs[o].first == OUTPUT_OTUS && sc.outMothur) oStreams[o] << std::endl;
+        oStreams[o].close();
+
+    }
+
+}
+
+bool SwarmClustering::clusterStreaming(AmpliconPools& pools, const SwarmConfig& sc) {
+
+    lenSeqs_t maxLen = 0;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+        maxLen = std::max(maxLen, pools.maxLen(p));
+    }
+
+    std::string runFile = (sc.outOtus ? sc.oFileOtus : sc.outInternals ? sc.oFileInternals : sc.outStatistics ? sc.oFileStatistics
+                           : sc.outSeeds ? sc.oFileSeeds : sc.oFileUclust) + ".runs";
+    std::ofstream runStream(runFile, std::ios::out | std::ios::binary);
+    if (!runStream.good()) {
+
+        std::cerr << "ERROR: Could not open the run file " << runFile << "." << std::endl;
+        return false;
+
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> runs(pools.numPools()); // offset and length of the run of each pool
+    uint64_t runEnd = 0;
+
+    numSeqs_t numOtus = 0;
+    numSeqs_t maxSize = 0;
+    lenSeqs_t maxGen = 0;
+    std::mutex mtx;
+
+    // explorationMode 1 explores the components of one pool in parallel, so the pools are explored one after another
+    auto fun = (sc.explorationMode == 1) ? &SegmentFilter::swarmFilterComponents : explorerFunction(sc, true);
+    unsigned long numExplorers = (sc.explorationMode == 1) ? 1 : sc.numExplorers;
+    std::atomic<numSeqs_t> nextPool(0);
+
+    auto explore = [&]() {
+
+        std::string run;
+
+        for (numSeqs_t p = nextPool++; p < pools.numPools(); p = nextPool++) {
+
+            numSeqs_t poolMaxSize = 0;
+            lenSeqs_t poolMaxGen = 0;
+            numSeqs_t poolNumOtus = 0;
+
+            {
+                std::vector<Otu*> otus;
+                OtuArena arena;
+
+                if (pools.outOfCore()) Preprocessor::loadPool(pools, p);
+                fun(*(pools.get(p)), otus, arena, sc);
+
+                for (auto otu : otus) {
+
+                    poolMaxSize = std::max(poolMaxSize, otu->numMembers);
+                    poolMaxGen = std::max(poolMaxGen, otu->maxGen());
+
+                }
+                poolNumOtus = otus.size();
+
+                writeRun(run, otus);
+
+            } // OTUs of the pool are released together with the arena
+
+            pools.release(p);
+
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+
+                runs[p] = std::make_pair(runEnd, run.size());
+                runStream.write(run.data(), run.size());
+                runEnd += run.size();
+
+                numOtus += poolNumOtus;
+                maxSize = std::max(maxSize, poolMaxSize);
+                maxGen = std::max(maxGen, poolMaxGen);
+            }
+
+            run.clear();
+
+        }
+
+    };
+
+    std::cout << "Clustering (streaming)..." << std::endl;
+    std::thread explorers[numExplorers];
+    for (unsigned long e = 0; e < numExplorers; e++) {
+        explorers[e] = std::thread(explore);
+    }
+    for (unsigned long e = 0; e < numExplorers; e++) {
+        explorers[e].join();
+    }
+    runStream.close();
+    std::cout << std::endl;
+
+    std::cout << "Merging runs..." << std::endl;
+    mergeRuns(runFile, runs, numOtus, maxLen, sc);
+    std::remove(runFile.c_str());
+
+    std::cout << std::endl;
+    std::cout << "Number of swarms: " << numOtus << std::endl;
     std::cout << "Largest swarm: " << maxSize << std::endl;
-    std::cout << "Max generations: 0" << std::endl << std::endl;
+    std::cout << "Max generations: " << maxGen << std::endl << std::endl;
+
+    return true;
+
+}
+
+bool SwarmClustering::clusterOutOfCore(AmpliconPools& pools, const SwarmConfig& sc) {
+
+    SwarmConfig scc = sc;
+    if (sc.fastidiousCheckingMode > 2) {
+
+        std::cerr << "WARNING: Fastidious checking mode " << sc.fastidiousCheckingMode << " requires all pools at the same time. "
+                  << "Using mode 0 instead." << std::endl;
+        scc.fastidiousCheckingMode = 0;
+
+    }
+
+    const numSeqs_t numPools = pools.numPools();
+    const numSeqs_t halfRange = sc.fastidiousThreshold / (sc.threshold + 1);
+
+    lenSeqs_t maxLen = 0;
+    for (numSeqs_t p = 0; p < numPools; p++) {
+        maxLen = std::max(maxLen, pools.maxLen(p));
+    }
+
+    std::string runFile = (sc.outOtus ? sc.oFileOtus : sc.outInternals ? sc.oFileInternals : sc.outStatistics ? sc.oFileStatistics
+                           : sc.outSeeds ? sc.oFileSeeds : sc.oFileUclust) + ".runs";
+    std::ofstream runStream(runFile, std::ios::out | std::ios::binary);
+    if (!runStream.good()) {
+
+        std::cerr << "ERROR: Could not open the run file " << runFile << "." << std::endl;
+        return false;
+
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> runs(numPools); // offset and length of the run of each pool
+    uint64_t runEnd = 0;
+    std::string run;
+
+    std::vector<std::vector<Otu*>> otus(numPools);
+    std::vector<std::unique_ptr<OtuArena>> arenas(numPools); // storage of the OTUs of the pools in memory
+    std::unordered_map<const Otu*, std::vector<SerialisedGraft>> grafts; // OTUs grafted upon the OTUs of the pools in memory
+
+    // scratch space for the distances of the grafts
+    lenSeqs_t width = maxLen + 1; // the DP rows need one entry more than the longest sequence
+    std::vector<lenSeqs_t> M(sc.useScore ? 1 : width);
+    std::vector<val_t> D(sc.useScore ? width : 1);
+    std::vector<val_t> P(sc.useScore ? width : 1);
+    std::vector<lenSeqs_t> cntDiffs(sc.useScore ? width : 1);
+    std::vector<lenSeqs_t> cntDiffsP(sc.useScore ? width : 1);
+
+    numSeqs_t numOtus = 0;
+    numSeqs_t numOtusAdjusted = 0;
+    numSeqs_t numAmplicons = 0;
+    numSeqs_t numLightOtus = 0;
+    numSeqs_t numAmplLightOtus = 0;
+    numSeqs_t numGrafts = 0;
+    numSeqs_t maxSizeBefore = 0;
+    numSeqs_t maxSize = 0;
+    lenSeqs_t maxGen = 0;
+
+    // explorationMode 1 explores the components of one pool in parallel, otherwise up to sc.numExplorers pools are explored at once
+    auto fun = (sc.explorationMode == 1) ? &SegmentFilter::swarmFilterComponents : explorerFunction(sc, true);
+    numSeqs_t numExplorers = (sc.explorationMode == 1) ? 1 : sc.numExplorers;
+    numSeqs_t numExplored = 0;
+
+    auto explore = [&](const numSeqs_t p) {
+
+        Preprocessor::loadPool(pools, p);
+        arenas[p].reset(new OtuArena());
+        fun(*(pools.get(p)), otus[p], *(arenas[p]), sc);
+
+    };
+
+    std::cout << "Clustering (out of core)..." << std::endl;
+    for (numSeqs_t s = 0; s < numPools + 2 * halfRange; s++) {
+
+        /* (a) Explore pool s (and the following ones, one per explorer) */
+        if (s < numPools && s == numExplored) {
+
+            numSeqs_t end = std::min(numPools, numExplored + numExplorers);
+            std::thread explorers[end - numExplored];
+            for (numSeqs_t p = numExplored; p < end; p++) {
+                explorers[p - numExplored] = std::thread(explore, p);
+            }
+            for (numSeqs_t p = numExplored; p < end; p++) {
+
+                explorers[p - numExplored].join();
+
+                for (auto otu : otus[p]) {
+
+                    maxSizeBefore = std::max(maxSizeBefore, otu->numMembers);
+                    maxGen = std::max(maxGen, otu->maxGen());
+                    numLightOtus += (otu->mass < sc.boundary);
+                    numAmplLightOtus += (otu->mass < sc.boundary) * otu->numMembers;
+
+                }
+                numOtus += otus[p].size();
+                numAmplicons += pools.get(p)->size();
+
+            }
+            numExplored = end;
+
+        }
+
+        /* (b) Graft the light OTUs of pool s - halfRange (all pools within its fastidious range have been explored) */
+        if (s >= halfRange && s - halfRange < numPools) {
+
+            std::vector<GraftCandidate> graftCands;
+            std::mutex graftCandsMtx;
+            determineGrafts(pools, otus, graftCands, s - halfRange, graftCandsMtx, scc);
+            sortGraftCandidates(graftCands, sc.numGrafters);
+
+            // as in graftOtus(...), a light OTU is grafted by its first candidate
+            std::unordered_map<const Amplicon*, uint64_t> indices;
+            for (auto& gc : graftCands) {
+
+                if (gc.childOtu->attached()) continue;
+
+                SerialisedGraft g;
+                indices.clear();
+                appendMemberRecords(*(gc.childOtu), g.members, g.strings, indices);
+
+                g.parentRank = gc.parentAmplicon()->rank;
+                g.childRank = gc.childMember->rank;
+                g.parentMember = gc.parentMember - gc.parentOtu->members;
+                g.childMember = indices[gc.childMember];
+                g.dist = (sc.useScore) ? Verification::computeGotohLengthAwareEarlyRow(gc.childMember->seq, gc.childMember->len,
+                                                                                       gc.parentAmplicon()->seq, gc.parentAmplicon()->len,
+                                                                                       sc.fastidiousThreshold, sc.scoring, D.data(), P.data(),
+                                                                                       cntDiffs.data(), cntDiffsP.data())
+                                       : Verification::computeLengthAwareRow(gc.childMember->seq, gc.childMember->len,
+                                                                             gc.parentAmplicon()->seq, gc.parentAmplicon()->len,
+                                                                             sc.fastidiousThreshold, M.data());
+                g.gen = gc.parentMember->gen + 1;
+                g.mass = gc.childOtu->mass;
+                g.numUniqueSequences = gc.childOtu->numUniqueSequences;
+                g.numSingletons = gc.childOtu->numSingletons();
+
+                grafts[gc.parentOtu].push_back(std::move(g));
+                gc.childOtu->mass = 0; // marks the OTU as attached (its pool no longer looks for parents)
+                numGrafts++;
+
+            }
+
+        }
+
+        /* (c) Write and release pool s - 2 * halfRange (no longer within the fastidious range of a pool still to be grafted) */
+        if (s >= 2 * halfRange && s - 2 * halfRange < numPools) {
+
+            numSeqs_t e = s - 2 * halfRange;
+
+            for (auto otu : otus[e]) {
+
+                if (otu->attached()) continue;
+
+                numSeqs_t size = otu->numMembers;
+                auto iter = grafts.find(otu);
+                if (iter != grafts.end()) {
+
+                    for (auto& g : iter->second) {
+                        size += g.members.size();
+                    }
+
+                }
+                maxSize = std::max(maxSize, size);
+                numOtusAdjusted++;
+
+            }
+
+            writeRun(run, otus[e], &grafts);
+            for (auto otu : otus[e]) {
+                grafts.erase(otu);
+            }
+
+            runs[e] = std::make_pair(runEnd, run.size());
+            runStream.write(run.data(), run.size());
+            runEnd += run.size();
+            run.clear();
+
+            otus[e] = std::vector<Otu*>();
+            arenas[e].reset(); // OTUs of the pool are released together with the arena
+            pools.release(e);
+
+        }
+
+    }
+    runStream.close();
+    maxSize = std::max(maxSize, maxSizeBefore);
+
+    std::cout << "Results before fastidious processing: " << std::endl;
+    std::cout << "Number of swarms: " << numOtus << std::endl;
+    std::cout << "Largest swarms: " << maxSizeBefore << std::endl << std::endl;
+    std::cout << "Heavy swarms: " << (numOtus - numLightOtus) << ", with " << (numAmplicons - numAmplLightOtus) << " amplicons" << std::endl;
+    std::cout << "Light swarms: " << numLightOtus << ", with " << numAmplLightOtus << " amplicons" << std::endl << std::endl;
+    std::cout << "Made " << numGrafts << " grafts." << std::endl << std::endl;
+
+    std::cout << "Merging runs..." << std::endl;
+    mergeRuns(runFile, runs, numOtusAdjusted, maxLen, sc);
+    std::remove(runFile.c_str());
+
+    std::cout << std::endl;
+    std::cout << "Number of swarms: " << numOtusAdjusted << std::endl;
+    std::cout << "Largest swarm: " << maxSize << std::endl;
+    std::cout << "Max generations: " << maxGen << std::endl << std::endl;
+
+    return true;
+
+}
+
+bool SwarmClustering::clusterSweep(const AmpliconPools& pools, const SwarmConfig& sc) {
+
+    /* (a) Shared first clustering phase */
+    std::vector<std::vector<Otu*>> otus(pools.numPools());
+    std::vector<OtuArena> arenas(pools.numPools()); // storage of the OTUs of each pool
+
+    if (!explorePools(pools, otus, arenas, sc)) return false;
+
+    // state of the OTUs after the first phase (restored before each configuration) and sorted OTU masses
+    std::vector<std::pair<numSeqs_t, numSeqs_t>> states;
+    std::vector<numSeqs_t> masses;
+    for (auto& poolOtus : otus) {
+
+        for (auto otu : poolOtus) {
+
+            states.push_back(std::make_pair(otu->mass, otu->numUniqueSequences));
+            masses.push_back(otu->mass);
+
+        }
+
+    }
+    std::sort(masses.begin(), masses.end());
+
+    // The grafting candidates depend only on the fastidious threshold and the set of light OTUs.
+    // Boundaries leading to the same number of light OTUs lead to the same set of light OTUs.
+    std::map<std::pair<lenSeqs_t, numSeqs_t>, std::vector<GraftCandidate>> graftCandsCache;
+
+    /* (b) Fastidious clustering phase and outputs for each configuration */
+    for (auto& conf : sc.sweep) {
+
+        SwarmConfig scc = sc;
+        scc.fastidious = true;
+        scc.boundary = conf.first;
+        scc.fastidiousThreshold = conf.second;
+
+        std::string suffix = ".b" + std::to_string(conf.first) + ".f" + std::to_string(conf.second);
+        scc.oFileInternals += suffix;
+        scc.oFileOtus += suffix;
+        scc.oFileStatistics += suffix;
+        scc.oFileSeeds += suffix;
+        scc.oFileUclust += suffix;
+        scc.oFileBinary += suffix;
+
+        std::cout << "===== Boundary " << conf.first << ", fastidious threshold " << conf.second << " =====" << std::endl;
+
+        // undo the grafting of the previous configuration
+        auto stateIter = states.begin();
+        for (auto& poolOtus : otus) {
+
+            for (auto otu : poolOtus) {
+
+                otu->mass = stateIter->first;
+                otu->numUniqueSequences = stateIter->second;
+                otu->nextGraftedOtu = otu->lastGraftedOtu = 0;
+                otu->graftParentOtu = 0;
+                otu->graftParent = 0;
+                otu->graftChild = 0;
+                stateIter++;
+
+            }
+
+        }
+
+        auto key = std::make_pair(scc.fastidiousThreshold,
+                                  numSeqs_t(std::lower_bound(masses.begin(), masses.end(), scc.boundary) - masses.begin()));
+        auto cacheIter = graftCandsCache.find(key);
+        if (cacheIter == graftCandsCache.end()) {
+
+            cacheIter = graftCandsCache.insert(std::make_pair(key, std::vector<GraftCandidate>())).first;
+            determineAllGrafts(pools, otus, cacheIter->second, scc);
+
+        } else {
+            std::cout << "Reusing " << cacheIter->second.size() << " grafting candidates of an earlier configuration." << std::endl;
+        }
+
+        std::vector<std::vector<Otu*>> otusCopy(otus); // processOtus() empties the OTU vectors
+        processOtus(pools, otusCopy, scc, &(cacheIter->second));
+
+    }
+
+    return true;
 
 }
 
 
-void SwarmClustering::outputInternalStructures(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const SwarmConfig& sc) {
+bool SwarmClustering::clusterMultiThreshold(const AmpliconPools& pools, const SwarmConfig& sc) {
+
+    /* (a) Filter and verify once with the largest threshold */
+    std::vector<MatchGraph> graphs(pools.numPools());
+    std::thread explorers[sc.numExplorers];
+    unsigned long r = 0;
+
+    std::cout << "Determining matches..." << std::endl;
+    for (; r + sc.numExplorers <= pools.numPools(); r += sc.numExplorers) {
 
-    std::ofstream oStream(oFile);
-    std::stringstream sStream;
+        for (unsigned long e = 0; e < sc.numExplorers; e++) {
+            explorers[e] = std::thread(&SwarmClustering::computeMatchGraph, std::ref(*(pools.get(r + e))), std::ref(graphs[r + e]), std::ref(sc));
+        }
+        for (unsigned long e = 0; e < sc.numExplorers; e++) {
+            explorers[e].join();
+        }
 
-    lenSeqs_t width = 0;
-    for (lenSeqs_t p = 0; p < pools.numPools(); p++) {
-        width = std::max(width, pools.get(p)->maxLen());
     }
 
-    lenSeqs_t M[sc.useScore ? 1 : width];
-    val_t D[sc.useScore? width : 1];
-    val_t P[sc.useScore? width : 1];
-    lenSeqs_t cntDiffs[sc.useScore? width : 1];
-    lenSeqs_t cntDiffsP[sc.useScore? width : 1];
+    for (unsigned long e = 0; e < pools.numPools() % sc.numExplorers; e++) {
+        explorers[e] = std::thread(&SwarmClustering::computeMatchGraph, std::ref(*(pools.get(r + e))), std::ref(graphs[r + e]), std::ref(sc));
+    }
+    for (unsigned long e = 0; e < pools.numPools() % sc.numExplorers; e++) {
+        explorers[e].join();
+    }
 
-    Otu* otu = 0;
-    numSeqs_t otuId = 0;
+    unsigned long numMatches = 0;
+    for (auto& g : graphs) {
+        numMatches += g.numMatches();
+    }
+    std::cout << "Found " << numMatches << " matches." << std::endl << std::endl;
+
+    /* (b) Derive the clustering for every threshold from the match graphs */
+    for (lenSeqs_t d = 1; d <= sc.threshold; d++) {
+
+        SwarmConfig scd = sc;
+        scd.threshold = d;
+        if (!sc.explicitFastidiousThreshold) scd.fastidiousThreshold = 2 * d;
+        scd.oFileInternals += "." + std::to_string(d);
+        scd.oFileOtus += "." + std::to_string(d);
+        scd.oFileStatistics += "." + std::to_string(d);
+        scd.oFileSeeds += "." + std::to_string(d);
+        scd.oFileUclust += "." + std::to_string(d);
+        scd.oFileBinary += "." + std::to_string(d);
+
+        std::vector<std::vector<Otu*>> otus(pools.numPools());
+        std::vector<OtuArena> arenas(pools.numPools()); // storage of the OTUs of each pool
+
+        std::cout << "Clustering (threshold " << d << ")..." << std::endl;
+        for (r = 0; r + sc.numExplorers <= pools.numPools(); r += sc.numExplorers) {
+
+            for (unsigned long e = 0; e < sc.numExplorers; e++) {
+                explorers[e] = std::thread(&SwarmClustering::explorePool, std::ref(*(pools.get(r + e))), std::ref(graphs[r + e]),
+                                           std::ref(otus[r + e]), std::ref(arenas[r + e]), std::ref(scd));
+            }
+            for (unsigned long e = 0; e < sc.numExplorers; e++) {
+                explorers[e].join();
+            }
 
-    std::cout << "Creating internal structures output..." << std::endl;
-    for (auto i = 0; i < otus.size(); i++) {
+        }
 
-        otu = otus[i];
+        for (unsigned long e = 0; e < pools.numPools() % sc.numExplorers; e++) {
+            explorers[e] = std::thread(&SwarmClustering::explorePool, std::ref(*(pools.get(r + e))), std::ref(graphs[r + e]),
+                                       std::ref(otus[r + e]), std::ref(arenas[r + e]), std::ref(scd));
+        }
+        for (unsigned long e = 0; e < pools.numPools() % sc.numExplorers; e++) {
+            explorers[e].join();
+        }
+        std::cout << std::endl;
 
-        if (!otu->attached()) {
+        processOtus(pools, otus, scd);
 
-            otuId++;
+    }
 
-            for (auto otuIter = otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
+    return true;
 
-                for (auto memberIter = otuIter->members; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
+}
 
-                    if (otuIter->graftChild == memberIter->member) {
 
-                        lenSeqs_t dist = (sc.useScore) ? Verification::computeGotohLengthAwareEarlyRow(otuIter->graftChild->seq, otuIter->graftChild->len,
-                                                                                                       otuIter->graftParent->member->seq, otuIter->graftParent->member->len,
-                                                                                                       sc.fastidiousThreshold, sc.scoring, D, P, cntDiffs, cntDiffsP)
-                                                       : Verification::computeLengthAwareRow(otuIter->graftChild->seq, otuIter->graftChild->len,
-                                                                                             otuIter->graftParent->member->seq, otuIter->graftParent->member->len,
-                                                                                             sc.fastidiousThreshold, M);
-                        sStream << otuIter->graftParent->member->id << sc.sepInternals << otuIter->graftChild->id << sc.sepInternals << dist
-                                << sc.sepInternals << otuId << sc.sepInternals << (otuIter->graftParent->gen + 1) << std::endl;
+void SwarmClustering::dereplicate(const AmpliconPools& pools, const SwarmConfig& sc) {
 
-                    }
+    struct lessCharArray {
+        bool operator()(const char* lhs, const char* rhs) const {
+            return strcmp(lhs, rhs) < 0;
+        }
+    };
+
+    std::vector<Otu*> otus;
+    OtuArena arena;
 
-                    if (memberIter->gen != 0) {
+    std::cout << "Dereplicating..." << std::endl;
+    for (numSeqs_t p = 0; p < pools.numPools(); p++) {
 
-                        sStream << memberIter->parent->id << sc.sepInternals << memberIter->member->id << sc.sepInternals << memberIter->parentDist
-                                << sc.sepInternals << otuId << sc.sepInternals << memberIter->gen << std::endl;
-                        oStream << sStream.rdbuf();
-                        sStream.str(std::string());
+        AmpliconCollection* ac = pools.get(p);
+        std::map<const char*, std::vector<Amplicon*>, lessCharArray> groups;
 
-                    }
+        for (auto iter = ac->begin(); iter != ac->end(); iter++) {
+            groups[iter->seq].push_back(iter);
+        }
 
-                }
+        for (auto& g : groups) {
+
+            Otu* otu = arena.newOtu(ac->begin());
+
+            for (auto i = 0; i < g.second.size(); i++) {
+
+                arena.addMember(OtuEntry(g.second[i] - ac->begin(), g.second[0] - ac->begin(), 0, 0));
+                otu->mass += g.second[i]->abundance;
 
             }
 
+            arena.closeMembers(*otu);
+            otu->numUniqueSequences = otu->numMembers;
+            otus.push_back(otu);
+
         }
 
     }
+    std::cout << std::endl;
 
-    oStream.close();
+    std::cout << "Sorting OTUs by mass..." << std::endl;
+    std::sort(otus.begin(), otus.end(), CompareOtusMass());
+    outputDereplicate(otus, sc);
+
+    if (sc.outBinary) {
+
+        lenSeqs_t maxLen = 0;
+        for (numSeqs_t p = 0; p < pools.numPools(); p++) {
+            maxLen = std::max(maxLen, pools.get(p)->maxLen());
+        }
+        outputBinary(sc.oFileBinary, otus, maxLen, sc);
+
+    }
+
+    numSeqs_t maxSize = 0;
+    for (auto& o : otus) {
+        maxSize = std::max(maxSize, o->numMembers);
+    }
+
+    std::cout << "Number of swarms: " << otus.size() << std::endl;
+    std::cout << "Largest swarm: " << maxSize << std::endl;
+    std::cout << "Max generations: 0" << std::endl << std::endl;
 
 }
 
-void SwarmClustering::outputOtus(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const char sep, const std::string sepAbundance) {
 
-    std::ofstream oStream(oFile);
-    std::stringstream sStream;
+void SwarmClustering::outputBinary(const std::string oFile, const std::vector<Otu*>& otus, const lenSeqs_t maxLen, const SwarmConfig& sc) {
 
-    Otu* otu = 0;
+    std::vector<ResultOtu> otuRecords;
+    std::vector<ResultMember> memberRecords;
+    std::vector<ResultGraft> graftRecords;
+    std::string strings;
 
-    std::cout << "Creating OTU output..." << std::endl;
-    for (auto i = 0; i < otus.size(); i++) {
+    lenSeqs_t width = maxLen + 1; // the DP rows need one entry more than the longest sequence
+    std::vector<lenSeqs_t> M(sc.useScore ? 1 : width);
+    std::vector<val_t> D(sc.useScore ? width : 1);
+    std::vector<val_t> P(sc.useScore ? width : 1);
+    std::vector<lenSeqs_t> cntDiffs(sc.useScore ? width : 1);
+    std::vector<lenSeqs_t> cntDiffsP(sc.useScore ? width : 1);
 
-        otu = otus[i];
+    std::unordered_map<const Amplicon*, uint64_t> indices; // member records of the amplicons of the current (unattached) OTU
 
-        if (!otu->attached()) {
+    for (auto otu : otus) {
 
-            for (auto otuIter = otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
+        if (otu->attached()) continue;
 
-                if (otuIter != otu) {
-                    sStream << sep;
-                }
+        indices.clear();
 
-                sStream << otuIter->seed()->id << sepAbundance << otuIter->seedAbundance();
+        ResultOtu rec = ResultOtu();
+        rec.firstMember = memberRecords.size();
+        rec.numMembers = otu->numMembers;
+        rec.firstGraft = graftRecords.size();
 
-                for (auto memberIter = otuIter->members + 1; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
-                    sStream << sep << memberIter->member->id << sepAbundance << memberIter->member->abundance;
-                }
+        appendMemberRecords(*otu, memberRecords, strings, indices);
 
-                sStream << std::flush;
-                oStream << sStream.rdbuf();
-                sStream.str(std::string());
+        for (auto otuIter = otu->nextGraftedOtu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
 
-            }
+            ResultGraft graft = ResultGraft();
+            graft.firstMember = memberRecords.size();
+            graft.numMembers = otuIter->numMembers;
+
+            appendMemberRecords(*otuIter, memberRecords, strings, indices);
 
-            oStream << std::endl;
+            graft.parent = indices[otuIter->graftParentAmplicon()];
+            graft.child = indices[otuIter->graftChild];
+            graft.dist = (sc.useScore) ? Verification::computeGotohLengthAwareEarlyRow(otuIter->graftChild->seq, otuIter->graftChild->len,
+                                                                                       otuIter->graftParentAmplicon()->seq, otuIter->graftParentAmplicon()->len,
+                                                                                       sc.fastidiousThreshold, sc.scoring, D.data(), P.data(),
+                                                                                       cntDiffs.data(), cntDiffsP.data())
+                                       : Verification::computeLengthAwareRow(otuIter->graftChild->seq, otuIter->graftChild->len,
+                                                                             otuIter->graftParentAmplicon()->seq, otuIter->graftParentAmplicon()->len,
+                                                                             sc.fastidiousThreshold, M.data());
+            graft.gen = otuIter->graftParent->gen + 1;
+            graftRecords.push_back(graft);
 
         }
 
+        rec.numTotalMembers = memberRecords.size() - rec.firstMember;
+        rec.numGrafts = graftRecords.size() - rec.firstGraft;
+        setOtuStatistics(*otu, rec);
+        otuRecords.push_back(rec);
+
     }
 
+    ResultHeader header = ResultHeader();
+    std::copy(RESULT_MAGIC, RESULT_MAGIC + 4, header.magic);
+    header.flags = (sc.fastidious ? RESULT_FLAG_FASTIDIOUS : 0) | (sc.useScore ? RESULT_FLAG_USE_SCORE : 0)
+                   | (sc.dereplicate ? RESULT_FLAG_DEREPLICATE : 0);
+    header.threshold = sc.threshold;
+    header.fastidiousThreshold = sc.fastidiousThreshold;
+    header.penMismatch = sc.scoring.penMismatch;
+    header.penOpen = sc.scoring.penOpen;
+    header.penExtend = sc.scoring.penExtend;
+    header.numOtus = otuRecords.size();
+    header.numMembers = memberRecords.size();
+    header.numGrafts = graftRecords.size();
+    header.stringTableSize = strings.size();
+    header.otusOffset = sizeof(ResultHeader);
+    header.membersOffset = header.otusOffset + otuRecords.size() * sizeof(ResultOtu);
+    header.graftsOffset = header.membersOffset + memberRecords.size() * sizeof(ResultMember);
+    header.stringsOffset = header.graftsOffset + graftRecords.size() * sizeof(ResultGraft);
+
+    std::ofstream oStream(oFile, std::ios::out | std::ios::binary);
+    oStream.write(reinterpret_cast<const char*>(&header), sizeof(ResultHeader));
+    oStream.write(reinterpret_cast<const char*>(otuRecords.data()), otuRecords.size() * sizeof(ResultOtu));
+    oStream.write(reinterpret_cast<const char*>(memberRecords.data()), memberRecords.size() * sizeof(ResultMember));
+    oStream.write(reinterpret_cast<const char*>(graftRecords.data()), graftRecords.size() * sizeof(ResultGraft));
+    oStream.write(strings.data(), strings.size());
     oStream.close();
 
 }
 
-void SwarmClustering::outputOtusMothur(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const lenSeqs_t threshold,
-                                       const numSeqs_t numOtusAdjusted, const char sep, const std::string sepOtu, const std::string sepAbundance) {
+lenSeqs_t SwarmClustering::rebuildOtus(const std::vector<ResultOtu>& otuRecords, const std::vector<ResultMember>& memberRecords,
+                                       const std::vector<ResultGraft>& graftRecords, std::vector<char>& strings, std::vector<Amplicon>& ampls,
+                                       OtuArena& arena, std::vector<Otu*>& otus) {
 
-    std::ofstream oStream(oFile);
-    std::stringstream sStream;
+    // amplicons are referred to by the index of their member record
+    ampls.resize(memberRecords.size());
+    lenSeqs_t maxLen = 0;
+    for (numSeqs_t i = 0; i < memberRecords.size(); i++) {
 
-    Otu* otu = 0;
+        ampls[i].id = strings.data() + memberRecords[i].id;
+        ampls[i].seq = strings.data() + memberRecords[i].seq;
+        ampls[i].len = memberRecords[i].seqLen;
+        ampls[i].abundance = memberRecords[i].abundance;
+        maxLen = std::max(maxLen, ampls[i].len);
 
-    oStream << "swarm_" << threshold << "\t" << numOtusAdjusted;
+    }
 
-    std::cout << "Creating OTU output..." << std::endl;
-    for (auto i = 0; i < otus.size(); i++) {
+    auto rebuildOtu = [&](const uint64_t first, const uint64_t num) {
+
+        Otu* otu = arena.newOtu(ampls.data());
+        for (auto m = first; m < first + num; m++) {
+            arena.addMember(OtuEntry(m, memberRecords[m].parent, memberRecords[m].parentDist, memberRecords[m].gen));
+        }
+        arena.closeMembers(*otu);
+
+        return otu;
+
+    };
+
+    for (auto& rec : otuRecords) {
+
+        Otu* otu = rebuildOtu(rec.firstMember, rec.numMembers);
+
+        for (auto g = rec.firstGraft; g < rec.firstGraft + rec.numGrafts; g++) {
+
+            auto& graft = graftRecords[g];
+            otu->attach(rebuildOtu(graft.firstMember, graft.numMembers), otu->members + (graft.parent - rec.firstMember),
+                        ampls.data() + graft.child);
+
+        }
+
+        otu->mass = rec.mass;
+        otu->numUniqueSequences = rec.numUniqueSequences;
+        otu->maxRad = rec.maxRad;
+        otus.push_back(otu);
+
+    }
+
+    return maxLen;
+
+}
+
+// read a section of fixed-width records of the binary result file
+template<typename T>
+inline bool readRecords(std::ifstream& iStream, const uint64_t offset, const uint64_t num, const uint64_t fileSize, std::vector<T>& records) {
+
+    if (offset > fileSize || num > (fileSize - offset) / sizeof(T)) return false;
+
+    records.resize(num);
+    iStream.seekg(offset);
+    iStream.read(reinterpret_cast<char*>(records.data()), num * sizeof(T));
+
+    return iStream.good();
+
+}
+
+bool SwarmClustering::convertBinary(const std::string iFile, const SwarmConfig& sc) {
+
+    std::ifstream iStream(iFile, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!iStream.good()) {
+
+        std::cerr << "ERROR: Could not read binary results from " << iFile << "." << std::endl;
+        return false;
+
+    }
+    uint64_t fileSize = iStream.tellg();
+    iStream.seekg(0);
+
+    ResultHeader header;
+    std::vector<ResultOtu> otuRecords;
+    std::vector<ResultMember> memberRecords;
+    std::vector<ResultGraft> graftRecords;
+    std::vector<char> strings;
+
+    std::cout << "Reading binary results..." << std::endl;
+    iStream.read(reinterpret_cast<char*>(&header), sizeof(ResultHeader));
+    bool fits = iStream.good() && std::equal(header.magic, header.magic + 4, RESULT_MAGIC)
+                && (header.numMembers <= std::numeric_limits<numSeqs_t>::max())
+                && readRecords(iStream, header.otusOffset, header.numOtus, fileSize, otuRecords)
+                && readRecords(iStream, header.membersOffset, header.numMembers, fileSize, memberRecords)
+                && readRecords(iStream, header.graftsOffset, header.numGrafts, fileSize, graftRecords)
+                && readRecords(iStream, header.stringsOffset, header.stringTableSize, fileSize, strings);
+    iStream.close();
+
+    // check all references (strings, parents, members and grafts of the OTUs)
+    for (auto iter = memberRecords.begin(); fits && iter != memberRecords.end(); iter++) {
+        fits = (iter->id + iter->idLen < strings.size()) && (strings[iter->id + iter->idLen] == '\0')
+               && (iter->seq + iter->seqLen < strings.size()) && (strings[iter->seq + iter->seqLen] == '\0')
+               && (iter->parent < memberRecords.size());
+    }
+    for (auto iter = otuRecords.begin(); fits && iter != otuRecords.end(); iter++) {
+
+        fits = (iter->numMembers > 0) && (iter->numMembers <= iter->numTotalMembers)
+               && (iter->firstMember + iter->numTotalMembers <= memberRecords.size())
+               && (iter->firstGraft + iter->numGrafts <= graftRecords.size());
+
+        for (auto g = iter->firstGraft; fits && g < iter->firstGraft + iter->numGrafts; g++) {
+
+            auto& graft = graftRecords[g];
+            fits = (graft.numMembers > 0) && (graft.firstMember >= iter->firstMember + iter->numMembers)
+                   && (graft.firstMember + graft.numMembers <= iter->firstMember + iter->numTotalMembers)
+                   && (graft.parent >= iter->firstMember) && (graft.parent < iter->firstMember + iter->numMembers)
+                   && (graft.child >= graft.firstMember) && (graft.child < graft.firstMember + graft.numMembers);
+
+        }
+
+    }
+
+    if (!fits) {
+
+        std::cerr << "ERROR: " << iFile << " is not a valid binary result file." << std::endl;
+        return false;
+
+    }
+
+    std::vector<Amplicon> ampls;
+    OtuArena arena;
+    std::vector<Otu*> otus;
+    lenSeqs_t maxLen = rebuildOtus(otuRecords, memberRecords, graftRecords, strings, ampls, arena, otus);
+    std::cout << std::endl;
+
+    // clustering and scoring parameters of the original run
+    SwarmConfig scc = sc;
+    scc.threshold = header.threshold;
+    scc.fastidiousThreshold = header.fastidiousThreshold;
+    scc.fastidious = (header.flags & RESULT_FLAG_FASTIDIOUS) != 0;
+    scc.useScore = (header.flags & RESULT_FLAG_USE_SCORE) != 0;
+    scc.dereplicate = (header.flags & RESULT_FLAG_DEREPLICATE) != 0;
+    scc.scoring.penMismatch = header.penMismatch;
+    scc.scoring.penOpen = header.penOpen;
+    scc.scoring.penExtend = header.penExtend;
+    scc.outBinary = false;
+
+    if (scc.dereplicate) {
+        outputDereplicate(otus, scc);
+    } else {
+        outputResults(otus, header.numOtus, maxLen, scc);
+    }
+
+    std::cout << "Number of swarms: " << otus.size() << std::endl << std::endl;
+
+    return true;
+
+}
+
+void SwarmClustering::formatInternalStructures(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                                               const numSeqs_t begin, const numSeqs_t end, OutputScratch& scratch, const SwarmConfig& sc,
+                                               const numSeqs_t idOffset) {
+
+    for (auto u = begin; u < end; u++) {
 
-        otu = otus[i];
+        Otu* otu = otus[unattached[u]];
+        numSeqs_t otuId = idOffset + u + 1;
 
-        if (!otu->attached()) {
+        for (auto otuIter = otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
 
-            for (auto otuIter = otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
+            for (auto memberIter = otuIter->members; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
 
-                sStream << ((otuIter == otu) ? sepOtu : std::string(1, sep)) << otuIter->seed()->id << sepAbundance << otuIter->seed()->abundance;
+                if (otuIter->graftChild == otuIter->amplicon(memberIter->member)) {
+
+                    lenSeqs_t dist = (sc.useScore) ? Verification::computeGotohLengthAwareEarlyRow(otuIter->graftChild->seq, otuIter->graftChild->len,
+                                                                                                   otuIter->graftParentAmplicon()->seq, otuIter->graftParentAmplicon()->len,
+                                                                                                   sc.fastidiousThreshold, sc.scoring, scratch.D.data(), scratch.P.data(),
+                                                                                                   scratch.cntDiffs.data(), scratch.cntDiffsP.data())
+                                                   : Verification::computeLengthAwareRow(otuIter->graftChild->seq, otuIter->graftChild->len,
+                                                                                         otuIter->graftParentAmplicon()->seq, otuIter->graftParentAmplicon()->len,
+                                                                                         sc.fastidiousThreshold, scratch.M.data());
+                    buf << otuIter->graftParentAmplicon()->id << sc.sepInternals << otuIter->graftChild->id << sc.sepInternals << dist
+                        << sc.sepInternals << otuId << sc.sepInternals << lenSeqs_t(otuIter->graftParent->gen + 1) << '\n';
 
-                for (auto memberIter = otuIter->members + 1; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
-                    sStream << sep << memberIter->member->id << sepAbundance << memberIter->member->abundance;
                 }
 
-                oStream << sStream.rdbuf();
-                sStream.str(std::string());
+                if (memberIter->gen != 0) {
+                    buf << otuIter->amplicon(memberIter->parent)->id << sc.sepInternals << otuIter->amplicon(memberIter->member)->id
+                        << sc.sepInternals << memberIter->parentDist << sc.sepInternals << otuId << sc.sepInternals << memberIter->gen << '\n';
+                }
 
             }
 
@@ -1220,133 +3343,331 @@ void SwarmClustering::outputOtusMothur(const std::string oFile, const AmpliconPo
 
     }
 
-    oStream << std::endl;
+}
 
-    oStream.close();
+void SwarmClustering::formatOtus(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                                 const numSeqs_t begin, const numSeqs_t end, const char sep, const std::string& sepAbundance) {
+
+    for (auto u = begin; u < end; u++) {
+
+        Otu* otu = otus[unattached[u]];
+
+        for (auto otuIter = otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
+
+            if (otuIter != otu) {
+                buf << sep;
+            }
+
+            buf << otuIter->seed()->id << sepAbundance << otuIter->seedAbundance();
+
+            for (auto memberIter = otuIter->members + 1; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
+                buf << sep << otuIter->amplicon(memberIter->member)->id << sepAbundance << otuIter->amplicon(memberIter->member)->abundance;
+            }
+
+        }
+
+        buf << '\n';
+
+    }
 
 }
 
-void SwarmClustering::outputStatistics(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const char sep) {
+void SwarmClustering::formatOtusMothur(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                                       const numSeqs_t begin, const numSeqs_t end, const char sep, const std::string& sepOtu, const std::string& sepAbundance) {
 
-    std::ofstream oStream(oFile);
-    std::stringstream sStream;
+    for (auto u = begin; u < end; u++) {
 
-    Otu* otu = 0;
+        Otu* otu = otus[unattached[u]];
 
-    std::cout << "Creating statistics output..." << std::endl;
-    for (auto i = 0; i < otus.size(); i++) {
+        for (auto otuIter = otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
 
-        otu = otus[i];
+            if (otuIter == otu) {
+                buf << sepOtu;
+            } else {
+                buf << sep;
+            }
 
-        if (!otu->attached()) {
+            buf << otuIter->seed()->id << sepAbundance << otuIter->seed()->abundance;
 
-            auto maxGenRad = otu->maxGenRad();
-            sStream << otu->numUniqueSequences << sep << otu->mass << sep << otu->seed()->id << sep << otu->seedAbundance()
-                    << sep << otu->numTotalSingletons() << sep << maxGenRad.first << sep << maxGenRad.second << std::endl;
-            oStream << sStream.rdbuf();
-            sStream.str(std::string());
+            for (auto memberIter = otuIter->members + 1; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
+                buf << sep << otuIter->amplicon(memberIter->member)->id << sepAbundance << otuIter->amplicon(memberIter->member)->abundance;
+            }
 
         }
 
     }
 
-    oStream.close();
+}
+
+void SwarmClustering::formatStatistics(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                                       const numSeqs_t begin, const numSeqs_t end, const char sep) {
+
+    for (auto u = begin; u < end; u++) {
+
+        Otu* otu = otus[unattached[u]];
+
+        auto maxGenRad = otu->maxGenRad();
+        buf << otu->numUniqueSequences << sep << otu->mass << sep << otu->seed()->id << sep << otu->seedAbundance()
+            << sep << otu->numTotalSingletons() << sep << maxGenRad.first << sep << maxGenRad.second << '\n';
+
+    }
 
 }
 
-void SwarmClustering::outputSeeds(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const std::string sepAbundance) {
+void SwarmClustering::formatSeeds(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                                  const numSeqs_t begin, const numSeqs_t end, const std::string& sepAbundance) {
 
-    std::ofstream oStream(oFile);
-    std::stringstream sStream;
+    for (auto u = begin; u < end; u++) {
 
-    Otu* otu = 0;
+        Otu* otu = otus[unattached[u]];
 
-    std::cout << "Creating seeds output..." << std::endl;
-    for (auto i = 0; i < otus.size(); i++) {
+        buf << '>' << otu->seed()->id << sepAbundance << otu->mass << '\n' << otu->seed()->seq << '\n';
+
+    }
+
+}
+
+void SwarmClustering::computeRadii(const Otu& otu, std::unordered_map<numSeqs_t, lenSeqs_t>& rads) {
+
+    rads.clear();
+    rads[otu.members[0].member] = 0;
+
+    // members are stored in the order of their generations, i.e. parents precede their children
+    for (auto memberIter = otu.members + 1; memberIter != otu.members + otu.numMembers; memberIter++) {
+        rads[memberIter->member] = rads[memberIter->parent] + memberIter->parentDist;
+    }
+
+}
 
-        otu = otus[i];
+void SwarmClustering::formatUclustOtu(OutputBuffer& buf, const Otu& otu, const numSeqs_t otuId, OutputScratch& scratch, const SwarmConfig& sc) {
 
-        if (!otu->attached()) {
+    auto& seed = *otu.seed();
 
-            sStream << ">" << otu->seed()->id << sepAbundance << otu->mass << std::endl << otu->seed()->seq << std::endl;
-            oStream << sStream.rdbuf();
-            sStream.str(std::string());
+    buf << 'C' << sc.sepUclust << otuId << sc.sepUclust << otu.numTotalMembers() << sc.sepUclust << '*' << sc.sepUclust << '*'
+        << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust
+        << seed.id << sc.sepAbundance << seed.abundance << sc.sepUclust << '*' << '\n';
+    buf << 'S' << sc.sepUclust << otuId << sc.sepUclust << seed.len << sc.sepUclust << '*' << sc.sepUclust << '*'
+        << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust
+        << seed.id << sc.sepAbundance << seed.abundance << sc.sepUclust << '*' << '\n';
+
+    std::unordered_map<numSeqs_t, lenSeqs_t> seedRads, rads;
+    computeRadii(otu, seedRads);
+
+    for (auto otuIter = &otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
+
+        // bound on the distance of the members of a grafted OTU to the seed:
+        // path to the grafting parent + grafting link + path from the grafting child to the member (via the seed of the grafted OTU)
+        lenSeqs_t offset = 0;
+        if (otuIter != &otu) {
+
+            computeRadii(*otuIter, rads);
+            offset = seedRads[otuIter->graftParent->member] + sc.fastidiousThreshold + rads[otuIter->graftChild - otuIter->ampls];
+
+        }
+        auto& memberRads = (otuIter == &otu) ? seedRads : rads;
+
+        for (auto memberIter = otuIter->members + 1; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
+
+            auto& member = *otuIter->amplicon(memberIter->member);
+            auto ai = Verification::computeGotohCigarBanded(seed.seq, seed.len, member.seq, member.len, sc.scoring,
+                                                            offset + memberRads[memberIter->member], scratch.D, scratch.P, scratch.BT);
+
+            buf << 'H' << sc.sepUclust << otuId << sc.sepUclust << member.len << sc.sepUclust;
+            buf.appendFixed1(100.0 * (ai.length - ai.numDiffs) / ai.length);
+            buf << sc.sepUclust << '+' << sc.sepUclust << '0' << sc.sepUclust << '0' << sc.sepUclust;
+            if (ai.numDiffs == 0) {
+                buf << '=';
+            } else {
+                buf << ai.cigar;
+            }
+            buf << sc.sepUclust << member.id << sc.sepAbundance << member.abundance << sc.sepUclust
+                << seed.id << sc.sepAbundance << seed.abundance << '\n';
 
         }
 
     }
 
-    oStream.close();
+}
+
+void SwarmClustering::formatUclust(OutputBuffer& buf, const std::vector<Otu*>& otus, const std::vector<numSeqs_t>& unattached,
+                                   const numSeqs_t begin, const numSeqs_t end, OutputScratch& scratch, const SwarmConfig& sc,
+                                   const numSeqs_t idOffset) {
+
+    for (auto u = begin; u < end; u++) {
+        formatUclustOtu(buf, *otus[unattached[u]], idOffset + u, scratch, sc);
+    }
 
 }
 
-void SwarmClustering::outputUclust(const std::string oFile, const AmpliconPools& pools, const std::vector<Otu*>& otus, const SwarmConfig& sc) {
+void SwarmClustering::outputResults(const std::vector<Otu*>& otus, const numSeqs_t numOtusAdjusted, const lenSeqs_t maxLen, const SwarmConfig& sc) {
 
-    std::ofstream oStream(oFile);
-    std::stringstream sStream;
-    sStream << std::fixed << std::setprecision(1);
+    enum OutputKind {
+        OUTPUT_INTERNALS, OUTPUT_OTUS, OUTPUT_STATISTICS, OUTPUT_SEEDS, OUTPUT_UCLUST
+    };
 
-    AmpliconCollection* ac = 0;
-    Otu* otu = 0;
-    numSeqs_t otuId = 0;
+    std::vector<std::pair<OutputKind, std::string>> outputs;
+    if (sc.outInternals) outputs.emplace_back(OUTPUT_INTERNALS, sc.oFileInternals);
+    if (sc.outOtus) outputs.emplace_back(OUTPUT_OTUS, sc.oFileOtus);
+    if (sc.outStatistics) outputs.emplace_back(OUTPUT_STATISTICS, sc.oFileStatistics);
+    if (sc.outSeeds) outputs.emplace_back(OUTPUT_SEEDS, sc.oFileSeeds);
+    if (sc.outUclust) outputs.emplace_back(OUTPUT_UCLUST, sc.oFileUclust);
+
+    if (outputs.empty() && !sc.outBinary) return;
+
+    std::cout << "Creating outputs..." << std::endl;
+
+    std::thread binaryWriter;
+    if (sc.outBinary) binaryWriter = std::thread(outputBinary, sc.oFileBinary, std::cref(otus), maxLen, std::cref(sc));
+
+    if (outputs.empty()) {
+
+        binaryWriter.join();
+        return;
 
-    ac = pools.get(pools.numPools() - 1);
-    lenSeqs_t maxLen = 0;
-    for (auto iter = ac->begin(); iter != ac->end(); iter++) {
-        maxLen = std::max(maxLen, iter->len);
     }
-    val_t D[maxLen + 1];
-    val_t P[maxLen + 1];
-    char BT[(maxLen + 1) * (maxLen + 1)];
 
-    std::cout << "Creating UCLUST output..." << std::endl;
-    for (auto i = 0; i < otus.size(); i++) {
+    // OTU ids are assigned to the unattached OTUs only
+    std::vector<numSeqs_t> unattached;
+    for (numSeqs_t i = 0; i < otus.size(); i++) {
+        if (!otus[i]->attached()) unattached.push_back(i);
+    }
 
-        otu = otus[i];
+    lenSeqs_t width = maxLen + 1; // the DP rows need one entry more than the longest sequence
 
-        if (!otu->attached()) {
+    const numSeqs_t numOutputs = outputs.size();
+    const numSeqs_t chunkSize = 256; // OTUs per chunk
+    const numSeqs_t numChunks = (unattached.size() + chunkSize - 1) / chunkSize;
+    const numSeqs_t numParts = numChunks * numOutputs; // part p = chunk (p / numOutputs) of output (p % numOutputs)
+    const numSeqs_t window = 4 * sc.numWriters; // maximum number of chunks formatted ahead of the slowest file
 
-            auto& seed = *otu->seed();
+    std::vector<OutputBuffer> parts(numParts, OutputBuffer(0));
+    std::vector<bool> complete(numParts, false);
+    std::vector<numSeqs_t> written(numOutputs, 0); // number of chunks already written per output
+    numSeqs_t nextPart = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
 
-            sStream << 'C' << sc.sepUclust << otuId << sc.sepUclust << otu->numTotalMembers() << sc.sepUclust << '*' << sc.sepUclust << '*'
-                    << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust
-                    << seed.id << sc.sepAbundance << seed.abundance << sc.sepUclust << '*' << '\n';
-            sStream << 'S' << sc.sepUclust << otuId << sc.sepUclust << seed.len << sc.sepUclust << '*' << sc.sepUclust << '*'
-                    << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust << '*' << sc.sepUclust
-                    << seed.id << sc.sepAbundance << seed.abundance << sc.sepUclust << '*' << '\n';
-            oStream << sStream.rdbuf();
-            sStream.str(std::string());
+    auto formatParts = [&]() {
 
-            for (auto otuIter = otu; otuIter != 0; otuIter = otuIter->nextGraftedOtu) {
+        OutputScratch scratch;
+        if (sc.outInternals) {
+
+            scratch.M.resize(sc.useScore ? 1 : width);
+            scratch.D.resize(sc.useScore ? width : 1);
+            scratch.P.resize(sc.useScore ? width : 1);
+            scratch.cntDiffs.resize(sc.useScore ? width : 1);
+            scratch.cntDiffsP.resize(sc.useScore ? width : 1);
 
-                for (auto memberIter = otuIter->members + 1; memberIter != otuIter->members + otuIter->numMembers; memberIter++) {
+        }
 
-                    auto& member = *memberIter->member;
-                    auto ai = Verification::computeGotohCigarRow1(seed.seq, seed.len, member.seq, member.len, sc.scoring, D, P, BT);
+        OutputBuffer buf;
 
-                    sStream << 'H' << sc.sepUclust << otuId << sc.sepUclust << member.len << sc.sepUclust << (100.0 * (ai.length - ai.numDiffs) / ai.length)
-                            << sc.sepUclust << '+' << sc.sepUclust << '0' << sc.sepUclust << '0' << sc.sepUclust
-                            << ((ai.numDiffs == 0) ? "=" : ai.cigar) << sc.sepUclust
-                            << member.id << sc.sepAbundance << member.abundance << sc.sepUclust
-                            << seed.id << sc.sepAbundance << seed.abundance << '\n';
-                    oStream << sStream.rdbuf();
-                    sStream.str(std::string());
+        while (true) {
 
-                }
+            numSeqs_t p;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&]() {
+                    return nextPart >= numParts || nextPart / numOutputs < *std::min_element(written.begin(), written.end()) + window;
+                });
+                if (nextPart >= numParts) break;
+                p = nextPart++;
+            }
+
+            numSeqs_t begin = (p / numOutputs) * chunkSize;
+            numSeqs_t end = std::min(numSeqs_t(unattached.size()), begin + chunkSize);
+
+            switch (outputs[p % numOutputs].first) {
+
+                case OUTPUT_INTERNALS:
+                    formatInternalStructures(buf, otus, unattached, begin, end, scratch, sc);
+                    break;
+
+                case OUTPUT_OTUS:
+                    (sc.outMothur) ?
+                      formatOtusMothur(buf, otus, unattached, begin, end, sc.sepMothur, sc.sepMothurOtu, sc.sepAbundance)
+                    : formatOtus(buf, otus, unattached, begin, end, sc.sepOtus, sc.sepAbundance);
+                    break;
+
+                case OUTPUT_STATISTICS:
+                    formatStatistics(buf, otus, unattached, begin, end, sc.sepStatistics);
+                    break;
+
+                case OUTPUT_SEEDS:
+                    formatSeeds(buf, otus, unattached, begin, end, sc.sepAbundance);
+                    break;
+
+                case OUTPUT_UCLUST:
+                    formatUclust(buf, otus, unattached, begin, end, scratch, sc);
+                    break;
+
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                parts[p].swap(buf);
+                complete[p] = true;
+            }
+            cv.notify_all();
+
+        }
+
+    };
+
+    auto writeOutput = [&](const numSeqs_t o) {
+
+        std::ofstream oStream(outputs[o].second);
+        bool mothur = (outputs[o].first == OUTPUT_OTUS) && sc.outMothur;
+
+        if (mothur) oStream << "swarm_" << sc.threshold << "\t" << numOtusAdjusted;
 
+        OutputBuffer buf(0);
+        for (numSeqs_t c = 0; c < numChunks; c++) {
+
+            numSeqs_t p = c * numOutputs + o;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&]() {
+                    return complete[p];
+                });
+                buf.swap(parts[p]);
+                written[o] = c + 1;
             }
+            cv.notify_all();
 
-            otuId++;
+            oStream.write(buf.data(), buf.size());
+            OutputBuffer(0).swap(buf);
 
         }
 
+        if (mothur) oStream << std::endl;
+
+        oStream.close();
+
+    };
+
+    std::thread formatters[sc.numWriters];
+    for (unsigned long f = 0; f < sc.numWriters; f++) {
+        formatters[f] = std::thread(formatParts);
     }
 
-    oStream.close();
+    std::thread writers[numOutputs];
+    for (numSeqs_t o = 0; o < numOutputs; o++) {
+        writers[o] = std::thread(writeOutput, o);
+    }
+
+    for (numSeqs_t o = 0; o < numOutputs; o++) {
+        writers[o].join();
+    }
+    for (unsigned long f = 0; f < sc.numWriters; f++) {
+        formatters[f].join();
+    }
+
+    if (sc.outBinary) binaryWriter.join();
 
 }
 
-void SwarmClustering::outputDereplicate(const AmpliconPools& pools, const std::vector<Otu*>& otus, const SwarmConfig& sc) {
+void SwarmClustering::outputDereplicate(const std::vector<Otu*>& otus, const SwarmConfig& sc) {
 
     std::ofstream oStreamInternals, oStreamOtus, oStreamStatistics, oStreamSeeds, oStreamUclust;
     std::stringstream sStreamInternals, sStreamOtus, sStreamStatistics, sStreamSeeds, sStreamUclust;
@@ -1369,7 +3690,7 @@ void SwarmClustering::outputDereplicate(const AmpliconPools& pools, const std::v
 
             for (auto memberIter = otu.members + 1; memberIter != otu.members + otu.numMembers; memberIter++) {
 
-                sStreamInternals << otu.seed()->id << sc.sepInternals << memberIter->member->id << sc.sepInternals << 0
+                sStreamInternals << otu.seed()->id << sc.sepInternals << otu.amplicon(memberIter->member)->id << sc.sepInternals << 0
                                  << sc.sepInternals << (i + 1) << sc.sepInternals << 0 << std::endl;
                 oStreamInternals << sStreamInternals.rdbuf();
                 sStreamInternals.str(std::string());
@@ -1385,7 +3706,7 @@ void SwarmClustering::outputDereplicate(const AmpliconPools& pools, const std::v
                 sStreamOtus << sc.sepMothurOtu << otu.seed()->id << sc.sepAbundance << otu.seedAbundance();
 
                 for (auto memberIter = otu.members + 1; memberIter != otu.members + otu.numMembers; memberIter++) {
-                    sStreamOtus << sc.sepMothur << memberIter->member->id << sc.sepAbundance << memberIter->member->abundance;
+                    sStreamOtus << sc.sepMothur << otu.amplicon(memberIter->member)->id << sc.sepAbundance << otu.amplicon(memberIter->member)->abundance;
                 }
 
                 oStreamOtus << sStreamOtus.rdbuf();
@@ -1396,7 +3717,7 @@ void SwarmClustering::outputDereplicate(const AmpliconPools& pools, const std::v
                 sStreamOtus << otu.seed()->id << sc.sepAbundance << otu.seedAbundance();
 
                 for (auto memberIter = otu.members + 1; memberIter != otu.members + otu.numMembers; memberIter++) {
-                    sStreamOtus << sc.sepOtus << memberIter->member->id << sc.sepAbundance << memberIter->member->abundance;
+                    sStreamOtus << sc.sepOtus << otu.amplicon(memberIter->member)->id << sc.sepAbundance << otu.amplicon(memberIter->member)->abundance;
                 }
 
                 sStreamOtus << std::endl;
@@ -1440,9 +3761,9 @@ void SwarmClustering::outputDereplicate(const AmpliconPools& pools, const std::v
 
             for (auto memberIter = otu.members + 1; memberIter != otu.members + otu.numMembers; memberIter++) {
 
-                sStreamUclust << 'H' << sc.sepUclust << i << sc.sepUclust << memberIter->member->len << sc.sepUclust << "100.0"
+                sStreamUclust << 'H' << sc.sepUclust << i << sc.sepUclust << otu.amplicon(memberIter->member)->len << sc.sepUclust << "100.0"
                               << sc.sepUclust << '+' << sc.sepUclust << '0' << sc.sepUclust << '0' << sc.sepUclust << '=' << sc.sepUclust
-                              << memberIter->member->id << sc.sepAbundance << memberIter->member->abundance << sc.sepUclust
+                              << otu.amplicon(memberIter->member)->id << sc.sepAbundance << otu.amplicon(memberIter->member)->abundance << sc.sepUclust
                               << seed.id << sc.sepAbundance << seed.abundance << '\n';
 
                 oStreamUclust << sStreamUclust.rdbuf() << std::flush;
@@ -33,7 +33,7 @@ void SegmentFilter::addCandCnts(const Amplicon& amplicon, lenSeqs_t childLen, le
     StringIteratorPair sip;
     for (lenSeqs_t i = 0; i < numSegments; i++) {
 
-        const Substrings& subs = substrsArchive[amplicon.len][childLen][i];
+        const Substrings& subs = substrsArchive.at(amplicon.len).at(childLen)[i]; // at() keeps concurrent lookups read-only
         SwarmingInvertedIndex& inv = indices.getIndex(childLen, i);
         sip.first = amplicon.seq + subs.first;
         sip.second = sip.first + subs.len;
@@ -285,6 +285,7 @@ std::vector<std::pair<numSeqs_t, lenSeqs_t>> SegmentFilter::ChildrenFinder::getC
         candCnts.clear();
 
         SegmentFilter::addCandCnts(amplicon, childLen, sc_.threshold + sc_.extraSegs, candCnts, indices_, substrsArchive_);
+        if (candCnts.empty()) continue; // also avoids creating empty archive entries for non-occurring lengths
         SegmentFilter::verifyCandsTwoWay(amplicon, segmentStrs, ac_, candCnts, substrsArchive_[childLen][amplicon.len],
                                          matches, sc_, M_, D_, P_, cntDiffs_, cntDiffsP_);
 
@@ -316,6 +317,7 @@ void SegmentFilter::ChildrenFinder::getChildrenTwoWay(const numSeqs_t id, std::v
         candCnts.clear();
 
         SegmentFilter::addCandCnts(amplicon, childLen, sc_.threshold + sc_.extraSegs, candCnts, indices_, substrsArchive_);
+        if (candCnts.empty()) continue; // also avoids creating empty archive entries for non-occurring lengths
         SegmentFilter::verifyCandsTwoWay(amplicon, segmentStrs, ac_, candCnts, substrsArchive_[childLen][amplicon.len],
                                          children, sc_, M_, D_, P_, cntDiffs_, cntDiffsP_);
 
@@ -1002,7 +1004,8 @@ void SegmentFilter::prepareIndices(const AmpliconCollection& ac, SwarmingIndices
 }
 #endif
 
-void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, const SwarmClustering::SwarmConfig& sc) {
+void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                                const SwarmClustering::SwarmConfig& sc) {
 
     SwarmingIndices indices(sc.threshold + 1, sc.threshold + sc.extraSegs, true, false);
     std::unordered_map<lenSeqs_t, std::unordered_map<lenSeqs_t, std::vector<Substrings>>> substrsArchive;
@@ -1011,10 +1014,11 @@ void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmC
 
     // determine order of amplicons based on abundance (descending) without invalidating the integer (position) ids of the amplicons
     SwarmClustering::Otu* curOtu = 0;
-    std::vector<SwarmClustering::OtuEntryPrecursor> tmpMembers;
+    std::vector<SwarmClustering::OtuEntry> sortBuffer;
     std::vector<bool> visited(ac.size(), false); // visited amplicons are already included in an OTU
+    std::vector<lenSeqs_t> rads(ac.size(), 0); // radius of the amplicons (accumulated differences to their OTU seed)
 
-    SwarmClustering::OtuEntryPrecursor curSeed, newSeed;
+    SwarmClustering::OtuEntry curSeed, newSeed;
     bool unique;
     std::unordered_set<StringIteratorPair, hashStringIteratorPair, equalStringIteratorPair> uniqueSeqs;
     std::vector<std::pair<numSeqs_t, lenSeqs_t>> next;
@@ -1032,17 +1036,16 @@ void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmC
         if (!visited[seedIter]) {
 
             /* (a) Initialise new OTU with seed */
-            curOtu = new SwarmClustering::Otu();
+            curOtu = arena.newOtu(begin);
 
-            newSeed.member = seed;
+            newSeed.member = seedIter;
             newSeed.parent = newSeed.member;
             newSeed.parentDist = 0;
             newSeed.gen = 0;
-            newSeed.rad = 0;
-            tmpMembers.push_back(newSeed);
+            arena.addMember(newSeed);
 
             visited[seedIter] = true;
-            uniqueSeqs.insert(StringIteratorPair(newSeed.member->seq, newSeed.member->seq + newSeed.member->len));
+            uniqueSeqs.insert(StringIteratorPair(seed->seq, seed->seq + seed->len));
 #if SUCCINCT
             indices.getIndicesRow(ac[seedIter].len).shared.remove(seedIter);
 #else
@@ -1059,30 +1062,31 @@ void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmC
 
             /* (b) BFS through 'match space' */
             pos = 0;
-            while (pos < tmpMembers.size()) { // expand current OTU until no further similar amplicons can be added
+            while (pos < arena.numOpenMembers()) { // expand current OTU until no further similar amplicons can be added
 
-                if (lastGen != tmpMembers[pos].gen) { // work through generation by decreasing abundance
+                if (lastGen != arena.openMembers()[pos].gen) { // work through generation by decreasing abundance
 
                     uniqueSeqs.clear();
-                    std::sort(tmpMembers.begin() + pos, tmpMembers.end(), SwarmClustering::CompareOtuEntryPrecursorsAbund());
+                    SwarmClustering::sortGeneration(arena.openMembers() + pos, arena.openMembers() + arena.numOpenMembers(), sortBuffer,
+                                                    [](const SwarmClustering::OtuEntry& e) {return e.member;});
 
                 }
 
                 // get next OTU (sub)seed
-                curSeed = tmpMembers[pos];
+                curSeed = arena.openMembers()[pos];
 
                 // unique sequences contribute when they occur, non-unique sequences only at their first occurrence
                 unique = (curSeed.parentDist != 0) &&
-                        uniqueSeqs.insert(StringIteratorPair(curSeed.member->seq, curSeed.member->seq + curSeed.member->len)).second;
+                        uniqueSeqs.insert(StringIteratorPair(ac[curSeed.member].seq, ac[curSeed.member].seq + ac[curSeed.member].len)).second;
 
                 // update OTU information
-                curOtu->mass += curSeed.member->abundance;
+                curOtu->mass += ac[curSeed.member].abundance;
 
                 // Consider yet unseen (unvisited) amplicons to continue the exploration.
                 // An amplicon is marked as 'visited' as soon as it occurs the first time as matching partner
                 // in order to prevent the algorithm from queueing it more than once coming from different amplicons.
-                next = sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member - begin) : cf.getChildren(curSeed.member - begin);
-//                sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member - begin, next) : cf.getChildren(curSeed.member - begin, next);
+                next = sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member) : cf.getChildren(curSeed.member);
+//                sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member, next) : cf.getChildren(curSeed.member, next);
 
                 for (auto matchIter = next.begin(); matchIter != next.end(); matchIter++) {
 
@@ -1090,14 +1094,16 @@ void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmC
 
                     if (!visited[matchIter->first]) {
 
-                        newSeed.member = begin + matchIter->first;
+                        newSeed.member = matchIter->first;
                         newSeed.parent = curSeed.member;
                         newSeed.parentDist = matchIter->second;
                         newSeed.gen = curSeed.gen + 1;
-                        newSeed.rad = curSeed.rad + matchIter->second;
-                        tmpMembers.push_back(newSeed);
+                        arena.addMember(newSeed);
                         visited[matchIter->first] = true;
 
+                        rads[matchIter->first] = rads[curSeed.member] + matchIter->second;
+                        curOtu->maxRad = std::max(curOtu->maxRad, rads[matchIter->first]);
+
 #if SUCCINCT
                         indices.getIndicesRow(ac[matchIter->first].len).shared.remove(matchIter->first);
 #else
@@ -1120,8 +1126,7 @@ void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmC
 
             /* (c) Close the no longer extendable OTU */
             uniqueSeqs.clear();
-            curOtu->setMembers(tmpMembers);
-            std::vector<SwarmClustering::OtuEntryPrecursor>().swap(tmpMembers);
+            arena.closeMembers(*curOtu);
             otus.push_back(curOtu);
 
         }
@@ -1130,7 +1135,8 @@ void SegmentFilter::swarmFilter(const AmpliconCollection& ac, std::vector<SwarmC
 
 }
 
-void SegmentFilter::swarmFilterDirectly(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, const SwarmClustering::SwarmConfig& sc) {
+void SegmentFilter::swarmFilterDirectly(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                                        const SwarmClustering::SwarmConfig& sc) {
 
     SwarmingIndices indices(sc.threshold + 1, sc.threshold + sc.extraSegs, true, false);
     std::unordered_map<lenSeqs_t, std::unordered_map<lenSeqs_t, std::vector<Substrings>>> substrsArchive;
@@ -1139,10 +1145,11 @@ void SegmentFilter::swarmFilterDirectly(const AmpliconCollection& ac, std::vecto
 
     // determine order of amplicons based on abundance (descending) without invalidating the integer (position) ids of the amplicons
     SwarmClustering::Otu* curOtu = 0;
-    std::vector<SwarmClustering::OtuEntryPrecursor> tmpMembers;
+    std::vector<SwarmClustering::OtuEntry> sortBuffer;
     std::vector<bool> visited(ac.size(), false); // visited amplicons are already included in an OTU
+    std::vector<lenSeqs_t> rads(ac.size(), 0); // radius of the amplicons (accumulated differences to their OTU seed)
 
-    SwarmClustering::OtuEntryPrecursor curSeed, newSeed;
+    SwarmClustering::OtuEntry curSeed, newSeed;
     bool unique;
     std::unordered_set<StringIteratorPair, hashStringIteratorPair, equalStringIteratorPair> uniqueSeqs;
     std::vector<std::pair<numSeqs_t, lenSeqs_t>> next;
@@ -1158,6 +1165,11 @@ void SegmentFilter::swarmFilterDirectly(const AmpliconCollection& ac, std::vecto
     ChildrenFinder cf(ac, indices, substrsArchive, sc, M, D, P, cntDiffs, cntDiffsP);
 #endif
 
+    // Amplicons with the same sequence (same sequence-identity group) have the same candidates and distances.
+    // Once a group member with abundance x has been expanded, all its children are visited. A later member with
+    // abundance <= x (or any later member without OTU breaking) cannot find further children, so its expansion is skipped.
+    std::vector<numSeqs_t> groupExpanded(ac.size(), 0); // highest abundance with which a member of the group was expanded (0 = none)
+
     // open new OTU for the amplicon with the highest abundance that is not yet included in an OTU
     const Amplicon* begin = ac.begin();
     const Amplicon* seed = begin;
@@ -1166,17 +1178,16 @@ void SegmentFilter::swarmFilterDirectly(const AmpliconCollection& ac, std::vecto
         if (!visited[seedIter]) {
 
             /* (a) Initialise new OTU with seed */
-            curOtu = new SwarmClustering::Otu();
+            curOtu = arena.newOtu(begin);
 
-            newSeed.member = seed;
+            newSeed.member = seedIter;
             newSeed.parent = newSeed.member;
             newSeed.parentDist = 0;
             newSeed.gen = 0;
-            newSeed.rad = 0;
-            tmpMembers.push_back(newSeed);
+            arena.addMember(newSeed);
 
             visited[seedIter] = true;
-            uniqueSeqs.insert(StringIteratorPair(newSeed.member->seq, newSeed.member->seq + newSeed.member->len));
+            uniqueSeqs.insert(StringIteratorPair(seed->seq, seed->seq + seed->len));
 #if SUCCINCT
             indices.getIndicesRow(ac[seedIter].len).shared.remove(seedIter);
 #else
@@ -1194,52 +1205,589 @@ void SegmentFilter::swarmFilterDirectly(const AmpliconCollection& ac, std::vecto
 
             /* (b) BFS through 'match space' */
             pos = 0;
-            while (pos < tmpMembers.size()) { // expand current OTU until no further similar amplicons can be added
+            while (pos < arena.numOpenMembers()) { // expand current OTU until no further similar amplicons can be added
 
-                if (lastGen != tmpMembers[pos].gen) { // work through generation by decreasing abundance
+                if (lastGen != arena.openMembers()[pos].gen) { // work through generation by decreasing abundance
 
                     uniqueSeqs.clear();
-                    std::sort(tmpMembers.begin() + pos, tmpMembers.end(), SwarmClustering::CompareOtuEntryPrecursorsAbund());
+                    SwarmClustering::sortGeneration(arena.openMembers() + pos, arena.openMembers() + arena.numOpenMembers(), sortBuffer,
+                                                    [](const SwarmClustering::OtuEntry& e) {return e.member;});
 
                 }
 
                 // get next OTU (sub)seed
-                curSeed = tmpMembers[pos];
+                curSeed = arena.openMembers()[pos];
 
                 // unique sequences contribute when they occur, non-unique sequences only at their first occurrence
                 unique = (curSeed.parentDist != 0) &&
-                        uniqueSeqs.insert(StringIteratorPair(curSeed.member->seq, curSeed.member->seq + curSeed.member->len)).second;
+                        uniqueSeqs.insert(StringIteratorPair(ac[curSeed.member].seq, ac[curSeed.member].seq + ac[curSeed.member].len)).second;
 
                 // update OTU information
-                curOtu->mass += curSeed.member->abundance;
+                curOtu->mass += ac[curSeed.member].abundance;
 
                 // Consider yet unseen (unvisited) amplicons to continue the exploration.
                 // An amplicon is marked as 'visited' as soon as it occurs the first time as matching partner
                 // in order to prevent the algorithm from queueing it more than once coming from different amplicons.
+                numSeqs_t& expanded = groupExpanded[ac.seqGroup(curSeed.member)];
+
+                if (expanded > 0 && (sc.noOtuBreaking || ac[curSeed.member].abundance <= expanded)) {
+
+                    next.clear(); // all children were already added when expanding an identical sequence
+
+                } else {
+
 #if CHILDREN_FINDER
-                next = sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member - begin) : cf.getChildren(curSeed.member - begin);
-//                sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member - begin, next) : cf.getChildren(curSeed.member - begin, next);
+                    next = sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member) : cf.getChildren(curSeed.member);
+//                    sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member, next) : cf.getChildren(curSeed.member, next);
+#else
+                    next = sc.filterTwoWay ?
+                              getChildrenTwoWay(curSeed.member, next, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc)
+                            : getChildren(curSeed.member, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc);
+//                            sc.filterTwoWay ? getChildrenTwoWay(curSeed.member, next, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc)
+//                          : getChildren(curSeed.member, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc);
+#endif
+
+                    expanded = ac[curSeed.member].abundance;
+
+                }
+
+                for (auto matchIter = next.begin(); matchIter != next.end(); matchIter++) {
+
+                    unique &= (matchIter->second != 0);
+
+                    if (!visited[matchIter->first]) {
+
+                        newSeed.member = matchIter->first;
+                        newSeed.parent = curSeed.member;
+                        newSeed.parentDist = matchIter->second;
+                        newSeed.gen = curSeed.gen + 1;
+                        arena.addMember(newSeed);
+                        visited[matchIter->first] = true;
+
+                        rads[matchIter->first] = rads[curSeed.member] + matchIter->second;
+                        curOtu->maxRad = std::max(curOtu->maxRad, rads[matchIter->first]);
+
+#if SUCCINCT
+                        indices.getIndicesRow(ac[matchIter->first].len).shared.remove(matchIter->first);
 #else
-                next = sc.filterTwoWay ?
-                          getChildrenTwoWay(curSeed.member - begin, next, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc)
-                        : getChildren(curSeed.member - begin, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc);
-//                        sc.filterTwoWay ? getChildrenTwoWay(curSeed.member - begin, next, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc)
-//                      : getChildren(curSeed.member - begin, ac, indices, substrsArchive, M, D, P, cntDiffs, cntDiffsP, sc);
+                        auto& invs = indices.getIndicesRow(ac[matchIter->first].len);
+                        for (auto i = 0; i < sc.threshold + sc.extraSegs; i++) {
+                            invs[i].removeLabel(matchIter->first);
+                        }
 #endif
+
+                    }
+
+                }
+
+                curOtu->numUniqueSequences += unique || (curSeed.gen == 0);
+
+                lastGen = curSeed.gen;
+                pos++;
+
+            }
+
+            /* (c) Close the no longer extendable OTU */
+            uniqueSeqs.clear();
+            arena.closeMembers(*curOtu);
+            otus.push_back(curOtu);
+
+        }
+
+    }
+
+}
+
+void SegmentFilter::getChildrenMicrovariants(const numSeqs_t id, std::vector<std::pair<numSeqs_t, lenSeqs_t>>& children, const AmpliconCollection& ac,
+                                             const Microvariants::SequenceTable& table, Microvariants::MicrovariantGenerator& gen,
+                                             std::vector<numSeqs_t>& labels, std::vector<char>& buf, const std::vector<bool>& visited,
+                                             const SwarmClustering::SwarmConfig& sc) {
+
+    auto& amplicon = ac[id];
+    children.clear();
+    labels.clear();
+
+    gen.setSequence(amplicon.seq, amplicon.len);
+    if (table.mayContain(gen.hash())) {
+        table.find(gen.hash(), amplicon.seq, amplicon.len, labels);
+    }
+    numSeqs_t numIdentical = labels.size();
+
+    gen.forEach([&](const Microvariants::Microvariant& mv) {
+
+        if (table.mayContain(mv.hash)) {
+
+            lenSeqs_t len = gen.materialise(mv, buf.data());
+            table.find(mv.hash, buf.data(), len, labels);
+
+        }
+
+    });
+
+    for (numSeqs_t i = 0; i < labels.size(); i++) {
+        if (!visited[labels[i]] && (sc.noOtuBreaking || amplicon.abundance >= ac[labels[i]].abundance)) {
+            children.emplace_back(labels[i], (i < numIdentical) ? 0 : 1);
+        }
+    }
+
+    // different microvariants can lead to the same sequence
+    std::sort(children.begin(), children.end());
+    children.erase(std::unique(children.begin(), children.end()), children.end());
+
+}
+
+void SegmentFilter::swarmMicrovariants(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                                       const SwarmClustering::SwarmConfig& sc) {
+
+    Microvariants::SequenceTable table(ac);
+    Microvariants::MicrovariantGenerator gen(Microvariants::determineAlphabet(ac), ac.maxLen());
+    std::vector<numSeqs_t> labels;
+    std::vector<char> buf(ac.maxLen() + 2);
+
+    // determine order of amplicons based on abundance (descending) without invalidating the integer (position) ids of the amplicons
+    SwarmClustering::Otu* curOtu = 0;
+    std::vector<SwarmClustering::OtuEntry> sortBuffer;
+    std::vector<bool> visited(ac.size(), false); // visited amplicons are already included in an OTU
+    std::vector<lenSeqs_t> rads(ac.size(), 0); // radius of the amplicons (accumulated differences to their OTU seed)
+
+    SwarmClustering::OtuEntry curSeed, newSeed;
+    bool unique;
+    std::unordered_set<StringIteratorPair, hashStringIteratorPair, equalStringIteratorPair> uniqueSeqs;
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> next;
+    lenSeqs_t lastGen;
+    numSeqs_t pos;
+
+    // open new OTU for the amplicon with the highest abundance that is not yet included in an OTU
+    const Amplicon* begin = ac.begin();
+    const Amplicon* seed = begin;
+    for (numSeqs_t seedIter = 0; seedIter < ac.size(); seedIter++, seed++) {
+
+        if (!visited[seedIter]) {
+
+            /* (a) Initialise new OTU with seed */
+            curOtu = arena.newOtu(begin);
+
+            newSeed.member = seedIter;
+            newSeed.parent = newSeed.member;
+            newSeed.parentDist = 0;
+            newSeed.gen = 0;
+            arena.addMember(newSeed);
+
+            visited[seedIter] = true;
+            uniqueSeqs.insert(StringIteratorPair(seed->seq, seed->seq + seed->len));
+
+            lastGen = 0;
+
+
+            /* (b) BFS through 'match space' */
+            pos = 0;
+            while (pos < arena.numOpenMembers()) { // expand current OTU until no further similar amplicons can be added
+
+                if (lastGen != arena.openMembers()[pos].gen) { // work through generation by decreasing abundance
+
+                    uniqueSeqs.clear();
+                    SwarmClustering::sortGeneration(arena.openMembers() + pos, arena.openMembers() + arena.numOpenMembers(), sortBuffer,
+                                                    [](const SwarmClustering::OtuEntry& e) {return e.member;});
+
+                }
+
+                // get next OTU (sub)seed
+                curSeed = arena.openMembers()[pos];
+
+                // unique sequences contribute when they occur, non-unique sequences only at their first occurrence
+                unique = (curSeed.parentDist != 0) &&
+                        uniqueSeqs.insert(StringIteratorPair(ac[curSeed.member].seq, ac[curSeed.member].seq + ac[curSeed.member].len)).second;
+
+                // update OTU information
+                curOtu->mass += ac[curSeed.member].abundance;
+
+                // consider yet unseen (unvisited) amplicons to continue the exploration
+                getChildrenMicrovariants(curSeed.member, next, ac, table, gen, labels, buf, visited, sc);
+
                 for (auto matchIter = next.begin(); matchIter != next.end(); matchIter++) {
 
                     unique &= (matchIter->second != 0);
 
+                    newSeed.member = matchIter->first;
+                    newSeed.parent = curSeed.member;
+                    newSeed.parentDist = matchIter->second;
+                    newSeed.gen = curSeed.gen + 1;
+                    arena.addMember(newSeed);
+                    visited[matchIter->first] = true;
+
+                    rads[matchIter->first] = rads[curSeed.member] + matchIter->second;
+                    curOtu->maxRad = std::max(curOtu->maxRad, rads[matchIter->first]);
+
+                }
+
+                curOtu->numUniqueSequences += unique || (curSeed.gen == 0);
+
+                lastGen = curSeed.gen;
+                pos++;
+
+            }
+
+            /* (c) Close the no longer extendable OTU */
+            uniqueSeqs.clear();
+            arena.closeMembers(*curOtu);
+            otus.push_back(curOtu);
+
+        }
+
+    }
+
+}
+
+void SegmentFilter::linkComponents(const AmpliconCollection& ac, SwarmingIndices& indices,
+                                   std::unordered_map<lenSeqs_t, std::unordered_map<lenSeqs_t, std::vector<Substrings>>>& substrsArchive,
+                                   ConcurrentUnionFind& uf, std::atomic<numSeqs_t>& nextId, const SwarmClustering::SwarmConfig& sc) {
+
+    const numSeqs_t chunkSize = 64;
+
+    lenSeqs_t M[sc.useScore ? 1 : ac.maxLen() + 1];
+    val_t D[sc.useScore ? ac.maxLen() + 1 : 1];
+    val_t P[sc.useScore ? ac.maxLen() + 1 : 1];
+    lenSeqs_t cntDiffs[sc.useScore ? ac.maxLen() + 1 : 1];
+    lenSeqs_t cntDiffsP[sc.useScore ? ac.maxLen() + 1 : 1];
+
+    std::vector<numSeqs_t> candCnts;
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> matches;
+
+    for (numSeqs_t first = nextId.fetch_add(chunkSize); first < ac.size(); first = nextId.fetch_add(chunkSize)) {
+
+        for (numSeqs_t id = first; id < std::min(first + chunkSize, ac.size()); id++) {
+
+            auto& amplicon = ac[id];
+            matches.clear();
+
+            for (lenSeqs_t childLen = (amplicon.len > sc.threshold) * (amplicon.len - sc.threshold);
+                 childLen <= amplicon.len + sc.threshold;
+                 childLen++) {
+
+                if (!indices.contains(childLen)) continue;
+
+                candCnts.clear();
+                SegmentFilter::addCandCnts(amplicon, childLen, sc.threshold + sc.extraSegs, candCnts, indices, substrsArchive);
+
+                // Links to more abundant amplicons (smaller index) are found when querying those amplicons.
+                // Candidates already known to be in the same component do not have to be verified.
+                candCnts.erase(std::remove_if(candCnts.begin(), candCnts.end(),
+                                              [id, &uf](const numSeqs_t cand) {
+                                                  return (cand <= id) || uf.sameSet(id, cand);
+                                              }),
+                               candCnts.end());
+                if (candCnts.empty()) continue;
+
+                SegmentFilter::verifyCands(amplicon, ac, candCnts, matches, sc, M, D, P, cntDiffs, cntDiffsP);
+
+            }
+
+            for (auto& m : matches) {
+                uf.unite(id, m.first);
+            }
+
+        }
+
+    }
+
+}
+
+std::vector<std::vector<numSeqs_t>> SegmentFilter::determineComponents(const AmpliconCollection& ac, const SwarmClustering::SwarmConfig& sc,
+                                                                       const unsigned long numThreads) {
+
+    SwarmingIndices indices(sc.threshold + 1, sc.threshold + sc.extraSegs, true, false);
+    std::unordered_map<lenSeqs_t, std::unordered_map<lenSeqs_t, std::vector<Substrings>>> substrsArchive;
+
+    prepareIndices(ac, indices, substrsArchive, sc);
+
+    // similarity join: the (now read-only) indices are queried concurrently
+    ConcurrentUnionFind uf(ac.size());
+    std::atomic<numSeqs_t> nextId(0);
+    std::vector<std::thread> linkers;
+    for (unsigned long i = 0; i < numThreads; i++) {
+        linkers.emplace_back(&SegmentFilter::linkComponents, std::ref(ac), std::ref(indices), std::ref(substrsArchive),
+                             std::ref(uf), std::ref(nextId), std::ref(sc));
+    }
+    for (auto& l : linkers) {
+        l.join();
+    }
+
+    // the representative of a component is its smallest member, so components are numbered by first occurrence
+    std::vector<std::vector<numSeqs_t>> components;
+    std::vector<numSeqs_t> compIds(ac.size());
+    for (numSeqs_t i = 0; i < ac.size(); i++) {
+
+        numSeqs_t root = uf.find(i);
+        if (root == i) {
+
+            compIds[i] = components.size();
+            components.emplace_back();
+
+        }
+        compIds[i] = compIds[root];
+        components[compIds[i]].push_back(i);
+
+    }
+
+    return components;
+
+}
+
+void SegmentFilter::exploreComponents(const AmpliconCollection& ac, const std::vector<std::vector<numSeqs_t>>& components,
+                                      const std::vector<numSeqs_t>& schedule, std::atomic<numSeqs_t>& nextComp,
+                                      std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                                      const SwarmClustering::SwarmConfig& sc) {
+
+    for (numSeqs_t s = nextComp.fetch_add(1); s < schedule.size(); s = nextComp.fetch_add(1)) {
+
+        auto& comp = components[schedule[s]];
+
+        if (comp.size() == 1) { // isolated amplicon, no exploration necessary
+
+            auto otu = arena.newOtu(ac.begin());
+            arena.addMember(SwarmClustering::OtuEntry(comp[0], comp[0], 0, 0));
+            arena.closeMembers(*otu);
+            otu->mass = ac[comp[0]].abundance;
+            otu->numUniqueSequences = 1;
+            otus.push_back(otu);
+
+            continue;
+
+        }
+
+        // copy the component into its own collection (the relative order of the amplicons is kept)
+        std::map<lenSeqs_t, numSeqs_t> lenCounts;
+        for (auto i : comp) {
+            lenCounts[ac[i].len]++;
+        }
+        AmpliconCollection sub(comp.size(), std::vector<std::pair<lenSeqs_t, numSeqs_t>>(lenCounts.begin(), lenCounts.end()));
+        for (auto i : comp) {
+
+            sub.push_back(ac[i]);
+            // identical sequences always end up in the same component
+            sub.setSeqGroup(sub.size() - 1, std::lower_bound(comp.begin(), comp.end(), ac.seqGroup(i)) - comp.begin());
+
+        }
+
+        std::vector<SwarmClustering::Otu*> compOtus;
+        swarmFilterDirectly(sub, compOtus, arena, sc);
+
+        // let the OTU members refer to the amplicons in the original collection again
+        for (auto otu : compOtus) {
+
+            otu->ampls = ac.begin();
+            for (numSeqs_t m = 0; m < otu->numMembers; m++) {
+
+                otu->members[m].member = comp[otu->members[m].member];
+                otu->members[m].parent = comp[otu->members[m].parent];
+
+            }
+
+            otus.push_back(otu);
+
+        }
+
+    }
+
+}
+
+void SegmentFilter::swarmFilterComponents(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                                          const SwarmClustering::SwarmConfig& sc) {
+
+    auto components = determineComponents(ac, sc, sc.numExplorers);
+
+    // explore large components first to balance the load between the threads
+    std::vector<numSeqs_t> schedule(components.size());
+    for (numSeqs_t i = 0; i < schedule.size(); i++) {
+        schedule[i] = i;
+    }
+    std::stable_sort(schedule.begin(), schedule.end(), [&components](const numSeqs_t a, const numSeqs_t b) {
+        return components[a].size() > components[b].size();
+    });
+
+    std::vector<std::vector<SwarmClustering::Otu*>> threadOtus(sc.numExplorers);
+    std::vector<SwarmClustering::OtuArena> threadArenas(sc.numExplorers);
+    std::atomic<numSeqs_t> nextComp(0);
+    std::vector<std::thread> explorers;
+    for (unsigned long e = 0; e < sc.numExplorers; e++) {
+        explorers.emplace_back(&SegmentFilter::exploreComponents, std::ref(ac), std::ref(components), std::ref(schedule),
+                               std::ref(nextComp), std::ref(threadOtus[e]), std::ref(threadArenas[e]), std::ref(sc));
+    }
+    for (auto& e : explorers) {
+        e.join();
+    }
+
+    for (auto& a : threadArenas) {
+        arena.absorb(a);
+    }
+
+    // restore the order of the sequential exploration (OTUs ordered by the position of their seeds)
+    numSeqs_t numOtus = otus.size();
+    for (auto& vec : threadOtus) {
+        otus.insert(otus.end(), vec.begin(), vec.end());
+    }
+    std::sort(otus.begin() + numOtus, otus.end(), [](const SwarmClustering::Otu* a, const SwarmClustering::Otu* b) {
+        return a->seed() < b->seed();
+    });
+
+}
+
+void SegmentFilter::getChildrenSpeculatively(ChildrenFinder& cf, const SwarmClustering::OtuEntry* members,
+                                             const numSeqs_t genBegin, const numSeqs_t genEnd, std::atomic<numSeqs_t>& nextPos,
+                                             std::vector<std::vector<std::pair<numSeqs_t, lenSeqs_t>>>& children, const bool twoWay) {
+
+    for (numSeqs_t p = nextPos.fetch_add(1); p < genEnd; p = nextPos.fetch_add(1)) {
+
+        if (twoWay) {
+            cf.getChildrenTwoWay(members[p].member, children[p - genBegin]);
+        } else {
+            cf.getChildren(members[p].member, children[p - genBegin]);
+        }
+
+    }
+
+}
+
+void SegmentFilter::swarmFilterSpeculative(const AmpliconCollection& ac, std::vector<SwarmClustering::Otu*>& otus, SwarmClustering::OtuArena& arena,
+                                           const SwarmClustering::SwarmConfig& sc) {
+
+    SwarmingIndices indices(sc.threshold + 1, sc.threshold + sc.extraSegs, true, false);
+    std::unordered_map<lenSeqs_t, std::unordered_map<lenSeqs_t, std::vector<Substrings>>> substrsArchive;
+
+    prepareIndices(ac, indices, substrsArchive, sc);
+
+    SwarmClustering::Otu* curOtu = 0;
+    std::vector<SwarmClustering::OtuEntry> sortBuffer;
+    std::vector<bool> visited(ac.size(), false); // visited amplicons are already included in an OTU
+    std::vector<lenSeqs_t> rads(ac.size(), 0); // radius of the amplicons (accumulated differences to their OTU seed)
+
+    SwarmClustering::OtuEntry curSeed, newSeed;
+    bool unique;
+    std::unordered_set<StringIteratorPair, hashStringIteratorPair, equalStringIteratorPair> uniqueSeqs;
+    std::vector<std::pair<numSeqs_t, lenSeqs_t>> next;
+    lenSeqs_t lastGen;
+    numSeqs_t pos;
+
+    // one children finder (with its own verification arrays) per thread, the last one is also used for sequential queries
+    const unsigned long numThreads = std::max(sc.numThreadsPerExplorer, 1UL);
+    const numSeqs_t minGenSize = 2 * numThreads; // smaller generations are processed sequentially
+    const lenSeqs_t width = indices.maxLength() + 1;
+    std::vector<std::vector<lenSeqs_t>> Ms(numThreads, std::vector<lenSeqs_t>(sc.useScore ? 1 : width));
+    std::vector<std::vector<val_t>> Ds(numThreads, std::vector<val_t>(sc.useScore ? width : 1));
+    std::vector<std::vector<val_t>> Ps(numThreads, std::vector<val_t>(sc.useScore ? width : 1));
+    std::vector<std::vector<lenSeqs_t>> cntDiffs(numThreads, std::vector<lenSeqs_t>(sc.useScore ? width : 1));
+    std::vector<std::vector<lenSeqs_t>> cntDiffsP(numThreads, std::vector<lenSeqs_t>(sc.useScore ? width : 1));
+    std::vector<ChildrenFinder> finders;
+    for (unsigned long i = 0; i < numThreads; i++) {
+        finders.emplace_back(ac, indices, substrsArchive, sc, Ms[i].data(), Ds[i].data(), Ps[i].data(), cntDiffs[i].data(), cntDiffsP[i].data());
+    }
+    ChildrenFinder& cf = finders.back();
+
+    // children of the members of the current generation, computed against the state of the indices at the start of the generation
+    std::vector<std::vector<std::pair<numSeqs_t, lenSeqs_t>>> specChildren;
+    numSeqs_t genBegin = 0;
+    bool speculative = false;
+    std::vector<std::thread> workers;
+
+    // open new OTU for the amplicon with the highest abundance that is not yet included in an OTU
+    const Amplicon* begin = ac.begin();
+    const Amplicon* seed = begin;
+    for (numSeqs_t seedIter = 0; seedIter < ac.size(); seedIter++, seed++) {
+
+        if (!visited[seedIter]) {
+
+            /* (a) Initialise new OTU with seed */
+            curOtu = arena.newOtu(begin);
+
+            newSeed.member = seedIter;
+            newSeed.parent = newSeed.member;
+            newSeed.parentDist = 0;
+            newSeed.gen = 0;
+            arena.addMember(newSeed);
+
+            visited[seedIter] = true;
+            uniqueSeqs.insert(StringIteratorPair(seed->seq, seed->seq + seed->len));
+#if SUCCINCT
+            indices.getIndicesRow(ac[seedIter].len).shared.remove(seedIter);
+#else
+            {
+                auto& invs = indices.getIndicesRow(ac[seedIter].len);
+                for (auto i = 0; i < sc.threshold + sc.extraSegs; i++) {
+                    invs[i].removeLabel(seedIter);
+                }
+            }
+#endif
+
+            lastGen = 0;
+            speculative = false;
+
+
+            /* (b) BFS through 'match space' */
+            pos = 0;
+            while (pos < arena.numOpenMembers()) { // expand current OTU until no further similar amplicons can be added
+
+                if (lastGen != arena.openMembers()[pos].gen) { // work through generation by decreasing abundance
+
+                    uniqueSeqs.clear();
+                    SwarmClustering::sortGeneration(arena.openMembers() + pos, arena.openMembers() + arena.numOpenMembers(), sortBuffer,
+                                                    [](const SwarmClustering::OtuEntry& e) {return e.member;});
+
+                    // The generation is complete now, so the children of all its members can be determined concurrently.
+                    // The indices are not modified during this step (only read by the workers).
+                    genBegin = pos;
+                    speculative = (arena.numOpenMembers() - genBegin >= minGenSize) && (numThreads > 1);
+                    if (speculative) {
+
+                        specChildren.resize(arena.numOpenMembers() - genBegin);
+                        std::atomic<numSeqs_t> nextPos(genBegin);
+                        for (unsigned long i = 0; i < numThreads; i++) {
+                            workers.emplace_back(&SegmentFilter::getChildrenSpeculatively, std::ref(finders[i]), arena.openMembers(),
+                                                 genBegin, arena.numOpenMembers(), std::ref(nextPos), std::ref(specChildren), sc.filterTwoWay);
+                        }
+                        for (auto& w : workers) {
+                            w.join();
+                        }
+                        workers.clear();
+
+                    }
+
+                }
+
+                // get next OTU (sub)seed
+                curSeed = arena.openMembers()[pos];
+
+                // unique sequences contribute when they occur, non-unique sequences only at their first occurrence
+                unique = (curSeed.parentDist != 0) &&
+                        uniqueSeqs.insert(StringIteratorPair(ac[curSeed.member].seq, ac[curSeed.member].seq + ac[curSeed.member].len)).second;
+
+                // update OTU information
+                curOtu->mass += ac[curSeed.member].abundance;
+
+                // Consider yet unseen (unvisited) amplicons to continue the exploration.
+                // Speculatively computed children can contain amplicons visited by earlier members of the same generation,
+                // which are skipped here (committing the children in the same order as the sequential exploration).
+                if (speculative) {
+                    next.swap(specChildren[pos - genBegin]);
+                } else {
+                    sc.filterTwoWay ? cf.getChildrenTwoWay(curSeed.member, next) : cf.getChildren(curSeed.member, next);
+                }
+
+                for (auto matchIter = next.begin(); matchIter != next.end(); matchIter++) {
+
                     if (!visited[matchIter->first]) {
 
-                        newSeed.member = begin + matchIter->first;
+                        unique &= (matchIter->second != 0);
+
+                        newSeed.member = matchIter->first;
                         newSeed.parent = curSeed.member;
                         newSeed.parentDist = matchIter->second;
                         newSeed.gen = curSeed.gen + 1;
-                        newSeed.rad = curSeed.rad + matchIter->second;
-                        tmpMembers.push_back(newSeed);
+                        arena.addMember(newSeed);
                         visited[matchIter->first] = true;
 
+                        rads[matchIter->first] = rads[curSeed.member] + matchIter->second;
+                        curOtu->maxRad = std::max(curOtu->maxRad, rads[matchIter->first]);
+
 #if SUCCINCT
                         indices.getIndicesRow(ac[matchIter->first].len).shared.remove(matchIter->first);
 #else
@@ -1262,8 +1810,7 @@ void SegmentFilter::swarmFilterDirectly(const AmpliconCollection& ac, std::vecto
 
             /* (c) Close the no longer extendable OTU */
             uniqueSeqs.clear();
-            curOtu->setMembers(tmpMembers);
-            std::vector<SwarmClustering::OtuEntryPrecursor>().swap(tmpMembers);
+            arena.closeMembers(*curOtu);
             otus.push_back(curOtu);
 
         }
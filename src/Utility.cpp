@@ -104,17 +104,37 @@ Config<std::string> getConfiguration(int argc, const char* argv[]) {
     parameters["--min-length"] = 1001;
     parameters["--max-length"] = 1002;
 //    parameters["--per-worker"] = 1003;
-//    parameters["--workers"] = 1004;
+    parameters["--workers"] = 1004;
     parameters["--info-folder"] = 1005;
     parameters["--sep-abundance"] = 1006;
     parameters["--use-score"] = 1007;
     parameters["--preprocessing-only"] = 1008;
+    parameters["--output-binary"] = 1009;
+    parameters["--spill-file"] = 1010;
+    parameters["--id-storage-file"] = 1011;
+    parameters["--assign-reference"] = 1012;
+    parameters["--assign-output"] = 1013;
+    parameters["--service-socket"] = 1014;
+    parameters["--service-jobs"] = 1015;
 
     parameters["--swarm-fastidious-checking-mode"] = 1101;
     parameters["--swarm-num-explorers"] = 1102;
     parameters["--swarm-num-grafters"] = 1103;
     parameters["--swarm-num-threads-per-check"] = 1104;
     parameters["--swarm-fastidious-threshold"] = 1105;
+    parameters["--swarm-exploration-mode"] = 1106;
+    parameters["--swarm-multi-threshold"] = 1107;
+    parameters["--swarm-output-phase1"] = 1108;
+    parameters["--swarm-input-phase1"] = 1109;
+    parameters["--swarm-sweep"] = 1110;
+    parameters["--swarm-num-writers"] = 1111;
+    parameters["--swarm-output-binary"] = 1112;
+    parameters["--swarm-input-binary"] = 1113;
+    parameters["--swarm-streaming"] = 1114;
+    parameters["--swarm-shard-dir"] = 1115;
+    parameters["--swarm-shard-role"] = 1116;
+    parameters["--swarm-input-state"] = 1117;
+    parameters["--swarm-output-state"] = 1118;
 
 
     std::string
@@ -132,27 +152,33 @@ Config<std::string> getConfiguration(int argc, const char* argv[]) {
 
     config.set(FILTER_ALPHABET, "0");
     config.set(FILTER_LENGTH, "0");
+    config.set(MATCHES_OUTPUT_BINARY, "0");
     config.set(NUM_EXTRA_SEGMENTS, "1");
 //    config.set(NUM_THREADS_PER_WORKER, "1");
-//    config.set(NUM_WORKERS, "1");
+    config.set(NUM_WORKERS, "1");
     config.set(PREPROCESSING_ONLY, "0");
     config.set(SEGMENT_FILTER, "0");
     config.set(SEPARATOR_ABUNDANCE, "_");
+    config.set(SERVICE_NUM_JOBS, "2");
     config.set(THRESHOLD, "1");
     config.set(USE_SCORE, "0");
 
     config.set(SWARM_BOUNDARY, "3");
     config.set(SWARM_DEREPLICATE, "0");
+    config.set(SWARM_EXPLORATION_MODE, "0");
     config.set(SWARM_FASTIDIOUS, "0");
     config.set(SWARM_FASTIDIOUS_CHECKING_MODE, "0");
     config.set(SWARM_GAP_EXTENSION_PENALTY, "-4");
     config.set(SWARM_GAP_OPENING_PENALTY, "-12");
     config.set(SWARM_MATCH_REWARD, "5");
     config.set(SWARM_MISMATCH_PENALTY, "-4");
+    config.set(SWARM_MULTI_THRESHOLD, "0");
     config.set(SWARM_NO_OTU_BREAKING, "0");
     config.set(SWARM_NUM_EXPLORERS, "1");
     config.set(SWARM_NUM_GRAFTERS, "1");
     config.set(SWARM_NUM_THREADS_PER_CHECK, "1");
+    config.set(SWARM_NUM_WRITERS, "1");
+    config.set(SWARM_STREAMING, "0");
     config.set(SWARM_FASTIDIOUS_THRESHOLD, "0");
 
     /* Determine parameter values */
@@ -208,6 +234,18 @@ Config<std::string> getConfiguration(int argc, const char* argv[]) {
                 config.set(PREPROCESSING_ONLY, "1");
                 continue;
 
+            case 1009:
+                config.set(MATCHES_OUTPUT_BINARY, "1");
+                continue;
+
+            case 1107:
+                config.set(SWARM_MULTI_THRESHOLD, "1");
+                continue;
+
+            case 1114:
+                config.set(SWARM_STREAMING, "1");
+                continue;
+
             default:
                 // do nothing
                 break;
@@ -332,10 +370,10 @@ Config<std::string> getConfiguration(int argc, const char* argv[]) {
 //                    config.set(NUM_THREADS_PER_WORKER, std::to_string(val));
 //                    break;
 
-//                case 1004:
-//                    val = std::stoul(argv[++i]);
-//                    config.set(NUM_WORKERS, std::to_string(val));
-//                    break;
+                case 1004:
+                    val = std::stoul(argv[++i]);
+                    config.set(NUM_WORKERS, std::to_string(val));
+                    break;
 
                 case 1005:
                     config.set(INFO_FOLDER, argv[++i]);
@@ -345,6 +383,31 @@ Config<std::string> getConfiguration(int argc, const char* argv[]) {
                     config.set(SEPARATOR_ABUNDANCE, argv[++i]);
                     break;
 
+                case 1010:
+                    config.set(SPILL_FILE, argv[++i]);
+                    break;
+
+                case 1011:
+                    config.set(ID_STORAGE_FILE, argv[++i]);
+                    break;
+
+                case 1012:
+                    config.set(ASSIGN_REFERENCE_FILE, argv[++i]);
+                    break;
+
+                case 1013:
+                    config.set(ASSIGN_OUTPUT_FILE, argv[++i]);
+                    break;
+
+                case 1014:
+                    config.set(SERVICE_SOCKET, argv[++i]);
+                    break;
+
+                case 1015:
+                    val = std::stoul(argv[++i]);
+                    config.set(SERVICE_NUM_JOBS, std::to_string(val));
+                    break;
+
                 case 1101:
                     val = std::stoul(argv[++i]);
                     config.set(SWARM_FASTIDIOUS_CHECKING_MODE, std::to_string(val));
@@ -370,6 +433,52 @@ Config<std::string> getConfiguration(int argc, const char* argv[]) {
                     config.set(SWARM_FASTIDIOUS_THRESHOLD, std::to_string(val));
                     break;
 
+                case 1106:
+                    val = std::stoul(argv[++i]);
+                    config.set(SWARM_EXPLORATION_MODE, std::to_string(val));
+                    break;
+
+                case 1108:
+                    config.set(SWARM_OUTPUT_PHASE1, argv[++i]);
+                    break;
+
+                case 1109:
+                    config.set(SWARM_INPUT_PHASE1, argv[++i]);
+                    break;
+
+                case 1110:
+                    config.set(SWARM_SWEEP, argv[++i]);
+                    break;
+
+                case 1111:
+                    val = std::stoul(argv[++i]);
+                    config.set(SWARM_NUM_WRITERS, std::to_string(val));
+                    break;
+
+                case 1112:
+                    config.set(SWARM_OUTPUT_BINARY, argv[++i]);
+                    break;
+
+                case 1113:
+                    config.set(SWARM_INPUT_BINARY, argv[++i]);
+                    break;
+
+                case 1115:
+                    config.set(SWARM_SHARD_DIR, argv[++i]);
+                    break;
+
+                case 1116:
+                    config.set(SWARM_SHARD_ROLE, argv[++i]);
+                    break;
+
+                case 1117:
+                    config.set(SWARM_INPUT_STATE, argv[++i]);
+                    break;
+
+                case 1118:
+                    config.set(SWARM_OUTPUT_STATE, argv[++i]);
+                    break;
+
                 default:
                     std::cout << "Unknown parameter: " << argv[i] << " (is ignored)" << std::endl;
                     break;
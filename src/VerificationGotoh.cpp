@@ -1537,4 +1537,257 @@ Verification::AlignmentInformation Verification::computeGotohCigarRow1(const cha
 
 }
 
+val_t Verification::fillGotohBanded(const char* s, const lenSeqs_t lenS, const char* t, const lenSeqs_t lenT, const Scoring& scoring,
+                                    const lenSeqs_t w, val_t* D, val_t* P, char* BT) {
+
+    const lenSeqs_t bandWidth = 2 * w + 1;
+
+    // initialise first row (cells outside of the band are 'infinite')
+    D[0] = 0;
+    for (lenSeqs_t j = 1; j <= std::min<lenSeqs_t>(lenT, w); j++) {
+
+        D[j] = scoring.penOpen + j * scoring.penExtend;
+        P[j] = POS_INF;
+
+    }
+    if (w + 1 <= lenT) {
+
+        D[w + 1] = POS_INF;
+        P[w + 1] = POS_INF;
+
+    }
+
+    // compute remaining rows
+    val_t match, valQ, fromD, fromPQ, minVal;
+    char tmp;
+
+    for (lenSeqs_t i = 1; i <= lenS; i++) {
+
+        lenSeqs_t jLo = (i > w) ? (i - w) : 1;
+        lenSeqs_t jHi = std::min<lenSeqs_t>(lenT, i + w);
+
+        // handle left end of the band
+        match = D[jLo - 1];
+        D[jLo - 1] = (jLo == 1 && i <= w) ? (scoring.penOpen + i * scoring.penExtend) : POS_INF;
+        valQ = POS_INF;
+
+        // fill remaining part of the row within the band
+        char* btRow = BT + i * bandWidth + w - i; // btRow[j] corresponds to cell (i, j)
+        for (lenSeqs_t j = jLo; j <= jHi; j++) {
+
+            // array P
+            fromD = D[j] + scoring.penOpen + scoring.penExtend;
+            fromPQ = P[j] + scoring.penExtend;
+
+            if (fromD <= fromPQ) {
+
+                P[j] = fromD;
+                tmp = UP_TO_D;
+
+            } else {
+
+                P[j] = fromPQ;
+                tmp = UP_IN_P;
+
+            }
+
+            // array Q
+            fromD = D[j - 1] + scoring.penOpen + scoring.penExtend;
+            fromPQ = valQ + scoring.penExtend;
+
+            if (fromD <= fromPQ) {
+
+                valQ = fromD;
+                tmp |= LEFT_TO_D;
+
+            } else {
+
+                valQ = fromPQ;
+                tmp |= LEFT_IN_Q;
+
+            }
+
+            // arrays D & BT
+            minVal = match + (s[i - 1] != t[j - 1]) * scoring.penMismatch;
+            btRow[j] = DIAGONAL_IN_D;
+            if (P[j] < minVal) {
+
+                minVal = P[j];
+                btRow[j] = JUMP_TO_P;
+
+            }
+            if (valQ <= minVal){
+
+                minVal = valQ;
+                btRow[j] = JUMP_TO_Q;
+
+            }
+
+            btRow[j] |= tmp;
+
+            match = D[j];
+            D[j] = minVal;
+
+        }
+
+        // the cell right of the band is not reached by the band of the previous row
+        if (jHi + 1 <= lenT) {
+
+            D[jHi + 1] = POS_INF;
+            P[jHi + 1] = POS_INF;
+
+        }
+
+    }
+
+    return D[lenT];
+
+}
+
+Verification::AlignmentInformation Verification::computeGotohCigarBanded(const char* s, const lenSeqs_t lenS, const char* t, const lenSeqs_t lenT,
+                                                                         const Scoring& scoring, const lenSeqs_t bound,
+                                                                         std::vector<val_t>& D, std::vector<val_t>& P, std::vector<char>& BT) {
+
+    const lenSeqs_t maxWidth = std::max(lenS, lenT);
+    const lenSeqs_t lenDiff = (lenS > lenT) ? (lenS - lenT) : (lenT - lenS);
+
+    // an alignment realising the bound costs at most bound * maxPen, so that an optimal alignment has at most bound * maxPen / penExtend gaps
+    lenSeqs_t w = maxWidth;
+    if (scoring.penExtend > 0) {
+
+        val_t maxPen = std::max(scoring.penMismatch, scoring.penOpen + scoring.penExtend);
+        w = std::min(maxWidth, std::max(lenDiff, lenSeqs_t(bound * maxPen / scoring.penExtend)));
+
+    }
+
+    if (D.size() < lenT + 2) {
+
+        D.resize(lenT + 2);
+        P.resize(lenT + 2);
+
+    }
+
+    val_t score;
+    while (true) {
+
+        if (BT.size() < (lenS + 2) * (2 * w + 1)) BT.resize((lenS + 2) * (2 * w + 1));
+        score = fillGotohBanded(s, lenS, t, lenT, scoring, w, D.data(), P.data(), BT.data());
+
+        if (w >= maxWidth || score < (w + 1) * scoring.penExtend) break;
+
+        w = std::min(maxWidth, lenSeqs_t(score / scoring.penExtend));
+
+    }
+
+    const lenSeqs_t bandWidth = 2 * w + 1;
+    auto bandIndex = [bandWidth, w](const lenSeqs_t i, const lenSeqs_t j) {
+        return i * bandWidth + w + j - i;
+    };
+
+    // backtracking (priorities: left > diagonal > up)
+    std::vector<std::pair<char, lenSeqs_t >> cigarSegs = {std::make_pair('N',0)};
+    lenSeqs_t len = 0;
+    lenSeqs_t numDiffs = 0;
+    lenSeqs_t i = lenS;
+    lenSeqs_t j = lenT;
+
+    while (i != 0 && j != 0) {
+
+        if ((cigarSegs.back().first == 'I') && (BT[bandIndex(i, j + 1)] & LEFT_IN_Q)) {
+
+            len++;
+            numDiffs++;
+            cigarSegs.back().second++;
+
+            j--;
+
+        } else if ((cigarSegs.back().first == 'D') && (BT[bandIndex(i + 1, j)] & UP_IN_P)) {
+
+            len++;
+            numDiffs++;
+            cigarSegs.back().second++;
+
+            i--;
+
+        } else if (BT[bandIndex(i, j)] & JUMP_TO_Q) {
+
+            len++;
+            numDiffs++;
+            if (cigarSegs.back().first == 'I') {
+                cigarSegs.back().second++;
+            } else {
+                cigarSegs.push_back(std::make_pair('I', 1));
+            }
+
+            j--;
+
+        } else if (BT[bandIndex(i, j)] & DIAGONAL_IN_D) {
+
+            len++;
+            numDiffs += (s[i - 1] != t[j - 1]);
+            if (cigarSegs.back().first == 'M') {
+                cigarSegs.back().second++;
+            } else {
+                cigarSegs.push_back(std::make_pair('M', 1));
+            }
+
+            i--;
+            j--;
+
+        } else { // BT[i][j] & JUMP_TO_P
+
+            len++;
+            numDiffs++;
+            if (cigarSegs.back().first == 'D') {
+                cigarSegs.back().second++;
+            } else {
+                cigarSegs.push_back(std::make_pair('D', 1));
+            }
+
+            i--;
+
+        }
+
+    }
+
+    while (i > 0) {
+
+        len++;
+        numDiffs++;
+        if (cigarSegs.back().first == 'D') {
+            cigarSegs.back().second++;
+        } else {
+            cigarSegs.push_back(std::make_pair('D', 1));
+        }
+
+        i--;
+
+    }
+
+    while (j > 0) {
+
+        len++;
+        numDiffs++;
+        if (cigarSegs.back().first == 'I') {
+            cigarSegs.back().second++;
+        } else {
+            cigarSegs.push_back(std::make_pair('I', 1));
+        }
+
+        j--;
+
+    }
+
+    std::stringstream sStream;
+    for (auto p = cigarSegs.size() - 1; p > 0; p--) {
+
+        if (cigarSegs[p].second > 1) sStream << cigarSegs[p].second;
+        sStream << cigarSegs[p].first;
+
+    }
+
+    return AlignmentInformation(sStream.str(), len, numDiffs);
+
+}
+
 }
\ No newline at end of file